@@ -0,0 +1,86 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/mipmap_image.hpp"
+#include "todds/vector.hpp"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Measures the memory bandwidth saved by not value-initializing image buffers which are going to be overwritten.
+// Buffers are recycled by the buffer pool, so page faults do not affect the results after the first iteration.
+
+namespace {
+
+constexpr std::size_t image_width = 3840UL;
+constexpr std::size_t image_height = 2160UL;
+constexpr std::size_t iterations = 64UL;
+constexpr double bytes_per_mebibyte = 1024.0 * 1024.0;
+constexpr double bytes_per_gibibyte = bytes_per_mebibyte * 1024.0;
+
+// Simulates a pipeline stage writing every byte of the buffer.
+std::uint8_t overwrite(std::span<std::uint8_t> data) {
+	std::memset(data.data(), 0x7F, data.size());
+	return data[data.size() / 2UL];
+}
+
+// Average time in seconds of each call to function.
+template<typename Function> double measure(Function&& function) {
+	// Make sure that the buffer pool already contains a buffer of this size.
+	function();
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t iteration = 0UL; iteration < iterations; ++iteration) { function(); }
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / static_cast<double>(iterations);
+}
+
+void print_result(const char* name, double seconds, std::size_t bytes) {
+	fmt::print("{:<24s}{:>9.3f} ms per buffer, {:>7.2f} GiB/s\n", name, seconds * 1000.0,
+		static_cast<double>(bytes) / bytes_per_gibibyte / seconds);
+}
+
+} // Anonymous namespace
+
+int main() {
+#if !defined(NDEBUG)
+	fmt::print("Debug builds poison every allocated buffer. Use a release build for meaningful results.\n");
+#endif
+
+	// Size of the memory used by a 4K image and its mipmaps, stored as pixel blocks.
+	const std::size_t bytes =
+		todds::mipmap_image{0UL, image_width, image_height, true, todds::pixel_layout::blocks}.data_size();
+	fmt::print("{:d}x{:d} RGBA image with mipmaps: {:.1f} MiB per buffer, {:d} iterations.\n", image_width, image_height,
+		static_cast<double>(bytes) / bytes_per_mebibyte, iterations);
+
+	volatile std::uint8_t sink{};
+	// Regular allocation and value-initialization, as done before introducing the buffer pool.
+	const double regular = measure([bytes, &sink] {
+		todds::vector<std::uint8_t> buffer(bytes);
+		sink = overwrite(buffer);
+	});
+	// Value-initialization of a recycled buffer. The memory is written twice.
+	const double value_initialized = measure([bytes, &sink] {
+		todds::pooled_vector<std::uint8_t> buffer(bytes);
+		std::memset(buffer.data(), 0, buffer.size());
+		sink = overwrite(buffer);
+	});
+	const double default_initialized = measure([bytes, &sink] {
+		todds::pooled_vector<std::uint8_t> buffer(bytes);
+		sink = overwrite(buffer);
+	});
+
+	print_result("Regular allocation:", regular, bytes);
+	print_result("Pooled, zeroed:", value_initialized, bytes);
+	print_result("Pooled, uninitialized:", default_initialized, bytes);
+	const double saved = value_initialized - default_initialized;
+	fmt::print("Saved {:.3f} ms per buffer ({:.1f}%). Skipped writes: {:.1f} MiB per buffer.\n", saved * 1000.0,
+		saved / value_initialized * 100.0, static_cast<double>(bytes) / bytes_per_mebibyte);
+
+	return sink == 0U ? 1 : 0;
+}
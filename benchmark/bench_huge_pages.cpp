@@ -0,0 +1,108 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/buffer_pool.hpp"
+#include "todds/dds.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/resample.hpp"
+#include "todds/vector.hpp"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+
+// Measures the time spent by each pipeline stage on an 8K image with regular pages and with huge pages.
+// Stages run on a single thread, using an image stored as pixel blocks with all of its mipmaps in a single buffer.
+
+namespace {
+
+constexpr std::size_t image_width = 7680UL;
+constexpr std::size_t image_height = 4320UL;
+constexpr std::size_t iterations = 2UL;
+constexpr double bytes_per_mebibyte = 1024.0 * 1024.0;
+
+struct stage_times {
+	double decode{};
+	double mipmaps{};
+	double bc1{};
+	double bc7{};
+};
+
+// Average time in seconds of each call to function.
+template<typename Function> double measure(Function&& function) {
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t iteration = 0UL; iteration < iterations; ++iteration) { function(); }
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / static_cast<double>(iterations);
+}
+
+// Writes every row of the first level, as done by the PNG decoder.
+void decode(todds::image& level) {
+	todds::vector<std::uint8_t> row(level.width() * todds::image::bytes_per_pixel);
+	for (std::size_t row_index = 0UL; row_index < level.height(); ++row_index) {
+		for (std::size_t byte = 0UL; byte < row.size(); ++byte) { row[byte] = static_cast<std::uint8_t>(byte ^ row_index); }
+		level.write_row(row_index, row);
+	}
+}
+
+stage_times run_stages(bool huge_pages) {
+	// Cached buffers keep the pages they were created with.
+	todds::buffer_pool::trim();
+	todds::buffer_pool::set_huge_pages(huge_pages);
+	todds::mipmap_image image{0UL, image_width, image_height, true, todds::pixel_layout::blocks};
+	const auto bc7_params = todds::dds::bc7_encode_params(todds::format::quality::minimum);
+
+	stage_times times{};
+	times.decode = measure([&image] { decode(image.get_image(0UL)); });
+	times.mipmaps = measure([&image] {
+		for (std::size_t index = 1UL; index < image.mipmap_count(); ++index) {
+			const auto& source = image.get_image(index - 1UL);
+			todds::resample::resample(source, image.get_image(index), todds::filter::type::lanczos, 0.55);
+		}
+	});
+	times.bc1 = measure([&image] {
+		[[maybe_unused]] const auto result =
+			todds::dds::bc1_encode(todds::format::quality::minimum, false, image.pixel_blocks());
+	});
+	times.bc7 = measure([&image, &bc7_params] {
+		[[maybe_unused]] const auto result = todds::dds::bc7_encode(bc7_params, image.pixel_blocks());
+	});
+	todds::buffer_pool::set_huge_pages(false);
+	return times;
+}
+
+void print_stage(const char* name, double regular, double huge) {
+	fmt::print("{:<10s}{:>12.2f} ms{:>12.2f} ms{:>+9.1f}%\n", name, regular * 1000.0, huge * 1000.0,
+		(huge - regular) / regular * 100.0);
+}
+
+} // Anonymous namespace
+
+int main() {
+#if !defined(NDEBUG)
+	fmt::print("Debug builds poison every allocated buffer. Use a release build for meaningful results.\n");
+#endif
+	todds::dds::initialize_encoding(todds::format::type::bc1, todds::format::type::bc7);
+
+	const std::size_t bytes =
+		todds::mipmap_image{0UL, image_width, image_height, true, todds::pixel_layout::blocks}.data_size();
+	fmt::print("{:d}x{:d} RGBA image with mipmaps: {:.1f} MiB, {:d} iterations per stage.\n", image_width, image_height,
+		static_cast<double>(bytes) / bytes_per_mebibyte, iterations);
+
+	const auto regular = run_stages(false);
+	const auto huge_pages_before = todds::buffer_pool::get_statistics().huge_page_buffers;
+	const auto huge = run_stages(true);
+	const bool explicit_huge_pages = todds::buffer_pool::get_statistics().huge_page_buffers > huge_pages_before;
+	fmt::print("Huge pages: {:s}.\n", explicit_huge_pages ? "explicit" : "transparent, if enabled by the system");
+
+	fmt::print("{:<10s}{:>15s}{:>15s}{:>10s}\n", "Stage", "Regular pages", "Huge pages", "Change");
+	print_stage("Decode", regular.decode, huge.decode);
+	print_stage("Mipmaps", regular.mipmaps, huge.mipmaps);
+	print_stage("BC1", regular.bc1, huge.bc1);
+	print_stage("BC7", regular.bc7, huge.bc7);
+
+	return 0;
+}
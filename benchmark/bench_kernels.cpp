@@ -0,0 +1,188 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/alpha_coverage.hpp"
+#include "todds/dds.hpp"
+#include "todds/filter.hpp"
+#include "todds/format.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/png.hpp"
+#include "todds/resample.hpp"
+#include "todds/vector.hpp"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+// Measures the throughput of each kernel of the pipeline on a single thread, without any I/O. Bytes per second refer to
+// the uncompressed RGBA pixels processed by the kernel, and blocks per second to the 4x4 pixel blocks of those pixels.
+// An optional argument only runs kernels whose name contains it, such as "bc7" or "resample".
+
+namespace {
+
+constexpr std::size_t image_width = 2048UL;
+constexpr std::size_t image_height = 2048UL;
+constexpr std::size_t block_pixels = todds::pixel_block_side * todds::pixel_block_side;
+// Each kernel is repeated until this time has passed.
+constexpr std::chrono::milliseconds minimum_time{500};
+constexpr double bytes_per_mebibyte = 1024.0 * 1024.0;
+
+constexpr std::array<todds::filter::type, 5UL> all_filters{todds::filter::type::nearest, todds::filter::type::linear,
+	todds::filter::type::cubic, todds::filter::type::area, todds::filter::type::lanczos};
+
+// Average time in seconds of each call to function, after a first call which fills the buffer pool.
+template<typename Function> double measure(Function&& function) {
+	function();
+	std::size_t iterations{};
+	const auto start = std::chrono::steady_clock::now();
+	auto elapsed = std::chrono::steady_clock::duration{};
+	while (elapsed < minimum_time) {
+		function();
+		++iterations;
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+	return std::chrono::duration<double>(elapsed).count() / static_cast<double>(iterations);
+}
+
+class kernel_runner final {
+public:
+	explicit kernel_runner(std::string_view selection)
+		: _selection{selection} {}
+
+	// Runs function if its name matches the selection, and prints its throughput for the given number of pixels. Only
+	// the time is printed for kernels which do not process pixels.
+	template<typename Function> void run(std::string_view name, std::size_t pixels, Function&& function) const {
+		if (!_selection.empty() && name.find(_selection) == std::string_view::npos) { return; }
+		const double seconds = measure(std::forward<Function>(function));
+		if (pixels == 0UL) {
+			fmt::print("{:<28s}{:>12.3f} ns\n", name, seconds * 1.0e9);
+			return;
+		}
+		const auto bytes = static_cast<double>(pixels * todds::image::bytes_per_pixel);
+		const auto blocks = static_cast<double>(pixels / block_pixels);
+		fmt::print("{:<28s}{:>12.3f} ms{:>12.1f} MiB/s{:>14.3f} Mblocks/s\n", name, seconds * 1000.0,
+			bytes / bytes_per_mebibyte / seconds, blocks / 1.0e6 / seconds);
+	}
+
+private:
+	std::string_view _selection;
+};
+
+// Smooth gradients with some detail, and an alpha channel when requested.
+void fill(todds::image& img, bool alpha) {
+	todds::vector<std::uint8_t> row(img.width() * todds::image::bytes_per_pixel);
+	for (std::size_t pixel_y = 0UL; pixel_y < img.height(); ++pixel_y) {
+		for (std::size_t pixel_x = 0UL; pixel_x < img.width(); ++pixel_x) {
+			auto* pixel = &row[pixel_x * todds::image::bytes_per_pixel];
+			pixel[0] = static_cast<std::uint8_t>(pixel_x * 255UL / img.width() + (pixel_x * pixel_y) % 7UL);
+			pixel[1] = static_cast<std::uint8_t>(pixel_y * 255UL / img.height() + (pixel_x ^ pixel_y) % 5UL);
+			pixel[2] = static_cast<std::uint8_t>((pixel_x + pixel_y) / 16UL);
+			pixel[3] = alpha ? static_cast<std::uint8_t>(pixel_x + pixel_y) : std::uint8_t{255U};
+		}
+		img.write_row(pixel_y, row);
+	}
+}
+
+std::unique_ptr<todds::mipmap_image> make_image(todds::pixel_layout layout, bool alpha) {
+	auto result = std::make_unique<todds::mipmap_image>(0UL, image_width, image_height, false, layout);
+	fill(result->get_image(0UL), alpha);
+	return result;
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+#if !defined(NDEBUG)
+	fmt::print("Debug builds poison every allocated buffer. Use a release build for meaningful results.\n");
+#endif
+	const kernel_runner runner{argc > 1 ? std::string_view{argv[1]} : std::string_view{}};
+	todds::dds::initialize_encoding(todds::format::type::bc7, todds::format::type::bc3);
+	constexpr std::size_t pixels = image_width * image_height;
+	fmt::print("{:d}x{:d} RGBA images, at least {:d} ms per kernel.\n", image_width, image_height, minimum_time.count());
+	fmt::print("{:<28s}{:>15s}{:>18s}{:>24s}\n", "Kernel", "Time", "Pixels", "Blocks");
+
+	// Rows arriving from the PNG decoder are copied as they are or rearranged into pixel blocks.
+	const auto rows_image = make_image(todds::pixel_layout::rows, true);
+	const auto blocks_image = make_image(todds::pixel_layout::blocks, true);
+	todds::vector<std::uint8_t> row(image_width * todds::image::bytes_per_pixel);
+	for (const auto layout : {todds::pixel_layout::rows, todds::pixel_layout::blocks}) {
+		const bool blocks = layout == todds::pixel_layout::blocks;
+		auto& target = blocks ? blocks_image->get_image(0UL) : rows_image->get_image(0UL);
+		runner.run(blocks ? "write_row blocks" : "write_row rows", pixels, [&target, &row] {
+			for (std::size_t pixel_y = 0UL; pixel_y < target.height(); ++pixel_y) { target.write_row(pixel_y, row); }
+		});
+	}
+	fill(rows_image->get_image(0UL), true);
+	fill(blocks_image->get_image(0UL), true);
+
+	// Encoding consumes its image, so each iteration also includes copying the image.
+	const todds::string png_name{"benchmark.png"};
+	const auto png_file = todds::png::encode(png_name, std::make_unique<todds::mipmap_image>(*rows_image));
+	runner.run("png encode", pixels, [&png_name, &rows_image] {
+		[[maybe_unused]] const auto result =
+			todds::png::encode(png_name, std::make_unique<todds::mipmap_image>(*rows_image));
+	});
+	for (const auto layout : {todds::pixel_layout::rows, todds::pixel_layout::blocks}) {
+		const bool blocks = layout == todds::pixel_layout::blocks;
+		runner.run(blocks ? "png decode blocks" : "png decode rows", pixels, [&png_name, &png_file, layout] {
+			std::size_t width{};
+			std::size_t height{};
+			[[maybe_unused]] const auto result =
+				todds::png::decode(0UL, png_name, png_file, false, false, width, height, false, layout);
+		});
+	}
+
+	// Mipmaps halve the size of the image, and scaling resizes it to 75%.
+	const auto& source = blocks_image->get_image(0UL);
+	todds::mipmap_image mipmap{0UL, image_width / 2UL, image_height / 2UL, false, todds::pixel_layout::blocks};
+	todds::mipmap_image scaled{
+		0UL, image_width * 3UL / 4UL, image_height * 3UL / 4UL, false, todds::pixel_layout::blocks};
+	for (const auto filter : all_filters) {
+		const auto filter_name = todds::filter::name(filter);
+		runner.run(fmt::format("resample mipmap {:s}", filter_name), pixels,
+			[&source, &mipmap, filter] { todds::resample::resample(source, mipmap.get_image(0UL), filter, 0.55); });
+		runner.run(fmt::format("resample scale {:s}", filter_name), pixels,
+			[&source, &scaled, filter] { todds::resample::resample(source, scaled.get_image(0UL), filter, 0.0); });
+	}
+
+	auto& alpha_image = blocks_image->get_image(0UL);
+	runner.run("alpha_coverage", pixels,
+		[&alpha_image] { [[maybe_unused]] const float coverage = todds::alpha_coverage(128U, alpha_image); });
+	const float coverage = todds::alpha_coverage(128U, alpha_image);
+	runner.run("scale_alpha_to_coverage", pixels,
+		[&alpha_image, coverage] { todds::scale_alpha_to_coverage(coverage, 128U, alpha_image); });
+	// Opaque images are the worst case, as every pixel must be checked.
+	const auto opaque_image = make_image(todds::pixel_layout::blocks, false);
+	runner.run("has_alpha", pixels,
+		[&opaque_image] { [[maybe_unused]] const bool alpha = todds::has_alpha(opaque_image->pixel_blocks()); });
+
+	const auto blocks = blocks_image->pixel_blocks();
+	todds::dds_image output(todds::dds::encoded_size(todds::format::type::bc7, blocks.size()));
+	for (auto quality = static_cast<unsigned int>(todds::format::quality::minimum);
+			 quality <= static_cast<unsigned int>(todds::format::quality::maximum); ++quality) {
+		const auto level = static_cast<todds::format::quality>(quality);
+		const auto params = todds::dds::bc7_encode_params(level);
+		const std::span<std::uint64_t> bc1_output{
+			output.data(), todds::dds::encoded_size(todds::format::type::bc1, blocks.size())};
+		runner.run(fmt::format("bc1_encode quality {:d}", quality), pixels,
+			[level, blocks, bc1_output] { todds::dds::bc1_encode(level, false, blocks, bc1_output); });
+		runner.run(fmt::format("bc3_encode quality {:d}", quality), pixels,
+			[level, blocks, &output] { todds::dds::bc3_encode(level, blocks, output); });
+		runner.run(fmt::format("bc7_encode quality {:d}", quality), pixels,
+			[&params, blocks, &output] { todds::dds::bc7_encode(params, blocks, output); });
+	}
+
+	runner.run("dds_header", 0UL, [] {
+		[[maybe_unused]] const auto header =
+			todds::dds::dds_header(todds::format::type::bc7, image_width, image_height, 12UL);
+	});
+
+	return 0;
+}
@@ -0,0 +1,737 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/format.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/pipeline.hpp"
+#include "todds/png.hpp"
+#include "todds/report.hpp"
+#include "todds/string.hpp"
+#include "todds/vector.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <fmt/format.h>
+#include <oneapi/tbb/info.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Encodes synthetic datasets with the whole pipeline for each combination of format, quality, number of NUMA nodes and
+// number of threads, and writes the throughput, scaling efficiency and time spent in each stage as JSON, to compare
+// results between commits. Datasets are generated deterministically, and files generated by a previous run are reused.
+//
+// It can also act as a regression gate. The hash of the encoded files of each run is compared against stored goldens,
+// and files per second are compared against the results of a previous run. Any difference makes it fail.
+//
+// Usage: todds_bench [--quick] [--output file.json] [--directory path] [--label text] [--datasets a,b]
+//                    [--formats bc1,bc7] [--qualities 0,6] [--nodes 1,2] [--threads 1,2,4] [--repeat n]
+//                    [--goldens goldens.txt] [--update-goldens] [--baseline previous.json] [--tolerance percent]
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+using todds::format::quality;
+using todds::format::type;
+
+// Encoders which may produce different output for the same input.
+#if defined(TODDS_ISPC)
+constexpr std::string_view encoder_backend{"ispc"};
+#else
+constexpr std::string_view encoder_backend{"cpp"};
+#endif // defined(TODDS_ISPC)
+
+// Kind of content of a synthetic image.
+enum class content {
+	// Small shape with a transparent background, or a tile without transparency.
+	sprite,
+	// Colored noise. With alpha, it contains cut-out holes.
+	albedo,
+	// Tangent space normals of a height field.
+	normal,
+	// Single channel data such as roughness or displacement.
+	grayscale,
+	// Smooth gradients with fine detail. With alpha, the alpha channel is a gradient.
+	photo,
+};
+
+struct image_spec {
+	std::string name;
+	std::size_t width;
+	std::size_t height;
+	content kind;
+	bool alpha;
+};
+
+struct dataset {
+	std::string_view name;
+	todds::vector<image_spec> images;
+	std::size_t pixels{};
+};
+
+struct configuration {
+	type format;
+	type alpha_format;
+	quality level;
+};
+
+constexpr std::array<std::string_view, 7UL> stage_names{
+	"load", "decode", "scale", "mipmap", "encode", "save", "stream"};
+
+struct run_result {
+	std::string_view dataset;
+	configuration settings;
+	std::size_t nodes;
+	std::size_t threads;
+	std::size_t files;
+	std::size_t pixels;
+	double seconds;
+	// Busy time of every thread in each stage.
+	std::array<double, stage_names.size()> stage_seconds;
+	std::size_t errors;
+	// Hash of every encoded file.
+	std::uint64_t hash;
+	double scaling_efficiency{};
+	// Speedup relative to the smallest number of nodes using the same number of threads.
+	double node_speedup{};
+};
+
+struct options {
+	bool quick{};
+	fs::path output{"todds_bench.json"};
+	fs::path directory{fs::temp_directory_path() / "todds_bench"};
+	todds::string label{};
+	todds::vector<std::string> datasets{};
+	todds::vector<configuration> configurations{};
+	// Defaults to every NUMA node.
+	todds::vector<std::size_t> nodes{};
+	todds::vector<std::size_t> threads{};
+	std::size_t repeat{1UL};
+	fs::path goldens{};
+	bool update_goldens{};
+	fs::path baseline{};
+	// Maximum decrease of files per second compared to the baseline, as a percentage.
+	std::size_t tolerance{10UL};
+};
+
+// Deterministic hash of a lattice point.
+std::uint32_t hash(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t seed) noexcept {
+	std::uint32_t value = pos_x * 0x8DA6B343U ^ pos_y * 0xD8163841U ^ seed * 0xCB1AB31FU;
+	value ^= value >> 13U;
+	value *= 0x5BD1E995U;
+	value ^= value >> 15U;
+	return value;
+}
+
+double lattice(std::uint32_t pos_x, std::uint32_t pos_y, std::uint32_t seed) noexcept {
+	return static_cast<double>(hash(pos_x, pos_y, seed) & 0xFFFFU) / 65535.0;
+}
+
+// Value noise in [0, 1], interpolated between lattice points separated by cell pixels.
+double value_noise(std::size_t pos_x, std::size_t pos_y, std::size_t cell, std::uint32_t seed) noexcept {
+	const auto cell_x = static_cast<std::uint32_t>(pos_x / cell);
+	const auto cell_y = static_cast<std::uint32_t>(pos_y / cell);
+	const double weight_x = static_cast<double>(pos_x % cell) / static_cast<double>(cell);
+	const double weight_y = static_cast<double>(pos_y % cell) / static_cast<double>(cell);
+	const double top = std::lerp(lattice(cell_x, cell_y, seed), lattice(cell_x + 1U, cell_y, seed), weight_x);
+	const double bottom =
+		std::lerp(lattice(cell_x, cell_y + 1U, seed), lattice(cell_x + 1U, cell_y + 1U, seed), weight_x);
+	return std::lerp(top, bottom, weight_y);
+}
+
+// Sum of three octaves of value noise, in [0, 1].
+double height(std::size_t pos_x, std::size_t pos_y, std::uint32_t seed) noexcept {
+	return value_noise(pos_x, pos_y, 64UL, seed) * 0.6 + value_noise(pos_x, pos_y, 16UL, seed + 1U) * 0.3 +
+				 value_noise(pos_x, pos_y, 4UL, seed + 2U) * 0.1;
+}
+
+std::uint8_t to_byte(double value) noexcept {
+	return static_cast<std::uint8_t>(std::clamp(value, 0.0, 1.0) * 255.0 + 0.5);
+}
+
+void generate_pixel(const image_spec& spec, std::uint32_t seed, std::size_t pos_x, std::size_t pos_y,
+	std::span<std::uint8_t, todds::image::bytes_per_pixel> pixel) {
+	const double detail = height(pos_x, pos_y, seed);
+	pixel[3] = std::numeric_limits<std::uint8_t>::max();
+	switch (spec.kind) {
+	case content::sprite: {
+		const double half_width = static_cast<double>(spec.width) / 2.0;
+		const double half_height = static_cast<double>(spec.height) / 2.0;
+		const double distance = std::hypot((static_cast<double>(pos_x) + 0.5 - half_width) / half_width,
+			(static_cast<double>(pos_y) + 0.5 - half_height) / half_height);
+		pixel[0] = to_byte(lattice(seed, 0U, 0U) * 0.7 + detail * 0.3);
+		pixel[1] = to_byte(lattice(seed, 1U, 0U) * 0.7 + detail * 0.3);
+		pixel[2] = to_byte(lattice(seed, 2U, 0U) * 0.7 + (1.0 - distance) * 0.3);
+		if (spec.alpha) { pixel[3] = to_byte((1.0 - distance) * 8.0); }
+		break;
+	}
+	case content::albedo:
+		pixel[0] = to_byte(0.3 + detail * 0.5);
+		pixel[1] = to_byte(0.2 + detail * 0.4);
+		pixel[2] = to_byte(0.1 + value_noise(pos_x, pos_y, 32UL, seed + 3U) * 0.3);
+		if (spec.alpha) { pixel[3] = detail > 0.35 ? std::uint8_t{255U} : std::uint8_t{0U}; }
+		break;
+	case content::normal: {
+		const double slope_x = height(pos_x + 1UL, pos_y, seed) - height(pos_x > 0UL ? pos_x - 1UL : 0UL, pos_y, seed);
+		const double slope_y = height(pos_x, pos_y + 1UL, seed) - height(pos_x, pos_y > 0UL ? pos_y - 1UL : 0UL, seed);
+		const double length = std::sqrt(slope_x * slope_x * 64.0 + slope_y * slope_y * 64.0 + 1.0);
+		pixel[0] = to_byte(0.5 - slope_x * 4.0 / length);
+		pixel[1] = to_byte(0.5 - slope_y * 4.0 / length);
+		pixel[2] = to_byte(0.5 + 0.5 / length);
+		break;
+	}
+	case content::grayscale: pixel[0] = pixel[1] = pixel[2] = to_byte(detail); break;
+	case content::photo: {
+		const double horizontal = static_cast<double>(pos_x) / static_cast<double>(spec.width);
+		const double vertical = static_cast<double>(pos_y) / static_cast<double>(spec.height);
+		pixel[0] = to_byte(horizontal * 0.8 + detail * 0.2);
+		pixel[1] = to_byte(vertical * 0.8 + detail * 0.2);
+		pixel[2] = to_byte((1.0 - horizontal) * 0.5 + value_noise(pos_x, pos_y, 2UL, seed) * 0.2);
+		if (spec.alpha) { pixel[3] = to_byte(vertical); }
+		break;
+	}
+	}
+}
+
+// Writes the image as a PNG file, unless a previous run already generated it.
+void generate_image(const image_spec& spec, std::uint32_t seed, const fs::path& path) {
+	if (fs::exists(path)) { return; }
+	auto image = std::make_unique<todds::mipmap_image>(0UL, spec.width, spec.height, false);
+	auto& level = image->get_image(0UL);
+	for (std::size_t pos_y = 0UL; pos_y < spec.height; ++pos_y) {
+		for (std::size_t pos_x = 0UL; pos_x < spec.width; ++pos_x) {
+			generate_pixel(spec, seed, pos_x, pos_y, level.get_pixel(pos_x, pos_y));
+		}
+	}
+
+	const auto buffer = todds::png::encode(todds::string{path.string()}, std::move(image));
+	const fs::path temporary = path.string() + ".tmp";
+	{
+		boost::nowide::ofstream output{temporary, std::ios::out | std::ios::binary};
+		output.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+	}
+	fs::rename(temporary, path);
+}
+
+// Many tiny sprites, mid-size textures, 2K PBR sets and a few 8K images, following the datasets of ANALYSIS.md.
+todds::vector<dataset> get_datasets(bool quick) {
+	todds::vector<dataset> result;
+	const std::size_t divisor = quick ? 8UL : 1UL;
+
+	auto& sprites = result.emplace_back(dataset{"sprites", {}});
+	for (std::size_t index = 0UL; index < 2048UL / divisor; ++index) {
+		sprites.images.push_back({fmt::format("sprite_{:04d}", index), 32UL, 32UL, content::sprite, index % 2UL == 0UL});
+	}
+
+	auto& textures = result.emplace_back(dataset{"textures", {}});
+	constexpr std::array<std::array<std::size_t, 2UL>, 6UL> texture_sizes{
+		{{128UL, 128UL}, {256UL, 256UL}, {512UL, 512UL}, {1024UL, 1024UL}, {1024UL, 512UL}, {256UL, 128UL}}};
+	for (std::size_t index = 0UL; index < 96UL / divisor; ++index) {
+		const auto& size = texture_sizes[index % texture_sizes.size()];
+		textures.images.push_back(
+			{fmt::format("texture_{:03d}", index), size[0], size[1], content::albedo, index % 3UL == 0UL});
+	}
+
+	auto& pbr = result.emplace_back(dataset{"pbr_2k", {}});
+	for (std::size_t index = 0UL; index < 12UL / divisor + 1UL; ++index) {
+		const bool alpha = index % 2UL == 0UL;
+		pbr.images.push_back({fmt::format("pbr_{:02d}_albedo", index), 2048UL, 2048UL, content::albedo, alpha});
+		pbr.images.push_back({fmt::format("pbr_{:02d}_normal", index), 2048UL, 2048UL, content::normal, false});
+		pbr.images.push_back({fmt::format("pbr_{:02d}_roughness", index), 2048UL, 2048UL, content::grayscale, false});
+		pbr.images.push_back({fmt::format("pbr_{:02d}_displacement", index), 2048UL, 2048UL, content::grayscale, false});
+	}
+
+	if (!quick) {
+		auto& huge = result.emplace_back(dataset{"8k", {}});
+		huge.images.push_back({"photo_opaque", 8192UL, 8192UL, content::photo, false});
+		huge.images.push_back({"photo_alpha", 8192UL, 8192UL, content::photo, true});
+		huge.images.push_back({"normal", 8192UL, 8192UL, content::normal, false});
+	}
+
+	for (auto& current : result) {
+		for (const auto& spec : current.images) { current.pixels += spec.width * spec.height; }
+	}
+	return result;
+}
+
+// Adds the time spent in each stage by each file of a report written in CSV format.
+std::array<double, stage_names.size()> read_stage_seconds(const fs::path& report) {
+	std::array<double, stage_names.size()> result{};
+	boost::nowide::ifstream input{report};
+	std::string line;
+	if (!std::getline(input, line)) { return result; }
+
+	// Each column of the header, after the path of the file, is matched to a stage or ignored.
+	todds::vector<std::size_t> columns;
+	std::size_t start = line.find(',') + 1UL;
+	while (start != 0UL && start <= line.size()) {
+		const std::size_t end = std::min(line.find(',', start), line.size());
+		const std::string_view field = std::string_view{line}.substr(start, end - start);
+		const auto stage = std::find_if(stage_names.begin(), stage_names.end(),
+			[field](std::string_view name) { return field == fmt::format("{:s}_ms", name); });
+		columns.push_back(static_cast<std::size_t>(stage - stage_names.begin()));
+		start = end + 1UL;
+	}
+
+	while (std::getline(input, line)) {
+		// Quotes inside of paths are doubled, so the path ends at the first quote followed by a comma.
+		std::size_t position = line.find("\",") + 2UL;
+		for (const std::size_t column : columns) {
+			const std::size_t end = std::min(line.find(',', position), line.size());
+			// from_chars does not support floating-point values on every standard library.
+			if (column < stage_names.size()) { result[column] += std::stod(line.substr(position, end - position)) / 1000.0; }
+			position = end + 1UL;
+		}
+	}
+	return result;
+}
+
+// FNV-1a hash of the contents of every encoded file of the dataset, in order. Missing files change the hash.
+std::uint64_t hash_outputs(const dataset& current, const fs::path& output_directory) {
+	constexpr std::uint64_t fnv_prime = 0x100000001B3ULL;
+	std::uint64_t result = 0xCBF29CE484222325ULL;
+	const auto add = [&result](std::uint8_t value) noexcept { result = (result ^ value) * fnv_prime; };
+
+	std::string contents;
+	for (const auto& spec : current.images) {
+		boost::nowide::ifstream input{output_directory / (spec.name + ".dds"), std::ios::in | std::ios::binary};
+		contents.assign(std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{});
+		for (const char character : contents) { add(static_cast<std::uint8_t>(character)); }
+		// The size separates the contents of consecutive files.
+		for (std::size_t shift = 0UL; shift < 64UL; shift += 8UL) {
+			add(static_cast<std::uint8_t>(static_cast<std::uint64_t>(contents.size()) >> shift));
+		}
+	}
+	return result;
+}
+
+run_result run_pipeline(const dataset& current, const fs::path& directory, const configuration& settings,
+	std::size_t nodes, std::size_t threads) {
+	const fs::path input_directory = directory / std::string{current.name};
+	const fs::path output_directory = directory / "output" / std::string{current.name};
+	// Files left by previous runs must not be hashed if their encoding fails.
+	fs::remove_all(output_directory);
+	fs::create_directories(output_directory);
+
+	todds::pipeline::input input_data{};
+	input_data.parallelism = threads;
+	input_data.numa_nodes = nodes;
+	input_data.mipmaps = true;
+	input_data.format = settings.format;
+	input_data.alpha_format = settings.alpha_format;
+	input_data.quality = settings.level;
+	input_data.mipmap_filter = todds::filter::type::lanczos;
+	input_data.mipmap_blur = 0.55;
+	input_data.scale = 100U;
+	input_data.scale_filter = todds::filter::type::lanczos;
+	input_data.report_file = directory / "output" / "files.csv";
+	for (const auto& spec : current.images) {
+		input_data.paths.emplace_back(input_directory / (spec.name + ".png"), output_directory / (spec.name + ".dds"));
+	}
+
+	std::atomic<bool> force_finish{};
+	todds::report_queue updates;
+	const auto start = std::chrono::steady_clock::now();
+	todds::pipeline::encode_as_dds(input_data, force_finish, updates);
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::size_t errors{};
+	todds::report update;
+	while (updates.try_pop(update)) {
+		if (update.type() != todds::report_type::pipeline_error) { continue; }
+		fmt::print(stderr, "{:s}\n", update.data());
+		++errors;
+	}
+
+	return {current.name, settings, nodes, threads, current.images.size(), current.pixels, elapsed.count(),
+		read_stage_seconds(input_data.report_file), errors, hash_outputs(current, output_directory)};
+}
+
+todds::string quality_text(quality level) {
+	return todds::string{fmt::format("{:d}", static_cast<unsigned int>(level))};
+}
+
+todds::string json_string(std::string_view text) {
+	todds::string result{'"'};
+	for (const char character : text) {
+		if (character == '"' || character == '\\') { result += '\\'; }
+		result += character;
+	}
+	result += '"';
+	return result;
+}
+
+todds::string to_json(const options& settings, const todds::vector<dataset>& datasets,
+	const todds::vector<run_result>& results) {
+	constexpr double pixels_per_megapixel = 1.0e6;
+	todds::string text = "{\n";
+#if defined(NDEBUG)
+	constexpr bool debug_build = false;
+#else
+	constexpr bool debug_build = true;
+#endif
+	text += fmt::format("  \"label\": {:s},\n  \"debug_build\": {:s},\n  \"quick\": {:s},\n  \"backend\": {:s},\n"
+											"  \"hardware_threads\": {:d},\n",
+		json_string(settings.label), debug_build ? "true" : "false", settings.quick ? "true" : "false",
+		json_string(encoder_backend), oneapi::tbb::info::default_concurrency());
+
+	text += "  \"datasets\": [";
+	for (std::size_t index = 0UL; index < datasets.size(); ++index) {
+		const auto& current = datasets[index];
+		text += fmt::format("{:s}\n    {{\"name\": {:s}, \"files\": {:d}, \"megapixels\": {:.3f}}}", index > 0UL ? "," : "",
+			json_string(current.name), current.images.size(),
+			static_cast<double>(current.pixels) / pixels_per_megapixel);
+	}
+	text += "\n  ],\n  \"runs\": [";
+
+	for (std::size_t index = 0UL; index < results.size(); ++index) {
+		const auto& result = results[index];
+		text += fmt::format("{:s}\n    {{\"dataset\": {:s}, \"format\": {:s}, \"alpha_format\": {:s}, \"quality\": {:s}, "
+												"\"nodes\": {:d}, \"threads\": {:d}, \"seconds\": {:.4f}, \"files_per_second\": {:.3f}, "
+												"\"megapixels_per_second\": {:.3f}, \"scaling_efficiency\": {:.3f}, \"node_speedup\": {:.3f}, "
+												"\"errors\": {:d}, \"hash\": \"{:016x}\", \"stage_seconds\": {{",
+			index > 0UL ? "," : "", json_string(result.dataset), json_string(todds::format::name(result.settings.format)),
+			json_string(todds::format::name(result.settings.alpha_format)), quality_text(result.settings.level),
+			result.nodes, result.threads, result.seconds, static_cast<double>(result.files) / result.seconds,
+			static_cast<double>(result.pixels) / pixels_per_megapixel / result.seconds, result.scaling_efficiency,
+			result.node_speedup, result.errors, result.hash);
+		for (std::size_t stage = 0UL; stage < stage_names.size(); ++stage) {
+			text += fmt::format(
+				"{:s}{:s}: {:.4f}", stage > 0UL ? ", " : "", json_string(stage_names[stage]), result.stage_seconds[stage]);
+		}
+		text += "}}";
+	}
+	text += "\n  ]\n}\n";
+	return text;
+}
+
+todds::vector<std::string_view> split(std::string_view text) {
+	todds::vector<std::string_view> result;
+	while (!text.empty()) {
+		const std::size_t end = std::min(text.find(','), text.size());
+		result.push_back(text.substr(0UL, end));
+		text.remove_prefix(std::min(end + 1UL, text.size()));
+	}
+	return result;
+}
+
+std::size_t to_number(std::string_view text) {
+	std::size_t value{};
+	const auto [_, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (error != std::errc{}) { throw std::invalid_argument{fmt::format("{:s} is not a number", text)}; }
+	return value;
+}
+
+// BC1 files with alpha are encoded as BC3, as recommended for users of todds.
+configuration to_configuration(std::string_view name, quality level) {
+	if (name == "bc1") { return {type::bc1, type::bc3, level}; }
+	if (name == "bc3") { return {type::bc3, type::invalid, level}; }
+	if (name == "bc7") { return {type::bc7, type::invalid, level}; }
+	throw std::invalid_argument{fmt::format("Unsupported format {:s}", name)};
+}
+
+options parse_options(int argc, char** argv) {
+	options result{};
+	todds::vector<std::string_view> formats{"bc1", "bc7"};
+	todds::vector<std::string_view> qualities{"0"};
+	for (int index = 1; index < argc; ++index) {
+		const std::string_view argument{argv[index]};
+		if (argument == "--quick") {
+			result.quick = true;
+			continue;
+		}
+		if (argument == "--update-goldens") {
+			result.update_goldens = true;
+			continue;
+		}
+		if (index + 1 >= argc) { throw std::invalid_argument{fmt::format("Missing value for {:s}", argument)}; }
+		const std::string_view value{argv[++index]};
+		if (argument == "--output") {
+			result.output = std::string{value};
+		} else if (argument == "--directory") {
+			result.directory = std::string{value};
+		} else if (argument == "--label") {
+			result.label = value;
+		} else if (argument == "--datasets") {
+			for (const auto name : split(value)) { result.datasets.emplace_back(name); }
+		} else if (argument == "--formats") {
+			formats = split(value);
+		} else if (argument == "--qualities") {
+			qualities = split(value);
+		} else if (argument == "--nodes") {
+			for (const auto nodes : split(value)) { result.nodes.push_back(to_number(nodes)); }
+		} else if (argument == "--threads") {
+			for (const auto threads : split(value)) { result.threads.push_back(std::max(to_number(threads), 1UL)); }
+		} else if (argument == "--repeat") {
+			result.repeat = std::max(to_number(value), 1UL);
+		} else if (argument == "--goldens") {
+			result.goldens = std::string{value};
+		} else if (argument == "--baseline") {
+			result.baseline = std::string{value};
+		} else if (argument == "--tolerance") {
+			result.tolerance = std::min(to_number(value), 100UL);
+		} else {
+			throw std::invalid_argument{fmt::format("Unknown argument {:s}", argument)};
+		}
+	}
+
+	for (const auto format : formats) {
+		for (const auto level : qualities) {
+			const std::size_t number = std::min(to_number(level), static_cast<std::size_t>(quality::maximum));
+			result.configurations.push_back(to_configuration(format, static_cast<quality>(number)));
+		}
+	}
+
+	// Nodes which are not available are clamped to the number of nodes of the system.
+	const std::size_t system_nodes = todds::pipeline::numa_node_count();
+	if (result.nodes.empty()) { result.nodes.push_back(system_nodes); }
+	for (std::size_t& nodes : result.nodes) { nodes = std::clamp(nodes, 1UL, system_nodes); }
+	std::sort(result.nodes.begin(), result.nodes.end());
+	result.nodes.erase(std::unique(result.nodes.begin(), result.nodes.end()), result.nodes.end());
+
+	// Powers of two up to every hardware thread.
+	if (result.threads.empty()) {
+		const auto hardware_threads = static_cast<std::size_t>(oneapi::tbb::info::default_concurrency());
+		for (std::size_t threads = 1UL; threads < hardware_threads; threads *= 2UL) { result.threads.push_back(threads); }
+		result.threads.push_back(hardware_threads);
+	}
+	std::sort(result.threads.begin(), result.threads.end());
+	result.threads.erase(std::unique(result.threads.begin(), result.threads.end()), result.threads.end());
+	return result;
+}
+
+// Identifies the encoded files of a dataset, which only depend on the encoder and not on the number of threads.
+todds::string golden_key(bool quick, const run_result& result) {
+	return todds::string{fmt::format("{:s} {:s} {:s} {:s} {:s}", quick ? "quick" : "full", result.dataset,
+		todds::format::name(result.settings.format), quality_text(result.settings.level), encoder_backend)};
+}
+
+// Each line of a goldens file contains a key followed by the hash of the encoded files. Lines starting with # are
+// comments. A missing file has no goldens.
+std::map<todds::string, todds::string> read_goldens(const fs::path& path) {
+	std::map<todds::string, todds::string> result;
+	boost::nowide::ifstream input{path};
+	std::string line;
+	while (std::getline(input, line)) {
+		const std::size_t separator = line.rfind(' ');
+		if (line.empty() || line.front() == '#' || separator == std::string::npos) { continue; }
+		const std::string_view text{line};
+		result.emplace(todds::string{text.substr(0UL, separator)}, todds::string{text.substr(separator + 1UL)});
+	}
+	return result;
+}
+
+bool write_goldens(const fs::path& path, const std::map<todds::string, todds::string>& goldens) {
+	boost::nowide::ofstream output{path, std::ios::out};
+	output << "# Hashes of the files encoded by todds_bench. Update them with --update-goldens.\n"
+						"# corpus dataset format quality backend hash\n";
+	for (const auto& [key, hash] : goldens) { output << key << ' ' << hash << '\n'; }
+	return static_cast<bool>(output);
+}
+
+// Raw value of a field in a line of JSON written by todds_bench, without quotes.
+std::string_view json_value(std::string_view line, std::string_view name) {
+	const todds::string pattern{fmt::format("\"{:s}\": ", name)};
+	const std::size_t start = line.find(pattern);
+	if (start == std::string_view::npos) { return {}; }
+	std::string_view value = line.substr(start + pattern.size());
+	value = value.substr(0UL, std::min(value.find_first_of(",}"), value.size()));
+	if (value.size() >= 2UL && value.front() == '"') { value = value.substr(1UL, value.size() - 2UL); }
+	return value;
+}
+
+todds::string baseline_key(std::string_view dataset, std::string_view format, std::string_view level,
+	std::string_view nodes, std::string_view threads) {
+	return todds::string{fmt::format("{:s} {:s} {:s} {:s} {:s}", dataset, format, level, nodes, threads)};
+}
+
+// Files per second of each run of a previous todds_bench result file, which must have used the same corpus. Results
+// written before the number of nodes was measured used every node.
+std::map<todds::string, double> read_baseline(const fs::path& path, bool quick) {
+	const todds::string system_nodes{fmt::format("{:d}", todds::pipeline::numa_node_count())};
+	boost::nowide::ifstream input{path};
+	if (!input) { throw std::invalid_argument{fmt::format("Could not read {:s}", path.string())}; }
+	std::map<todds::string, double> result;
+	std::string line;
+	while (std::getline(input, line)) {
+		if (const auto corpus = json_value(line, "quick"); !corpus.empty() && (corpus == "true") != quick) {
+			throw std::invalid_argument{fmt::format("{:s} was generated with a different --quick value", path.string())};
+		}
+		const auto files_per_second = json_value(line, "files_per_second");
+		if (files_per_second.empty()) { continue; }
+		const auto nodes = json_value(line, "nodes");
+		const todds::string key = baseline_key(json_value(line, "dataset"), json_value(line, "format"),
+			json_value(line, "quality"), nodes.empty() ? system_nodes : nodes, json_value(line, "threads"));
+		result.emplace(key, std::stod(std::string{files_per_second}));
+	}
+	return result;
+}
+
+// Compares the results against the goldens and the baseline, and returns the number of failures. Goldens are replaced
+// by the current hashes when they are being updated.
+std::size_t check_results(const options& settings, const todds::vector<run_result>& results) {
+	std::size_t failures{};
+	for (const auto& result : results) {
+		if (result.errors == 0UL) { continue; }
+		fmt::print(stderr, "FAIL {:s}: {:d} errors\n", golden_key(settings.quick, result), result.errors);
+		++failures;
+	}
+
+	if (!settings.goldens.empty()) {
+		auto goldens = read_goldens(settings.goldens);
+		std::map<todds::string, todds::string> current;
+		for (const auto& result : results) {
+			const todds::string key = golden_key(settings.quick, result);
+			const todds::string hash{fmt::format("{:016x}", result.hash)};
+			// Each file is encoded by a single thread, so the output must not depend on the number of threads.
+			if (const auto [found, inserted] = current.emplace(key, hash); !inserted && found->second != hash) {
+				fmt::print(stderr, "FAIL {:s}: output with {:d} threads differs\n", key, result.threads);
+				++failures;
+			}
+		}
+
+		for (const auto& [key, hash] : current) {
+			const auto golden = goldens.find(key);
+			if (settings.update_goldens) {
+				goldens[key] = hash;
+			} else if (golden == goldens.end()) {
+				fmt::print(stderr, "FAIL {:s}: no golden hash, use --update-goldens to store it\n", key);
+				++failures;
+			} else if (golden->second != hash) {
+				fmt::print(stderr, "FAIL {:s}: hash {:s} differs from golden {:s}\n", key, hash, golden->second);
+				++failures;
+			}
+		}
+
+		if (settings.update_goldens) {
+			if (!write_goldens(settings.goldens, goldens)) {
+				fmt::print(stderr, "Could not write {:s}\n", settings.goldens.string());
+				++failures;
+			} else {
+				fmt::print("Goldens written to {:s}.\n", settings.goldens.string());
+			}
+		}
+	}
+
+	if (!settings.baseline.empty()) {
+		const auto baseline = read_baseline(settings.baseline, settings.quick);
+		const double minimum_ratio = static_cast<double>(100UL - settings.tolerance) / 100.0;
+		for (const auto& result : results) {
+			const auto previous = baseline.find(baseline_key(result.dataset, todds::format::name(result.settings.format),
+				quality_text(result.settings.level), fmt::format("{:d}", result.nodes), fmt::format("{:d}", result.threads)));
+			// Runs which were not measured by the baseline cannot regress.
+			if (previous == baseline.end()) { continue; }
+			const double files_per_second = static_cast<double>(result.files) / result.seconds;
+			if (files_per_second >= previous->second * minimum_ratio) { continue; }
+			fmt::print(stderr, "FAIL {:s} with {:d} nodes and {:d} threads: {:.1f} files/s, baseline {:.1f} files/s\n",
+				golden_key(settings.quick, result), result.nodes, result.threads, files_per_second, previous->second);
+			++failures;
+		}
+	}
+	return failures;
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+#if !defined(NDEBUG)
+	fmt::print("Debug builds poison every allocated buffer. Use a release build for meaningful results.\n");
+#endif
+	options settings;
+	try {
+		settings = parse_options(argc, argv);
+	} catch (const std::invalid_argument& exception) {
+		fmt::print(stderr, "{:s}\n", exception.what());
+		return 1;
+	}
+
+	auto datasets = get_datasets(settings.quick);
+	if (!settings.datasets.empty()) {
+		std::erase_if(datasets, [&settings](const dataset& current) {
+			return std::find(settings.datasets.begin(), settings.datasets.end(), current.name) == settings.datasets.end();
+		});
+	}
+
+	for (const auto& current : datasets) {
+		fmt::print("Generating {:s}: {:d} files, {:.1f} megapixels.\n", current.name, current.images.size(),
+			static_cast<double>(current.pixels) / 1.0e6);
+		const fs::path dataset_directory = settings.directory / std::string{current.name};
+		fs::create_directories(dataset_directory);
+		for (std::size_t index = 0UL; index < current.images.size(); ++index) {
+			const auto& spec = current.images[index];
+			generate_image(spec, static_cast<std::uint32_t>(index), dataset_directory / (spec.name + ".png"));
+		}
+	}
+
+	todds::vector<run_result> results;
+	fmt::print("{:<10s}{:<8s}{:>8s}{:>7s}{:>9s}{:>11s}{:>10s}{:>9s}{:>12s}{:>14s}\n", "Dataset", "Format", "Quality",
+		"Nodes", "Threads", "Seconds", "Files/s", "MP/s", "Efficiency", "Node speedup");
+	for (const auto& current : datasets) {
+		for (const auto& configuration : settings.configurations) {
+			const std::size_t first_node = results.size();
+			for (const std::size_t nodes : settings.nodes) {
+				const std::size_t baseline = results.size();
+				for (std::size_t thread_index = 0UL; thread_index < settings.threads.size(); ++thread_index) {
+					const std::size_t threads = settings.threads[thread_index];
+					// The fastest repetition is kept, as it is the least affected by other processes.
+					run_result best = run_pipeline(current, settings.directory, configuration, nodes, threads);
+					for (std::size_t repetition = 1UL; repetition < settings.repeat; ++repetition) {
+						auto result = run_pipeline(current, settings.directory, configuration, nodes, threads);
+						if (result.seconds < best.seconds) { best = result; }
+					}
+
+					// Speedup relative to the smallest number of threads, divided by the increase in threads.
+					const auto& first = results.size() > baseline ? results[baseline] : best;
+					best.scaling_efficiency = (first.seconds / best.seconds) /
+																		(static_cast<double>(best.threads) / static_cast<double>(first.threads));
+					// Runs of the smallest number of nodes come first, in the same order of threads.
+					const auto& same_threads = baseline > first_node ? results[first_node + thread_index] : best;
+					best.node_speedup = same_threads.seconds / best.seconds;
+					fmt::print("{:<10s}{:<8s}{:>8s}{:>7d}{:>9d}{:>11.3f}{:>10.1f}{:>9.1f}{:>11.1f}%{:>13.2f}x\n", current.name,
+						todds::format::name(configuration.format), quality_text(configuration.level), nodes, threads,
+						best.seconds, static_cast<double>(best.files) / best.seconds,
+						static_cast<double>(best.pixels) / 1.0e6 / best.seconds, best.scaling_efficiency * 100.0,
+						best.node_speedup);
+					results.push_back(best);
+				}
+			}
+		}
+	}
+
+	boost::nowide::ofstream output{settings.output, std::ios::out};
+	output << to_json(settings, datasets, results);
+	if (!output) {
+		fmt::print(stderr, "Could not write {:s}\n", settings.output.string());
+		return 1;
+	}
+	fmt::print("Results written to {:s}.\n", settings.output.string());
+
+	std::size_t failures{};
+	try {
+		failures = check_results(settings, results);
+	} catch (const std::invalid_argument& exception) {
+		fmt::print(stderr, "{:s}\n", exception.what());
+		return 1;
+	}
+	if (failures > 0UL) {
+		fmt::print(stderr, "{:d} checks failed.\n", failures);
+		return 1;
+	}
+	return 0;
+}
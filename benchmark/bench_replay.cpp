@@ -0,0 +1,270 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/alpha_coverage.hpp"
+#include "todds/capture.hpp"
+#include "todds/dds.hpp"
+#include "todds/filter.hpp"
+#include "todds/format.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/resample.hpp"
+#include "todds/vector.hpp"
+
+#include <fmt/format.h>
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/global_control.h>
+#include <oneapi/tbb/info.h>
+#include <oneapi/tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Replays a capture file written by todds with --capture, running only the chosen stages over every captured image
+// with every thread. Nothing is read from disk after mapping the capture file and encoded data is discarded, so the
+// results only depend on mipmap generation and DDS encoding. Mipmaps are generated before measuring encoding when the
+// mipmap stage is not chosen.
+//
+// Usage: todds_bench_replay capture_file [--stages mipmap,encode] [--format bc7] [--alpha-format bc3] [--quality 0]
+//                           [--filter lanczos] [--blur 0.55] [--no-mipmaps] [--threads n] [--repeat n]
+
+namespace {
+
+using todds::format::quality;
+using todds::format::type;
+
+constexpr double bytes_per_mebibyte = 1024.0 * 1024.0;
+
+struct options {
+	std::string capture_file{};
+	bool mipmap_stage{true};
+	bool encode_stage{true};
+	type format{type::bc7};
+	type alpha_format{type::invalid};
+	quality level{quality::minimum};
+	todds::filter::type mipmap_filter{todds::filter::type::lanczos};
+	double mipmap_blur{0.55};
+	bool mipmaps{true};
+	std::size_t threads{static_cast<std::size_t>(oneapi::tbb::info::default_concurrency())};
+	std::size_t repeat{1UL};
+};
+
+// Mipmap levels of a captured image. The main image is a view of the capture file.
+struct replayed_image {
+	todds::image main;
+	todds::vector<std::unique_ptr<todds::mipmap_image>> levels;
+	type format;
+};
+
+struct stage_result {
+	double seconds;
+	std::size_t pixels;
+};
+
+todds::pixel_block_image pixel_blocks(const todds::image& img) noexcept {
+	const auto data = img.data();
+	return {reinterpret_cast<const std::uint32_t*>(data.data()), data.size() / todds::image::bytes_per_pixel};
+}
+
+// Generates every mipmap level of each image from the previous one, as the DDS encoding filter of todds does.
+stage_result generate_mipmaps(todds::vector<replayed_image>& images, const options& settings) {
+	std::size_t pixels{};
+	for (auto& current : images) {
+		current.levels.clear();
+		pixels += current.main.width() * current.main.height();
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	oneapi::tbb::parallel_for(
+		oneapi::tbb::blocked_range<std::size_t>{0UL, images.size(), 1UL}, [&images, &settings](const auto& range) {
+			for (std::size_t index = range.begin(); index != range.end(); ++index) {
+				auto& current = images[index];
+				const std::size_t levels = todds::mipmap_levels(current.main.width(), current.main.height());
+				const todds::image* source = &current.main;
+				for (std::size_t level = 1UL; level < levels; ++level) {
+					auto& next = current.levels.emplace_back(std::make_unique<todds::mipmap_image>(0UL,
+						std::max(source->width() >> 1UL, 1UL), std::max(source->height() >> 1UL, 1UL), false,
+						todds::pixel_layout::blocks));
+					todds::resample::resample(*source, next->get_image(0UL), settings.mipmap_filter, settings.mipmap_blur);
+					source = &next->get_image(0UL);
+				}
+			}
+		});
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return {elapsed.count(), pixels};
+}
+
+// Encodes every level of each image as a separate task, as the DDS encoding filter of todds does.
+stage_result encode(const todds::vector<replayed_image>& images, const options& settings) {
+	struct task {
+		todds::pixel_block_image blocks;
+		type format;
+		todds::vector<std::uint64_t> output;
+	};
+
+	todds::vector<task> tasks;
+	std::size_t pixels{};
+	for (const auto& current : images) {
+		const auto add = [&tasks, &pixels, &current](const todds::image& img) {
+			const auto blocks = pixel_blocks(img);
+			tasks.push_back({blocks, current.format,
+				todds::vector<std::uint64_t>(todds::dds::encoded_size(current.format, blocks.size()))});
+			pixels += blocks.size();
+		};
+		add(current.main);
+		for (const auto& level : current.levels) { add(level->get_image(0UL)); }
+	}
+
+	const auto params = todds::dds::bc7_encode_params(settings.level);
+	const auto start = std::chrono::steady_clock::now();
+	oneapi::tbb::parallel_for(oneapi::tbb::blocked_range<std::size_t>{0UL, tasks.size(), 1UL},
+		[&tasks, &settings, &params](const auto& range) {
+			for (std::size_t index = range.begin(); index != range.end(); ++index) {
+				auto& current = tasks[index];
+				switch (current.format) {
+				case type::bc1: todds::dds::bc1_encode(settings.level, false, current.blocks, current.output); break;
+				case type::bc3: todds::dds::bc3_encode(settings.level, current.blocks, current.output); break;
+				case type::bc7: todds::dds::bc7_encode(params, current.blocks, current.output); break;
+				case type::png:
+				case type::invalid: break;
+				}
+			}
+		});
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return {elapsed.count(), pixels};
+}
+
+void print_result(std::string_view stage, std::size_t images, const stage_result& result) {
+	const auto pixels = static_cast<double>(result.pixels);
+	fmt::print("{:<8s}{:>11.3f}{:>10.1f}{:>9.1f}{:>11.1f}\n", stage, result.seconds,
+		static_cast<double>(images) / result.seconds, pixels / 1.0e6 / result.seconds,
+		pixels * todds::image::bytes_per_pixel / bytes_per_mebibyte / result.seconds);
+}
+
+std::size_t to_number(std::string_view text) {
+	std::size_t value{};
+	const auto [_, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (error != std::errc{}) { throw std::invalid_argument{fmt::format("{:s} is not a number", text)}; }
+	return value;
+}
+
+type to_format(std::string_view name) {
+	if (name == "bc1") { return type::bc1; }
+	if (name == "bc3") { return type::bc3; }
+	if (name == "bc7") { return type::bc7; }
+	throw std::invalid_argument{fmt::format("Unsupported format {:s}", name)};
+}
+
+todds::filter::type to_filter(std::string_view name) {
+	constexpr std::array<todds::filter::type, 5UL> filters{todds::filter::type::nearest, todds::filter::type::linear,
+		todds::filter::type::cubic, todds::filter::type::area, todds::filter::type::lanczos};
+	for (const auto filter : filters) {
+		std::string filter_name{todds::filter::name(filter)};
+		std::transform(filter_name.begin(), filter_name.end(), filter_name.begin(),
+			[](char character) { return static_cast<char>(std::tolower(character)); });
+		if (name == filter_name) { return filter; }
+	}
+	throw std::invalid_argument{fmt::format("Unsupported filter {:s}", name)};
+}
+
+options parse_options(int argc, char** argv) {
+	options result{};
+	for (int index = 1; index < argc; ++index) {
+		const std::string_view argument{argv[index]};
+		if (argument == "--no-mipmaps") {
+			result.mipmaps = false;
+			continue;
+		}
+		if (!argument.starts_with("--")) {
+			result.capture_file = argument;
+			continue;
+		}
+		if (index + 1 >= argc) { throw std::invalid_argument{fmt::format("Missing value for {:s}", argument)}; }
+		const std::string_view value{argv[++index]};
+		if (argument == "--stages") {
+			result.mipmap_stage = value.find("mipmap") != std::string_view::npos;
+			result.encode_stage = value.find("encode") != std::string_view::npos;
+		} else if (argument == "--format") {
+			result.format = to_format(value);
+		} else if (argument == "--alpha-format") {
+			result.alpha_format = to_format(value);
+		} else if (argument == "--quality") {
+			result.level = static_cast<quality>(std::min(to_number(value), static_cast<std::size_t>(quality::maximum)));
+		} else if (argument == "--filter") {
+			result.mipmap_filter = to_filter(value);
+		} else if (argument == "--blur") {
+			// from_chars does not support floating-point values on every standard library.
+			result.mipmap_blur = std::stod(std::string{value});
+		} else if (argument == "--threads") {
+			result.threads = std::max(to_number(value), 1UL);
+		} else if (argument == "--repeat") {
+			result.repeat = std::max(to_number(value), 1UL);
+		} else {
+			throw std::invalid_argument{fmt::format("Unknown argument {:s}", argument)};
+		}
+	}
+
+	if (result.capture_file.empty()) { throw std::invalid_argument{"Missing capture file"}; }
+	if (!result.mipmap_stage && !result.encode_stage) { throw std::invalid_argument{"No stages to replay"}; }
+	if (!result.mipmaps && !result.encode_stage) { throw std::invalid_argument{"The mipmap stage needs mipmaps"}; }
+	return result;
+}
+
+} // Anonymous namespace
+
+int main(int argc, char** argv) {
+#if !defined(NDEBUG)
+	fmt::print("Debug builds poison every allocated buffer. Use a release build for meaningful results.\n");
+#endif
+	try {
+		const options settings = parse_options(argc, argv);
+		const todds::capture::reader capture{settings.capture_file};
+		const oneapi::tbb::global_control control{oneapi::tbb::global_control::max_allowed_parallelism, settings.threads};
+		todds::dds::initialize_encoding(settings.format, settings.alpha_format);
+
+		// As in todds, the format of each image depends on the alpha of its main image.
+		todds::vector<replayed_image> images;
+		images.reserve(capture.size());
+		for (std::size_t index = 0UL; index < capture.size(); ++index) {
+			auto main = capture.get_image(index);
+			const bool alpha = settings.alpha_format != type::invalid && todds::has_alpha(pixel_blocks(main));
+			images.push_back({std::move(main), {}, alpha ? settings.alpha_format : settings.format});
+		}
+		fmt::print("{:d} images, {:d} threads.\n", images.size(), settings.threads);
+		fmt::print("{:<8s}{:>11s}{:>10s}{:>9s}{:>11s}\n", "Stage", "Seconds", "Images/s", "MP/s", "MiB/s");
+
+		// The fastest repetition is kept, as it is the least affected by other processes.
+		const auto fastest = [&settings](auto&& function) {
+			stage_result best = function();
+			for (std::size_t repetition = 1UL; repetition < settings.repeat; ++repetition) {
+				const stage_result result = function();
+				if (result.seconds < best.seconds) { best = result; }
+			}
+			return best;
+		};
+
+		if (settings.mipmaps && settings.mipmap_stage) {
+			print_result(
+				"mipmap", images.size(), fastest([&images, &settings] { return generate_mipmaps(images, settings); }));
+		} else if (settings.mipmaps) {
+			[[maybe_unused]] const stage_result unmeasured = generate_mipmaps(images, settings);
+		}
+		if (settings.encode_stage) {
+			print_result("encode", images.size(), fastest([&images, &settings] { return encode(images, settings); }));
+		}
+	} catch (const std::exception& exception) {
+		fmt::print(stderr, "{:s}\n", exception.what());
+		return 1;
+	}
+	return 0;
+}
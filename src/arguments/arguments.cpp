@@ -72,7 +72,9 @@ constexpr auto scale_filter_arg =
 	optional_arg{"--scale-filter", "-sf", "Filter used to scale images when using the scale or max_size parameters."};
 
 constexpr auto threads_arg = optional_arg{
-	"--threads", "-th", "Number of threads used by the parallel pipeline, must be in [1, {:d}]. Defaults to maximum."};
+	"--threads", "-th", "Number of threads used by the parallel pipeline, must be in [1, {:d}]. Defaults to maximum, or "
+	"to the CPU limit of the container. Threads are distributed between NUMA nodes, and each file is processed within "
+	"a single node."};
 
 constexpr std::size_t max_depth = std::numeric_limits<std::size_t>::max();
 constexpr auto depth_arg =
@@ -98,7 +100,8 @@ constexpr auto dry_run_arg =
 
 constexpr auto progress_arg = optional_argument("--progress", "Display progress messages.");
 
-constexpr auto verbose_arg = optional_argument("--verbose", "Display all input files of the current operation.");
+constexpr auto verbose_arg = optional_argument(
+	"--verbose", "Display all input files of the current operation, and memory statistics after encoding.");
 
 constexpr auto help_arg = optional_argument("--help", "Show usage information.");
 
@@ -110,6 +113,79 @@ constexpr auto alpha_black_arg = optional_arg{"--bc1-alpha-black", "-bc1-ab",
 constexpr auto report_arg =
 	optional_arg{"--report", "-rp", "Prints information about the encoding process of each file."};
 
+constexpr auto stream_threshold_arg = optional_arg{"--stream-threshold", "-st",
+	"Encode images with at least this many megapixels in bands of rows, using memory proportional to their width "
+	"instead of their area. Not used with --vflip, --scale or --max-size. Disabled by default."};
+
+constexpr auto huge_pages_arg = optional_arg{"--huge-pages", "-hp",
+	"Back large image buffers with 2 MiB pages, reducing the time spent translating memory addresses on big images. "
+	"Uses regular pages when the system does not provide huge pages."};
+
+constexpr auto background_arg = optional_arg{"--background", "-bg",
+	"Lower the CPU and I/O priority of the encoding threads, so they only use resources which are not needed by other "
+	"programs."};
+
+constexpr auto cpu_limit_arg = optional_arg{"--cpu-limit", "-cu",
+	"Keep the CPU usage of the encoding process below this percentage of the CPUs available to it, taking container "
+	"CPU quotas and cpusets into account, by waiting before processing each file. Must be in [1, 100]. Disabled by "
+	"default."};
+
+constexpr auto io_limit_arg = optional_arg{"--io-limit", "-il",
+	"Limit the speed of reading and writing files to this many MiB per second. Disabled by default."};
+
+constexpr auto stats_arg = optional_argument("--stats",
+	"After encoding, show the number of samples, total time, mean, percentiles and maximum duration and the bytes "
+	"processed of each stage of the pipeline. Also show the tokens in flight, the time that files wait between "
+	"filters, the idle time of the workers and the suggested number of tokens. Memory allocations, live bytes and "
+	"their peak are shown for images, blur rows, pixel blocks, DDS data, PNG files and paths.");
+
+constexpr auto stats_timeline_arg = optional_arg{"--stats-timeline", "-stl",
+	"Write the tokens in flight, the files being processed by each filter and the idle workers every 10 milliseconds to "
+	"this CSV file. Long runs are written with a lower resolution. Implies --stats."};
+
+constexpr auto trace_arg = optional_arg{"--trace", "-tr",
+	"Record when each thread loads, decodes, encodes and saves each file, down to each chunk of encoded blocks, and "
+	"write it to this JSON file. It can be opened with chrome://tracing or ui.perfetto.dev."};
+
+constexpr auto report_file_arg = optional_arg{"--report-file", "-rf",
+	"Write the sizes, stage durations, worker thread, solid blocks and total time of each file to this file as soon as "
+	"the file is saved. Uses CSV if the file ends in .csv, and JSON Lines otherwise."};
+
+constexpr auto error_metrics_arg = optional_arg{"--metrics", "-mt",
+	"Decode each DDS mipmap level right after encoding it, and add the RMSE and PSNR of each file and mipmap level, and "
+	"the RMSE of each channel, to --report-file. Alpha is only included in the totals of files using --alpha-format."};
+
+constexpr auto perf_counters_arg = optional_arg{"--perf-counters", "-pc",
+	"After encoding, show the cycles, instructions, cache misses, branch misses and AVX frequency licenses of each "
+	"stage and encoder. Only available on Linux, and it may require lowering /proc/sys/kernel/perf_event_paranoid."};
+
+constexpr auto metrics_file_arg = optional_arg{"--metrics-file", "-mtf",
+	"While encoding, periodically rewrite this file with the files encoded and failed, bytes read and written, busy "
+	"time of each stage, files in each filter, blocks encoded in each format and resident memory in Prometheus text "
+	"format."};
+
+constexpr std::uint32_t default_metrics_interval = 10U;
+
+constexpr auto metrics_interval_arg = optional_arg{"--metrics-interval", "-mti",
+	"Seconds between each rewrite of the metrics file. Must be at least 1. Defaults to 10."};
+
+constexpr auto capture_arg = optional_arg{"--capture", "-cap",
+	"Write the decoded image of each file to this capture file, which todds_bench_replay can use to measure mipmap "
+	"generation and DDS encoding without reading or decoding PNG files. Files encoded in bands are not captured."};
+
+constexpr auto sweep_arg = optional_arg{"--sweep", "-sw",
+	"Instead of saving DDS files, encode each file with every quality level up to --quality. Show the encoding time, "
+	"PSNR and SSIM of each level, and recommend the fastest level meeting --sweep-target. Files are decoded and their "
+	"mipmaps generated only once. Scaling is not applied. Results of each file are written to --report-file."};
+
+constexpr double default_sweep_target = 40.0;
+constexpr auto sweep_target_arg = optional_arg{"--sweep-target", "-swt",
+	"Minimum PSNR in dB that every file must reach for --sweep to recommend a quality level. Defaults to {:.1f}."};
+
+constexpr auto sweep_sample_arg = optional_arg{"--sweep-sample", "-sws",
+	"Percentage of the files used by --sweep, chosen evenly from the list of files. Must be in [1, 100]. Defaults to "
+	"100."};
+
 // Positional arguments.
 constexpr std::string_view input_name = "input";
 constexpr std::string_view input_help =
@@ -149,6 +225,23 @@ consteval std::size_t argument_name_total_space() {
 	max_space = std::max(max_space, help_arg.name.size() + help_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, alpha_black_arg.name.size() + alpha_black_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, report_arg.name.size() + report_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, stream_threshold_arg.name.size() + stream_threshold_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, huge_pages_arg.name.size() + huge_pages_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, background_arg.name.size() + background_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, cpu_limit_arg.name.size() + cpu_limit_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, io_limit_arg.name.size() + io_limit_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, stats_arg.name.size() + stats_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, stats_timeline_arg.name.size() + stats_timeline_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, trace_arg.name.size() + trace_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, perf_counters_arg.name.size() + perf_counters_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, report_file_arg.name.size() + report_file_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, error_metrics_arg.name.size() + error_metrics_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, metrics_file_arg.name.size() + metrics_file_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, metrics_interval_arg.name.size() + metrics_interval_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, capture_arg.name.size() + capture_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, sweep_arg.name.size() + sweep_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, sweep_target_arg.name.size() + sweep_target_arg.shorter.size() + 2UL);
+	max_space = std::max(max_space, sweep_sample_arg.name.size() + sweep_sample_arg.shorter.size() + 2UL);
 	max_space = std::max(max_space, input_name.size());
 	max_space = std::max(max_space, output_name.size());
 
@@ -180,7 +273,7 @@ void print_string_argument(std::ostringstream& ostream, std::string_view name, s
 }
 
 void print_filter_options(std::ostringstream& ostream, todds::filter::type default_value) {
-	const todds::string default_str = fmt::format("{:s} [Default]", todds::filter::description(default_value));
+	const todds::string default_str{fmt::format("{:s} [Default]", todds::filter::description(default_value))};
 	print_string_argument(ostream, todds::filter::name(default_value), default_str);
 
 	constexpr std::array<todds::filter::type, 5U> filter_types{
@@ -226,9 +319,9 @@ todds::string get_help(std::size_t max_threads) {
 	print_string_argument(
 		ostream, todds::format::name(todds::format::type::bc3), "Highly compressed data supporting alpha.");
 
-	const todds::string quality_help =
+	const todds::string quality_help{
 		fmt::format(quality_arg.help, static_cast<unsigned int>(todds::format::quality::minimum),
-			static_cast<unsigned int>(todds::format::quality::maximum), static_cast<unsigned int>(default_quality));
+			static_cast<unsigned int>(todds::format::quality::maximum), static_cast<unsigned int>(default_quality))};
 	print_argument_impl(ostream, quality_arg.shorter, quality_arg.name, quality_help);
 
 	print_optional_argument(ostream, no_mipmaps_arg);
@@ -238,7 +331,7 @@ todds::string get_help(std::size_t max_threads) {
 	print_optional_argument(ostream, mipmap_filter_arg);
 	print_filter_options(ostream, default_mipmap_filter);
 
-	const todds::string mipmap_blur_help = fmt::format(mipmap_blur_arg.help, default_mipmap_blur);
+	const todds::string mipmap_blur_help{fmt::format(mipmap_blur_arg.help, default_mipmap_blur)};
 	print_argument_impl(ostream, mipmap_blur_arg.shorter, mipmap_blur_arg.name, mipmap_blur_help);
 
 	print_optional_argument(ostream, scale_arg);
@@ -246,7 +339,7 @@ todds::string get_help(std::size_t max_threads) {
 	print_optional_argument(ostream, scale_filter_arg);
 	print_filter_options(ostream, default_scale_filter);
 
-	const todds::string threads_help = fmt::format(threads_arg.help, max_threads);
+	const todds::string threads_help{fmt::format(threads_arg.help, max_threads)};
 	print_argument_impl(ostream, threads_arg.shorter, threads_arg.name, threads_help);
 	print_optional_argument(ostream, depth_arg);
 	print_optional_argument(ostream, overwrite_arg);
@@ -266,8 +359,26 @@ todds::string get_help(std::size_t max_threads) {
 
 	print_optional_argument(ostream, alpha_black_arg);
 	print_optional_argument(ostream, report_arg);
-
-	return std::move(ostream).str();
+	print_optional_argument(ostream, stream_threshold_arg);
+	print_optional_argument(ostream, huge_pages_arg);
+	print_optional_argument(ostream, background_arg);
+	print_optional_argument(ostream, cpu_limit_arg);
+	print_optional_argument(ostream, io_limit_arg);
+	print_optional_argument(ostream, stats_arg);
+	print_optional_argument(ostream, stats_timeline_arg);
+	print_optional_argument(ostream, trace_arg);
+	print_optional_argument(ostream, perf_counters_arg);
+	print_optional_argument(ostream, report_file_arg);
+	print_optional_argument(ostream, error_metrics_arg);
+	print_optional_argument(ostream, metrics_file_arg);
+	print_optional_argument(ostream, metrics_interval_arg);
+	print_optional_argument(ostream, capture_arg);
+	print_optional_argument(ostream, sweep_arg);
+	const todds::string sweep_target_help{fmt::format(sweep_target_arg.help, default_sweep_target)};
+	print_argument_impl(ostream, sweep_target_arg.shorter, sweep_target_arg.name, sweep_target_help);
+	print_optional_argument(ostream, sweep_sample_arg);
+
+	return todds::string{ostream.view()};
 }
 
 /**
@@ -291,7 +402,7 @@ todds::format::type parse_format(std::string_view argument) {
 }
 
 void format_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
-	const todds::string argument_upper = todds::to_upper_copy(std::string{argument});
+	const todds::string argument_upper = todds::to_upper_copy(todds::string{argument});
 	const auto format = parse_format(argument_upper);
 	if (format != todds::format::type::invalid) {
 		parsed_arguments.format = format;
@@ -312,7 +423,7 @@ void format_from_str(std::string_view argument, todds::args::data& parsed_argume
 }
 
 void alpha_format_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
-	const todds::string argument_upper = todds::to_upper_copy(std::string{argument});
+	const todds::string argument_upper = todds::to_upper_copy(todds::string{argument});
 	const auto format = parse_format(argument_upper);
 	if (format == todds::format::type::invalid || format == todds::format::type::png) {
 		parsed_arguments.stop_message = fmt::format("Argument error: invalid encoding alpha format: {:s}", argument);
@@ -325,7 +436,7 @@ void alpha_format_from_str(std::string_view argument, todds::args::data& parsed_
 }
 
 todds::filter::type filter_from_str(std::string_view argument, todds::args::data& parsed_arguments) {
-	const todds::string argument_upper = todds::to_upper_copy(std::string{argument});
+	const todds::string argument_upper = todds::to_upper_copy(todds::string{argument});
 	todds::filter::type value = todds::filter::type::lanczos;
 	if (argument_upper == todds::filter::name(todds::filter::type::nearest)) {
 		value = todds::filter::type::nearest;
@@ -388,9 +499,15 @@ data get(const todds::vector<std::string_view>& arguments) {
 	parsed_arguments.scale = 100U;
 	parsed_arguments.scale_filter = filter::type::lanczos;
 	const auto max_threads = static_cast<std::size_t>(oneapi::tbb::info::default_concurrency());
-	parsed_arguments.threads = max_threads;
+	// Using more threads than the CPU quota of a container leads to throttling.
+	parsed_arguments.limits = cgroup::get_limits();
+	const std::size_t cpus = parsed_arguments.limits.cpus();
+	parsed_arguments.threads = cpus == 0UL ? max_threads : std::min(cpus, max_threads);
 	parsed_arguments.depth = max_depth;
 	parsed_arguments.quality = default_quality;
+	parsed_arguments.metrics_interval = default_metrics_interval;
+	parsed_arguments.sweep_target = default_sweep_target;
+	parsed_arguments.sweep_sample = 100U;
 
 	std::size_t index = 1UL;
 
@@ -492,6 +609,56 @@ data get(const todds::vector<std::string_view>& arguments) {
 			parsed_arguments.alpha_black = true;
 		} else if (matches(argument, report_arg)) {
 			parsed_arguments.report = true;
+		} else if (matches(argument, stream_threshold_arg)) {
+			++index;
+			argument_from_str(
+				stream_threshold_arg.name, next_argument, parsed_arguments.stream_threshold, parsed_arguments);
+		} else if (matches(argument, huge_pages_arg)) {
+			parsed_arguments.huge_pages = true;
+		} else if (matches(argument, background_arg)) {
+			parsed_arguments.background = true;
+		} else if (matches(argument, cpu_limit_arg)) {
+			++index;
+			argument_from_str(cpu_limit_arg.name, next_argument, parsed_arguments.cpu_limit, parsed_arguments);
+			parsed_arguments.cpu_limit = std::clamp<std::uint16_t>(parsed_arguments.cpu_limit, 1U, 100U);
+		} else if (matches(argument, io_limit_arg)) {
+			++index;
+			argument_from_str(io_limit_arg.name, next_argument, parsed_arguments.io_limit, parsed_arguments);
+		} else if (matches(argument, stats_arg)) {
+			parsed_arguments.stats = true;
+		} else if (matches(argument, stats_timeline_arg)) {
+			++index;
+			parsed_arguments.stats = true;
+			parsed_arguments.stats_timeline = next_argument;
+		} else if (matches(argument, trace_arg)) {
+			++index;
+			parsed_arguments.trace = next_argument;
+		} else if (matches(argument, perf_counters_arg)) {
+			parsed_arguments.perf_counters = true;
+		} else if (matches(argument, report_file_arg)) {
+			++index;
+			parsed_arguments.report_file = next_argument;
+		} else if (matches(argument, error_metrics_arg)) {
+			parsed_arguments.error_metrics = true;
+		} else if (matches(argument, metrics_file_arg)) {
+			++index;
+			parsed_arguments.metrics_file = next_argument;
+		} else if (matches(argument, metrics_interval_arg)) {
+			++index;
+			argument_from_str(metrics_interval_arg.name, next_argument, parsed_arguments.metrics_interval, parsed_arguments);
+			parsed_arguments.metrics_interval = std::max(parsed_arguments.metrics_interval, 1U);
+		} else if (matches(argument, capture_arg)) {
+			++index;
+			parsed_arguments.capture_file = next_argument;
+		} else if (matches(argument, sweep_arg)) {
+			parsed_arguments.sweep = true;
+		} else if (matches(argument, sweep_target_arg)) {
+			++index;
+			argument_from_str(sweep_target_arg.name, next_argument, parsed_arguments.sweep_target, parsed_arguments);
+		} else if (matches(argument, sweep_sample_arg)) {
+			++index;
+			argument_from_str(sweep_sample_arg.name, next_argument, parsed_arguments.sweep_sample, parsed_arguments);
+			parsed_arguments.sweep_sample = std::clamp<std::uint16_t>(parsed_arguments.sweep_sample, 1U, 100U);
 		} else {
 			parsed_arguments.stop_message = fmt::format("Invalid positional argument {:s}", argument);
 		}
@@ -545,6 +712,26 @@ data get(const todds::vector<std::string_view>& arguments) {
 		}
 	}
 
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.error_metrics) {
+		if (parsed_arguments.format == format::type::png) {
+			parsed_arguments.stop_message = fmt::format("Argument error: {:s} cannot be used with format {:s}.",
+				error_metrics_arg.name, format::name(format::type::png));
+		} else if (parsed_arguments.report_file.empty()) {
+			parsed_arguments.stop_message =
+				fmt::format("Argument error: {:s} requires {:s}.", error_metrics_arg.name, report_file_arg.name);
+		}
+	}
+
+	if (parsed_arguments.stop_message.empty() && parsed_arguments.sweep) {
+		if (parsed_arguments.format == format::type::png) {
+			parsed_arguments.stop_message = fmt::format("Argument error: {:s} cannot be used with format {:s}.",
+				sweep_arg.name, format::name(format::type::png));
+		}
+		// Nothing is saved, so files are swept even if their DDS files already exist.
+		parsed_arguments.overwrite = true;
+		parsed_arguments.overwrite_new = false;
+	}
+
 	return parsed_arguments;
 }
 
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "todds/cgroup.hpp"
 #include "todds/filter.hpp"
 #include "todds/format.hpp"
 #include "todds/regex.hpp"
@@ -53,6 +54,25 @@ struct data {
 	bool dry_run;
 	bool progress;
 	bool alpha_black;
+	uint32_t stream_threshold;
+	bool huge_pages;
+	bool background;
+	uint16_t cpu_limit;
+	uint32_t io_limit;
+	bool stats;
+	string stats_timeline;
+	string trace;
+	bool perf_counters;
+	string report_file;
+	bool error_metrics;
+	string metrics_file;
+	uint32_t metrics_interval;
+	string capture_file;
+	bool sweep;
+	double sweep_target;
+	uint16_t sweep_sample;
+	/** Resource limits of the process, detected while parsing arguments. */
+	cgroup::limits limits;
 };
 
 /**
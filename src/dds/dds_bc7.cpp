@@ -8,6 +8,8 @@
 
 #include <oneapi/tbb/parallel_for.h>
 
+#include <cassert>
+
 #include "dds_impl.hpp"
 
 namespace {
@@ -68,20 +70,26 @@ bc7_params bc7_encode_params(todds::format::quality quality) noexcept {
 	return params;
 }
 
-vector<std::uint64_t> bc7_encode(const bc7_params& params, const vector<std::uint32_t>& image) {
+dds_image bc7_encode(const bc7_params& params, const pixel_block_image image) {
+	dds_image result(
+		encoded_size(format::type::bc7, image.size()), pooled_allocator<std::uint64_t>(allocations::category::dds_output));
+	bc7_encode(params, image, result);
+	return result;
+}
+
+void bc7_encode(const bc7_params& params, const pixel_block_image image, const std::span<std::uint64_t> output) {
 	constexpr std::size_t grain_size = 64ULL;
 	static oneapi::tbb::affinity_partitioner partitioner;
 	const std::size_t num_blocks = image.size() / pixel_block_size;
-
-	vector<std::uint64_t> result(num_blocks * bc7_block_size);
+	assert(output.size() == num_blocks * bc7_block_size);
 
 	oneapi::tbb::parallel_for(
 		blocked_range(0UL, num_blocks, grain_size),
-		[&params, &image, &result](const blocked_range& range) {
+		[&params, &image, &output](const blocked_range& range) {
 			TracyZoneScopedN("bc7");
 			const std::size_t block_index = range.begin();
 			const auto blocks_to_process = static_cast<std::uint32_t>(range.end() - block_index);
-			std::uint64_t* dds_block = &result[block_index * bc7_block_size];
+			std::uint64_t* dds_block = &output[block_index * bc7_block_size];
 			const auto* pixel_block = &image[block_index * pixel_block_size];
 #ifdef TODDS_ISPC
 			ispc::bc7e_compress_blocks(static_cast<std::uint32_t>(blocks_to_process), dds_block, pixel_block, &params);
@@ -92,8 +100,6 @@ vector<std::uint64_t> bc7_encode(const bc7_params& params, const vector<std::uin
 #endif // TODDS_ISPC
 		},
 		partitioner);
-
-	return result;
 }
 
 } // namespace todds::dds
@@ -8,6 +8,8 @@
 
 #include <oneapi/tbb/parallel_for.h>
 
+#include <cassert>
+
 #include "dds_impl.hpp"
 #include "rgbcx_todds.hpp"
 
@@ -29,52 +31,68 @@ void initialize_bcx_encoding() { rgbcx::init(rgbcx::bc1_approx_mode::cBC1Ideal);
 
 namespace todds::dds {
 
-dds_image bc1_encode(const todds::format::quality quality, const bool alpha_black, const pixel_block_image& image) {
+dds_image bc1_encode(const todds::format::quality quality, const bool alpha_black, const pixel_block_image image) {
+	dds_image result(
+		encoded_size(format::type::bc1, image.size()), pooled_allocator<std::uint64_t>(allocations::category::dds_output));
+	bc1_encode(quality, alpha_black, image, result);
+	return result;
+}
+
+void bc1_encode(const todds::format::quality quality, const bool alpha_black, const pixel_block_image image,
+	const std::span<std::uint64_t> output) {
 	constexpr std::size_t grain_size = 64ULL;
 	static oneapi::tbb::affinity_partitioner partitioner;
 	const std::size_t num_blocks = image.size() / pixel_block_size;
-
-	dds_image result(num_blocks * bc1_block_size);
+	assert(output.size() == num_blocks * bc1_block_size);
 
 	const auto factors = impl::from_quality_level(static_cast<unsigned int>(quality), alpha_black);
 
 	oneapi::tbb::parallel_for(
 		blocked_range(0UL, num_blocks, grain_size),
-		[factors, &image, &result](const blocked_range& range) {
+		[factors, &image, &output](const blocked_range& range) {
 			TracyZoneScopedN("bc1");
 			for (std::size_t block_index = range.begin(); block_index < range.end(); ++block_index) {
-				auto* dds_block = &result[block_index * bc1_block_size];
+				auto* dds_block = &output[block_index * bc1_block_size];
 				const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(&image[block_index * pixel_block_size]);
 				rgbcx::encode_bc1(dds_block, pixel_block, factors.flags, factors.total_orderings4, factors.total_orderings3);
 			}
 		},
 		partitioner);
+}
 
+dds_image bc3_encode(const todds::format::quality quality, const pixel_block_image image) {
+	dds_image result(
+		encoded_size(format::type::bc3, image.size()), pooled_allocator<std::uint64_t>(allocations::category::dds_output));
+	bc3_encode(quality, image, result);
 	return result;
 }
 
-dds_image bc3_encode(const todds::format::quality quality, const pixel_block_image& image) {
+void bc3_encode(
+	const todds::format::quality quality, const pixel_block_image image, const std::span<std::uint64_t> output) {
 	constexpr std::size_t grain_size = 64ULL;
 	static oneapi::tbb::affinity_partitioner partitioner;
 	const std::size_t num_blocks = image.size() / pixel_block_size;
-
-	dds_image result(num_blocks * bc3_block_size);
+	assert(output.size() == num_blocks * bc3_block_size);
 
 	const auto factors = impl::from_quality_level(static_cast<unsigned int>(quality), false);
 
 	oneapi::tbb::parallel_for(
 		blocked_range(0UL, num_blocks, grain_size),
-		[factors, &image, &result](const blocked_range& range) {
+		[factors, &image, &output](const blocked_range& range) {
 			TracyZoneScopedN("bc3");
 			for (std::size_t block_index = range.begin(); block_index < range.end(); ++block_index) {
-				auto* dds_block = &result[block_index * bc3_block_size];
+				auto* dds_block = &output[block_index * bc3_block_size];
 				const auto* pixel_block = reinterpret_cast<const std::uint8_t*>(&image[block_index * pixel_block_size]);
 				rgbcx::encode_bc3(dds_block, pixel_block, factors.flags);
 			}
 		},
 		partitioner);
+}
 
-	return result;
+std::size_t encoded_size(const todds::format::type format_type, const std::size_t pixels) noexcept {
+	// BC1 uses 8 bytes per block, while BC3 and BC7 use 16 bytes per block.
+	const std::size_t block_size = format_type == format::type::bc1 ? bc1_block_size : bc3_block_size;
+	return (pixels / pixel_block_size) * block_size;
 }
 
 } // namespace todds::dds
@@ -0,0 +1,395 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/dds.hpp"
+
+#include <oneapi/tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t pixel_block_size = todds::pixel_block_side * todds::pixel_block_side;
+
+using block_pixels = std::array<std::uint32_t, pixel_block_size>;
+
+constexpr std::uint32_t rgba(std::uint32_t red, std::uint32_t green, std::uint32_t blue, std::uint32_t alpha) noexcept {
+	return red | (green << 8U) | (blue << 16U) | (alpha << 24U);
+}
+
+// BC1 colors are expanded and interpolated as rgbcx::bc1_approx_mode::cBC1Ideal, which is the mode used by the
+// encoder. BC3 color blocks always use four colors.
+void decode_bc1_colors(std::uint64_t block, bool three_colors_allowed, std::uint32_t alpha, block_pixels& pixels) {
+	const auto low = static_cast<std::uint32_t>(block & 0xFFFFU);
+	const auto high = static_cast<std::uint32_t>((block >> 16U) & 0xFFFFU);
+	const auto expand5 = [](std::uint32_t value) { return (value << 3U) | (value >> 2U); };
+	const auto expand6 = [](std::uint32_t value) { return (value << 2U) | (value >> 4U); };
+	const std::uint32_t red0 = expand5(low >> 11U);
+	const std::uint32_t green0 = expand6((low >> 5U) & 63U);
+	const std::uint32_t blue0 = expand5(low & 31U);
+	const std::uint32_t red1 = expand5(high >> 11U);
+	const std::uint32_t green1 = expand6((high >> 5U) & 63U);
+	const std::uint32_t blue1 = expand5(high & 31U);
+
+	std::array<std::uint32_t, 4UL> colors{rgba(red0, green0, blue0, alpha), rgba(red1, green1, blue1, alpha)};
+	if (low > high || !three_colors_allowed) {
+		colors[2] = rgba((red0 * 2U + red1) / 3U, (green0 * 2U + green1) / 3U, (blue0 * 2U + blue1) / 3U, alpha);
+		colors[3] = rgba((red1 * 2U + red0) / 3U, (green1 * 2U + green0) / 3U, (blue1 * 2U + blue0) / 3U, alpha);
+	} else {
+		colors[2] = rgba((red0 + red1) / 2U, (green0 + green1) / 2U, (blue0 + blue1) / 2U, alpha);
+		colors[3] = 0U;
+	}
+
+	auto selectors = static_cast<std::uint32_t>(block >> 32U);
+	for (auto& pixel : pixels) {
+		pixel = colors[selectors & 3U];
+		selectors >>= 2U;
+	}
+}
+
+void decode_bc4_alpha(std::uint64_t block, block_pixels& pixels) {
+	const auto low = static_cast<std::uint32_t>(block & 0xFFU);
+	const auto high = static_cast<std::uint32_t>((block >> 8U) & 0xFFU);
+	std::array<std::uint32_t, 8UL> values{low, high};
+	if (low > high) {
+		for (std::uint32_t index = 1U; index < 7U; ++index) {
+			values[index + 1U] = (low * (7U - index) + high * index) / 7U;
+		}
+	} else {
+		for (std::uint32_t index = 1U; index < 5U; ++index) {
+			values[index + 1U] = (low * (5U - index) + high * index) / 5U;
+		}
+		values[6] = 0U;
+		values[7] = 255U;
+	}
+
+	std::uint64_t selectors = block >> 16U;
+	for (auto& pixel : pixels) {
+		pixel = (pixel & 0x00FFFFFFU) | (values[selectors & 7U] << 24U);
+		selectors >>= 3U;
+	}
+}
+
+// BC7 mode properties, as described in the BC7 format specification.
+struct bc7_mode {
+	std::uint32_t subsets;
+	std::uint32_t partition_bits;
+	std::uint32_t rotation_bits;
+	std::uint32_t index_selection_bits;
+	std::uint32_t color_bits;
+	std::uint32_t alpha_bits;
+	std::uint32_t endpoint_p_bits;
+	std::uint32_t shared_p_bits;
+	std::uint32_t index_bits;
+	std::uint32_t secondary_index_bits;
+};
+
+constexpr std::array<bc7_mode, 8UL> bc7_modes{{
+	{3U, 4U, 0U, 0U, 4U, 0U, 1U, 0U, 3U, 0U},
+	{2U, 6U, 0U, 0U, 6U, 0U, 0U, 1U, 3U, 0U},
+	{3U, 6U, 0U, 0U, 5U, 0U, 0U, 0U, 2U, 0U},
+	{2U, 6U, 0U, 0U, 7U, 0U, 1U, 0U, 2U, 0U},
+	{1U, 0U, 2U, 1U, 5U, 6U, 0U, 0U, 2U, 3U},
+	{1U, 0U, 2U, 0U, 7U, 8U, 0U, 0U, 2U, 2U},
+	{1U, 0U, 0U, 0U, 7U, 7U, 1U, 0U, 4U, 0U},
+	{2U, 6U, 0U, 0U, 5U, 5U, 1U, 0U, 2U, 0U},
+}};
+
+// Subset of each pixel in two subset partitions. Bit N is set if pixel N belongs to the second subset.
+constexpr std::array<std::uint16_t, 64UL> bc7_partitions2{0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8,
+	0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000, 0xF710, 0x008E, 0x7100, 0x08CE, 0x008C,
+	0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C, 0xAAAA, 0xF0F0, 0x5A5A,
+	0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660, 0x0272,
+	0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744,
+	0xEE22};
+
+// Subset of each pixel in three subset partitions, using two bits per pixel starting with pixel 0.
+constexpr std::array<std::uint32_t, 64UL> bc7_partitions3{0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000,
+	0xA0A05050, 0x5555A0A0, 0x5A5A5050, 0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4,
+	0xA9A59450, 0x2A0A4250, 0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000,
+	0x1A1A0500, 0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+	0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50, 0x500AA550,
+	0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600, 0xAA444444, 0x54A854A8,
+	0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000, 0xAAAA1414, 0xA05050A0, 0xA0A5A5A0,
+	0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254};
+
+// Pixel whose index omits its most significant bit in the second subset of two subset partitions.
+constexpr std::array<std::uint8_t, 64UL> bc7_anchors2_second{15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2, 15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2,
+	6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15};
+
+// Pixel whose index omits its most significant bit in the second subset of three subset partitions.
+constexpr std::array<std::uint8_t, 64UL> bc7_anchors3_second{3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3,
+	8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15, 8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, 3, 15, 5, 5,
+	5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3};
+
+// Pixel whose index omits its most significant bit in the third subset of three subset partitions.
+constexpr std::array<std::uint8_t, 64UL> bc7_anchors3_third{15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+	15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8, 15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, 15,
+	3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8};
+
+constexpr std::array<std::uint32_t, 4UL> bc7_weights2{0U, 21U, 43U, 64U};
+constexpr std::array<std::uint32_t, 8UL> bc7_weights3{0U, 9U, 18U, 27U, 37U, 46U, 55U, 64U};
+constexpr std::array<std::uint32_t, 16UL> bc7_weights4{
+	0U, 4U, 9U, 13U, 17U, 21U, 26U, 30U, 34U, 38U, 43U, 47U, 51U, 55U, 60U, 64U};
+
+constexpr std::uint32_t bc7_weight(std::uint32_t bits, std::uint32_t index) noexcept {
+	switch (bits) {
+	case 2U: return bc7_weights2[index];
+	case 3U: return bc7_weights3[index];
+	default: return bc7_weights4[index];
+	}
+}
+
+// Endpoints of each subset, stored as [subset][endpoint][channel].
+using bc7_endpoints = std::array<std::array<std::array<std::uint32_t, 4UL>, 2UL>, 3UL>;
+
+#if defined(__SSE2__) || defined(_M_X64)
+// Two pixels are interpolated at a time, with each channel in a 16 bit lane. Rotations swap alpha with one of the color
+// channels after interpolating, which is the same as swapping their endpoints and weights before interpolating.
+void bc7_interpolate_block(const bc7_endpoints& endpoints, const std::array<std::uint32_t, pixel_block_size>& subsets,
+	const std::array<std::uint32_t, pixel_block_size>& color_weights,
+	const std::array<std::uint32_t, pixel_block_size>& alpha_weights, std::uint32_t rotation,
+	block_pixels& pixels) noexcept {
+	const std::uint32_t alpha_lane = rotation > 0U ? rotation - 1U : 3U;
+	const std::uint64_t alpha_lanes = 1ULL << (alpha_lane * 16U);
+	const std::uint64_t color_lanes = 0x0001000100010001ULL - alpha_lanes;
+
+	std::array<std::array<long long, 2UL>, 3UL> packed{};
+	for (std::size_t subset = 0UL; subset < endpoints.size(); ++subset) {
+		for (std::size_t endpoint = 0UL; endpoint < 2UL; ++endpoint) {
+			std::array<std::uint64_t, 4UL> lanes{};
+			for (std::uint32_t channel = 0U; channel < 4U; ++channel) {
+				lanes[channel] = endpoints[subset][endpoint][channel];
+			}
+			std::swap(lanes[3], lanes[alpha_lane]);
+			packed[subset][endpoint] =
+				static_cast<long long>(lanes[0] | (lanes[1] << 16U) | (lanes[2] << 32U) | (lanes[3] << 48U));
+		}
+	}
+	const auto weights = [&color_weights, &alpha_weights, color_lanes, alpha_lanes](std::size_t pixel) {
+		return static_cast<long long>(color_weights[pixel] * color_lanes + alpha_weights[pixel] * alpha_lanes);
+	};
+
+	const __m128i maximum_weight = _mm_set1_epi16(64);
+	const __m128i rounding = _mm_set1_epi16(32);
+	const auto interpolate = [&packed, &subsets, &weights, &maximum_weight, &rounding](std::size_t pixel) {
+		const auto& first = packed[subsets[pixel]];
+		const auto& second = packed[subsets[pixel + 1UL]];
+		const __m128i low = _mm_set_epi64x(second[0], first[0]);
+		const __m128i high = _mm_set_epi64x(second[1], first[1]);
+		const __m128i weight = _mm_set_epi64x(weights(pixel + 1UL), weights(pixel));
+		const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(maximum_weight, weight), low),
+			_mm_add_epi16(_mm_mullo_epi16(weight, high), rounding));
+		return _mm_srli_epi16(sum, 6);
+	};
+	for (std::size_t pixel = 0UL; pixel < pixel_block_size; pixel += 4UL) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&pixels[pixel]),
+			_mm_packus_epi16(interpolate(pixel), interpolate(pixel + 2UL)));
+	}
+}
+#else
+constexpr std::uint32_t bc7_interpolate(std::uint32_t first, std::uint32_t second, std::uint32_t weight) noexcept {
+	return ((64U - weight) * first + weight * second + 32U) >> 6U;
+}
+
+void bc7_interpolate_block(const bc7_endpoints& endpoints, const std::array<std::uint32_t, pixel_block_size>& subsets,
+	const std::array<std::uint32_t, pixel_block_size>& color_weights,
+	const std::array<std::uint32_t, pixel_block_size>& alpha_weights, std::uint32_t rotation,
+	block_pixels& pixels) noexcept {
+	for (std::uint32_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		const auto& endpoint = endpoints[subsets[pixel]];
+		const std::uint32_t color_weight = color_weights[pixel];
+		const std::uint32_t alpha_weight = alpha_weights[pixel];
+		std::array<std::uint32_t, 4UL> color{bc7_interpolate(endpoint[0][0], endpoint[1][0], color_weight),
+			bc7_interpolate(endpoint[0][1], endpoint[1][1], color_weight),
+			bc7_interpolate(endpoint[0][2], endpoint[1][2], color_weight),
+			bc7_interpolate(endpoint[0][3], endpoint[1][3], alpha_weight)};
+		// Rotations swap alpha with one of the color channels.
+		if (rotation > 0U) { std::swap(color[3], color[rotation - 1U]); }
+		pixels[pixel] = rgba(color[0], color[1], color[2], color[3]);
+	}
+}
+#endif
+
+// Reads the fields of a BC7 block from its least significant bit.
+class bit_reader final {
+public:
+	bit_reader(std::uint64_t low, std::uint64_t high) noexcept
+		: _low{low}
+		, _high{high} {}
+
+	std::uint32_t read(std::uint32_t bits) noexcept {
+		assert(bits <= 8U);
+		std::uint64_t value{};
+		if (_position >= 64U) {
+			value = _high >> (_position - 64U);
+		} else if (_position + bits <= 64U) {
+			value = _low >> _position;
+		} else {
+			value = (_low >> _position) | (_high << (64U - _position));
+		}
+		_position += bits;
+		return static_cast<std::uint32_t>(value & ((1ULL << bits) - 1ULL));
+	}
+
+private:
+	std::uint64_t _low;
+	std::uint64_t _high;
+	std::uint32_t _position{};
+};
+
+void decode_bc7(std::uint64_t low, std::uint64_t high, block_pixels& pixels) {
+	constexpr std::uint32_t channels = 4U;
+	const auto mode_index = static_cast<std::uint32_t>(std::countr_zero(static_cast<std::uint8_t>(low & 0xFFU)));
+	if (mode_index >= bc7_modes.size()) {
+		// Reserved modes decode as transparent black.
+		pixels.fill(0U);
+		return;
+	}
+
+	const bc7_mode& mode = bc7_modes[mode_index];
+	bit_reader reader{low, high};
+	reader.read(mode_index + 1U);
+	const std::uint32_t partition = reader.read(mode.partition_bits);
+	const std::uint32_t rotation = reader.read(mode.rotation_bits);
+	const std::uint32_t index_selection = reader.read(mode.index_selection_bits);
+
+	bc7_endpoints endpoints{};
+	for (std::uint32_t channel = 0U; channel < channels; ++channel) {
+		const std::uint32_t bits = channel < 3U ? mode.color_bits : mode.alpha_bits;
+		for (std::uint32_t subset = 0U; subset < mode.subsets; ++subset) {
+			for (auto& endpoint : endpoints[subset]) { endpoint[channel] = bits > 0U ? reader.read(bits) : 255U; }
+		}
+	}
+
+	std::array<std::uint32_t, 6UL> p_bits{};
+	const std::uint32_t p_bit_count = mode.endpoint_p_bits > 0U ? mode.subsets * 2U : mode.shared_p_bits * mode.subsets;
+	for (std::uint32_t index = 0U; index < p_bit_count; ++index) { p_bits[index] = reader.read(1U); }
+
+	const bool has_p_bits = p_bit_count > 0U;
+	for (std::uint32_t subset = 0U; subset < mode.subsets; ++subset) {
+		for (std::uint32_t endpoint_index = 0U; endpoint_index < 2U; ++endpoint_index) {
+			auto& endpoint = endpoints[subset][endpoint_index];
+			const std::uint32_t p_bit = p_bits[mode.endpoint_p_bits > 0U ? subset * 2U + endpoint_index : subset];
+			for (std::uint32_t channel = 0U; channel < channels; ++channel) {
+				std::uint32_t bits = channel < 3U ? mode.color_bits : mode.alpha_bits;
+				if (bits == 0U) { continue; }
+				if (has_p_bits) {
+					endpoint[channel] = (endpoint[channel] << 1U) | p_bit;
+					++bits;
+				}
+				endpoint[channel] = (endpoint[channel] << (8U - bits)) | (endpoint[channel] >> (2U * bits - 8U));
+			}
+		}
+	}
+
+	// Subset of each pixel, and pixels whose index omits its most significant bit.
+	std::array<std::uint32_t, pixel_block_size> subsets{};
+	std::uint32_t anchors = 1U;
+	if (mode.subsets == 2U) {
+		for (std::uint32_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			subsets[pixel] = (bc7_partitions2[partition] >> pixel) & 1U;
+		}
+		anchors |= 1U << bc7_anchors2_second[partition];
+	} else if (mode.subsets == 3U) {
+		for (std::uint32_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			subsets[pixel] = (bc7_partitions3[partition] >> (pixel * 2U)) & 3U;
+		}
+		anchors |= (1U << bc7_anchors3_second[partition]) | (1U << bc7_anchors3_third[partition]);
+	}
+
+	std::array<std::uint32_t, pixel_block_size> indices{};
+	for (std::uint32_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		indices[pixel] = reader.read(mode.index_bits - ((anchors >> pixel) & 1U));
+	}
+	std::array<std::uint32_t, pixel_block_size> secondary_indices{};
+	if (mode.secondary_index_bits > 0U) {
+		for (std::uint32_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+			secondary_indices[pixel] = reader.read(mode.secondary_index_bits - (pixel == 0U ? 1U : 0U));
+		}
+	}
+
+	// With a secondary index, the index selection bit chooses which one is used for colors and which one for alpha.
+	std::uint32_t color_bits = mode.index_bits;
+	std::uint32_t alpha_bits = mode.secondary_index_bits > 0U ? mode.secondary_index_bits : mode.index_bits;
+	const auto& color_indices = index_selection == 0U ? indices : secondary_indices;
+	const auto& alpha_indices = index_selection == 0U && mode.secondary_index_bits > 0U ? secondary_indices : indices;
+	if (index_selection != 0U) { std::swap(color_bits, alpha_bits); }
+
+	std::array<std::uint32_t, pixel_block_size> color_weights{};
+	std::array<std::uint32_t, pixel_block_size> alpha_weights{};
+	for (std::uint32_t pixel = 0U; pixel < pixel_block_size; ++pixel) {
+		color_weights[pixel] = bc7_weight(color_bits, color_indices[pixel]);
+		alpha_weights[pixel] = bc7_weight(alpha_bits, alpha_indices[pixel]);
+	}
+	bc7_interpolate_block(endpoints, subsets, color_weights, alpha_weights, rotation, pixels);
+}
+
+void decode_blocks(
+	todds::format::type format_type, std::span<const std::uint64_t> encoded, std::span<std::uint32_t> output) {
+	using todds::format::type;
+	const std::size_t block_size = todds::dds::encoded_size(format_type, pixel_block_size);
+	const std::size_t num_blocks = encoded.size() / block_size;
+	assert(output.size() == num_blocks * pixel_block_size);
+
+	block_pixels pixels{};
+	for (std::size_t block_index = 0UL; block_index < num_blocks; ++block_index) {
+		const auto* block = &encoded[block_index * block_size];
+		switch (format_type) {
+		case type::bc1: decode_bc1_colors(block[0], true, 255U, pixels); break;
+		case type::bc3:
+			decode_bc1_colors(block[1], false, 0U, pixels);
+			decode_bc4_alpha(block[0], pixels);
+			break;
+		case type::bc7: decode_bc7(block[0], block[1], pixels); break;
+		case type::png:
+		case type::invalid: assert(false); break;
+		}
+		std::copy(pixels.begin(), pixels.end(), output.subspan(block_index * pixel_block_size).begin());
+	}
+}
+
+} // Anonymous namespace
+
+namespace todds::dds {
+
+void decode(const todds::format::type format_type, const std::span<const std::uint64_t> encoded,
+	const std::span<std::uint32_t> output) {
+	using blocked_range = oneapi::tbb::blocked_range<std::size_t>;
+	constexpr std::size_t grain_size = 64UL;
+	const std::size_t block_size = encoded_size(format_type, pixel_block_size);
+	assert(output.size() == (encoded.size() / block_size) * pixel_block_size);
+	oneapi::tbb::parallel_for(blocked_range(0UL, encoded.size() / block_size, grain_size),
+		[format_type, block_size, &encoded, &output](const blocked_range& range) {
+			decode_blocks(format_type, encoded.subspan(range.begin() * block_size, range.size() * block_size),
+				output.subspan(range.begin() * pixel_block_size, range.size() * pixel_block_size));
+		});
+}
+
+void add_decode_error(const todds::format::type format_type, const std::span<const std::uint64_t> encoded,
+	const image& source, const std::size_t first_block, const std::size_t height, image_error& error) {
+	// Groups are small enough for their decoded pixels to stay in the L1 cache until they are compared.
+	constexpr std::size_t group_blocks = 64UL;
+	const std::size_t block_size = encoded_size(format_type, pixel_block_size);
+	const std::size_t num_blocks = encoded.size() / block_size;
+	std::array<std::uint32_t, group_blocks * pixel_block_size> decoded{};
+	for (std::size_t start = 0UL; start < num_blocks; start += group_blocks) {
+		const std::size_t count = std::min(group_blocks, num_blocks - start);
+		const std::span<std::uint32_t> pixels{decoded.data(), count * pixel_block_size};
+		decode_blocks(format_type, encoded.subspan(start * block_size, count * block_size), pixels);
+		add_error(source, first_block + start, pixels, height, error);
+	}
+}
+
+} // namespace todds::dds
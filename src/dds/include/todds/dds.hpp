@@ -6,6 +6,8 @@
 #pragma once
 
 #include "todds/format.hpp"
+#include "todds/image.hpp"
+#include "todds/image_error.hpp"
 #include "todds/image_types.hpp"
 
 #ifdef TODDS_ISPC
@@ -15,7 +17,9 @@
 #endif // TODDS_ISPC
 
 #include <array>
+#include <cstdint>
 #include <memory>
+#include <span>
 
 namespace todds::dds {
 
@@ -41,7 +45,17 @@ void initialize_encoding(format::type format, format::type alpha_format);
  * @param alpha_black Will use use 3 color blocks for blocks containing black or very dark pixels.
  * @return BC1 encoded image.
  */
-[[nodiscard]] dds_image bc1_encode(todds::format::quality quality, bool alpha_black, const pixel_block_image& image);
+[[nodiscard]] dds_image bc1_encode(todds::format::quality quality, bool alpha_black, pixel_block_image image);
+
+/**
+ * Encode an image to BC1 into an existing buffer.
+ * @param quality DDS encoding quality level.
+ * @param alpha_black Will use use 3 color blocks for blocks containing black or very dark pixels.
+ * @param image Source pixel block image.
+ * @param output Destination of the encoded blocks. Its size must be encoded_size(format::type::bc1, image.size()).
+ */
+void bc1_encode(
+	todds::format::quality quality, bool alpha_black, pixel_block_image image, std::span<std::uint64_t> output);
 
 /**
  * Encode an image to BC3.
@@ -49,7 +63,15 @@ void initialize_encoding(format::type format, format::type alpha_format);
  * @param image Source pixel block image.
  * @return BC3 encoded image.
  */
-[[nodiscard]] dds_image bc3_encode(todds::format::quality quality, const pixel_block_image& image);
+[[nodiscard]] dds_image bc3_encode(todds::format::quality quality, pixel_block_image image);
+
+/**
+ * Encode an image to BC3 into an existing buffer.
+ * @param quality DDS encoding quality level.
+ * @param image Source pixel block image.
+ * @param output Destination of the encoded blocks. Its size must be encoded_size(format::type::bc3, image.size()).
+ */
+void bc3_encode(todds::format::quality quality, pixel_block_image image, std::span<std::uint64_t> output);
 
 /**
  * Generate the parameters to use for BC7 DDS encoding.
@@ -64,7 +86,45 @@ void initialize_encoding(format::type format, format::type alpha_format);
  * @param image Source pixel block image.
  * @return BC7 encoded image.
  */
-[[nodiscard]] dds_image bc7_encode(const bc7_params& params, const pixel_block_image& image);
+[[nodiscard]] dds_image bc7_encode(const bc7_params& params, pixel_block_image image);
+
+/**
+ * Encode an image to BC7 into an existing buffer.
+ * @param params BC7 block encoding parameters.
+ * @param image Source pixel block image.
+ * @param output Destination of the encoded blocks. Its size must be encoded_size(format::type::bc7, image.size()).
+ */
+void bc7_encode(const bc7_params& params, pixel_block_image image, std::span<std::uint64_t> output);
+
+/**
+ * Decode an image encoded as BC1, BC3 or BC7. BC1 and BC3 colors are interpolated as the encoders assume.
+ * Blocks are decoded in parallel.
+ * @param format_type DDS format of the encoded image.
+ * @param encoded Encoded blocks.
+ * @param output Destination pixel block image, with 16 pixels for each encoded block.
+ */
+void decode(todds::format::type format_type, std::span<const std::uint64_t> encoded, std::span<std::uint32_t> output);
+
+/**
+ * Decode consecutive encoded blocks of an image and add their error compared to the original image. Blocks are decoded
+ * and compared in small groups, so calling this right after encoding the blocks reads them from the cache.
+ * @param format_type DDS format of the encoded blocks.
+ * @param encoded Encoded blocks.
+ * @param source Original image, using pixel_layout::blocks.
+ * @param first_block Index in source of the first encoded block.
+ * @param height Rows of source to compare. Any rows after them are considered padding.
+ * @param error Error in which the result is added.
+ */
+void add_decode_error(todds::format::type format_type, std::span<const std::uint64_t> encoded, const image& source,
+	std::size_t first_block, std::size_t height, image_error& error);
+
+/**
+ * Size of an encoded image.
+ * @param format_type DDS format of the image.
+ * @param pixels Number of pixels of the image, including padding.
+ * @return Number of values required to store the encoded image.
+ */
+[[nodiscard]] std::size_t encoded_size(todds::format::type format_type, std::size_t pixels) noexcept;
 
 /**
  * Construct a DDS header.
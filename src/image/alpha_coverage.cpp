@@ -98,4 +98,16 @@ void scale_alpha_to_coverage(float desired_coverage, std::uint8_t alpha_referenc
 	scale_alpha(best_alpha_scale, img);
 }
 
+bool has_alpha(pixel_block_image pixels) noexcept {
+	const auto* current_alpha = reinterpret_cast<const std::uint8_t*>(pixels.data()) + 3U;
+	const auto* end = reinterpret_cast<const std::uint8_t*>(pixels.data() + pixels.size());
+
+	while (current_alpha < end) {
+		if (*current_alpha != std::numeric_limits<std::uint8_t>::max()) { return true; }
+		current_alpha += image::bytes_per_pixel;
+	}
+
+	return false;
+}
+
 } // namespace todds
@@ -4,10 +4,17 @@
  */
 #include "todds/image.hpp"
 
+#include "todds/util.hpp"
+
+#include <algorithm>
 #include <cassert>
 
 namespace {
 
+constexpr std::size_t block_side = 4UL;
+
+constexpr std::size_t block_pixels = block_side * block_side;
+
 constexpr std::size_t get_byte_position(std::size_t width, std::size_t byte_x, std::size_t byte_y) noexcept {
 	return byte_x + byte_y * width * todds::image::bytes_per_pixel;
 }
@@ -15,17 +22,28 @@ constexpr std::size_t get_byte_position(std::size_t width, std::size_t byte_x, s
 } // anonymous namespace
 
 namespace todds {
-image::image(std::size_t width, std::size_t height)
+image::image(std::size_t width, std::size_t height, pixel_layout layout)
 	: _width{width}
 	, _height{height}
+	, _layout{layout}
 	, _data(static_cast<std::uint8_t*>(nullptr), 0UL) {}
 
 std::size_t image::width() const noexcept { return _width; }
 
 std::size_t image::height() const noexcept { return _height; }
 
+std::size_t image::padded_width() const noexcept {
+	return _layout == pixel_layout::blocks ? util::next_divisible_by_4(_width) : _width;
+}
+
+std::size_t image::padded_height() const noexcept {
+	return _layout == pixel_layout::blocks ? util::next_divisible_by_4(_height) : _height;
+}
+
+pixel_layout image::layout() const noexcept { return _layout; }
+
 void image::set_data(std::span<std::uint8_t> data) {
-	assert(data.size() == _width * _height * image::bytes_per_pixel);
+	assert(data.size() == padded_width() * padded_height() * image::bytes_per_pixel);
 	_data = data;
 }
 
@@ -34,22 +52,82 @@ void image::set_data(std::span<std::uint8_t> data) {
 [[nodiscard]] std::span<const std::uint8_t> image::data() const noexcept { return _data; }
 
 const std::uint8_t& image::row_start(std::size_t row) const noexcept {
+	assert(_layout == pixel_layout::rows);
+	return _data[get_byte_position(width(), 0UL, row)];
+}
+
+std::uint8_t& image::row_start(std::size_t row) noexcept {
+	assert(_layout == pixel_layout::rows);
 	return _data[get_byte_position(width(), 0UL, row)];
 }
 
-std::uint8_t& image::row_start(std::size_t row) noexcept { return _data[get_byte_position(width(), 0UL, row)]; }
+void image::read_row(std::size_t row, std::span<std::uint8_t> output) const noexcept {
+	assert(row < _height && output.size() >= _width * bytes_per_pixel);
+	if (_layout == pixel_layout::rows) {
+		const std::uint8_t* start = &row_start(row);
+		std::copy(start, start + _width * bytes_per_pixel, output.begin());
+		return;
+	}
+
+	for (std::size_t pixel_x = 0UL; pixel_x < _width; pixel_x += block_side) {
+		const std::size_t count = std::min(block_side, _width - pixel_x) * bytes_per_pixel;
+		const std::uint8_t* start = &_data[pixel_position(pixel_x, row)];
+		std::copy(start, start + count, &output[pixel_x * bytes_per_pixel]);
+	}
+}
+
+void image::write_row(std::size_t row, std::span<const std::uint8_t> input) noexcept {
+	assert(row < _height && input.size() >= _width * bytes_per_pixel);
+	if (_layout == pixel_layout::rows) {
+		std::copy(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(_width * bytes_per_pixel), &row_start(row));
+		return;
+	}
+
+	constexpr std::size_t block_row_bytes = block_side * bytes_per_pixel;
+	const std::size_t last_pixel = (_width - 1UL) * bytes_per_pixel;
+	for (std::size_t pixel_x = 0UL; pixel_x < _width; pixel_x += block_side) {
+		std::uint8_t* destination = &_data[pixel_position(pixel_x, row)];
+		const std::size_t count = std::min(block_side, _width - pixel_x) * bytes_per_pixel;
+		const std::uint8_t* source = &input[pixel_x * bytes_per_pixel];
+		destination = std::copy(source, source + count, destination);
+		// Padding columns repeat the last pixel of the row.
+		for (std::size_t padding = count; padding < block_row_bytes; padding += bytes_per_pixel) {
+			destination = std::copy(&input[last_pixel], &input[last_pixel] + bytes_per_pixel, destination);
+		}
+	}
+
+	// Padding rows repeat the last row of the image.
+	if (row + 1UL == _height) {
+		const std::size_t blocks_per_row = padded_width() / block_side;
+		for (std::size_t padding_row = _height; padding_row < padded_height(); ++padding_row) {
+			for (std::size_t block_x = 0UL; block_x < blocks_per_row; ++block_x) {
+				const std::uint8_t* source = &_data[pixel_position(block_x * block_side, row)];
+				std::copy(source, source + block_row_bytes, &_data[pixel_position(block_x * block_side, padding_row)]);
+			}
+		}
+	}
+}
 
 std::span<std::uint8_t, image::bytes_per_pixel> image::get_pixel(std::size_t pixel_x, std::size_t pixel_y) noexcept {
-	auto index = static_cast<std::ptrdiff_t>(get_byte_position(width(), pixel_x * bytes_per_pixel, pixel_y));
+	auto index = static_cast<std::ptrdiff_t>(pixel_position(pixel_x, pixel_y));
 	return std::span<std::uint8_t, image::bytes_per_pixel>(
 		_data.begin() + index, _data.begin() + index + bytes_per_pixel);
 }
 
 std::span<const std::uint8_t, image::bytes_per_pixel> image::get_pixel(
 	std::size_t pixel_x, std::size_t pixel_y) const noexcept {
-	auto index = static_cast<std::ptrdiff_t>(get_byte_position(width(), pixel_x * bytes_per_pixel, pixel_y));
+	auto index = static_cast<std::ptrdiff_t>(pixel_position(pixel_x, pixel_y));
 	return std::span<const std::uint8_t, image::bytes_per_pixel>(
 		_data.begin() + index, _data.begin() + index + bytes_per_pixel);
 }
 
+std::size_t image::pixel_position(std::size_t pixel_x, std::size_t pixel_y) const noexcept {
+	if (_layout == pixel_layout::rows) { return get_byte_position(width(), pixel_x * bytes_per_pixel, pixel_y); }
+
+	// Each 4x4 block is stored contiguously. Blocks are stored in the same order as rows of pixels.
+	const std::size_t block_index = (pixel_y / block_side) * (padded_width() / block_side) + pixel_x / block_side;
+	const std::size_t pixel_index = (pixel_y % block_side) * block_side + pixel_x % block_side;
+	return (block_index * block_pixels + pixel_index) * bytes_per_pixel;
+}
+
 } // namespace todds
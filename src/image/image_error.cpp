@@ -0,0 +1,201 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/image_error.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t channels = todds::image_error::channels;
+constexpr std::size_t block_pixels = todds::pixel_block_side * todds::pixel_block_side;
+
+// Constants of the SSIM formula for values in [0, 255].
+constexpr double ssim_c1 = (0.01 * 255.0) * (0.01 * 255.0);
+constexpr double ssim_c2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+// Sums over the pixels of a 4x4 block required by the squared error and the structural similarity of each channel.
+struct block_sums {
+	std::array<std::uint32_t, channels> squared{};
+	std::array<std::uint32_t, channels> source{};
+	std::array<std::uint32_t, channels> decoded{};
+	std::array<std::uint32_t, channels> source_squared{};
+	std::array<std::uint32_t, channels> decoded_squared{};
+	std::array<std::uint32_t, channels> product{};
+};
+
+constexpr std::uint32_t channel_value(std::uint32_t pixel, std::size_t channel) noexcept {
+	return (pixel >> (channel * 8UL)) & 0xFFU;
+}
+
+// Blocks on the right and bottom edges may contain padding pixels, which are skipped.
+block_sums partial_block_sums(
+	const std::uint32_t* source, const std::uint32_t* decoded, std::size_t columns, std::size_t rows) noexcept {
+	block_sums sums{};
+	for (std::size_t row = 0UL; row < rows; ++row) {
+		for (std::size_t column = 0UL; column < columns; ++column) {
+			const std::size_t pixel_index = row * todds::pixel_block_side + column;
+			for (std::size_t channel = 0UL; channel < channels; ++channel) {
+				const std::uint32_t first = channel_value(source[pixel_index], channel);
+				const std::uint32_t second = channel_value(decoded[pixel_index], channel);
+				const std::uint32_t difference = first > second ? first - second : second - first;
+				sums.squared[channel] += difference * difference;
+				sums.source[channel] += first;
+				sums.decoded[channel] += second;
+				sums.source_squared[channel] += first * first;
+				sums.decoded_squared[channel] += second * second;
+				sums.product[channel] += first * second;
+			}
+		}
+	}
+	return sums;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+// Channels are widened to 16 bits, two pixels at a time. Products of two channels fit in 16 bits, and they are added
+// into 32 bit lanes which hold the sums of each channel.
+block_sums full_block_sums(const std::uint32_t* source, const std::uint32_t* decoded) noexcept {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i squared = zero;
+	__m128i source_sum = zero;
+	__m128i decoded_sum = zero;
+	__m128i source_squared = zero;
+	__m128i decoded_squared = zero;
+	__m128i product = zero;
+	const auto add = [&zero](__m128i& total, __m128i values) {
+		total = _mm_add_epi32(total, _mm_unpacklo_epi16(values, zero));
+		total = _mm_add_epi32(total, _mm_unpackhi_epi16(values, zero));
+	};
+	for (std::size_t pixel = 0UL; pixel < block_pixels; pixel += 4UL) {
+		const __m128i source_pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + pixel));
+		const __m128i decoded_pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(decoded + pixel));
+		for (const bool high : {false, true}) {
+			const __m128i first = high ? _mm_unpackhi_epi8(source_pixels, zero) : _mm_unpacklo_epi8(source_pixels, zero);
+			const __m128i second = high ? _mm_unpackhi_epi8(decoded_pixels, zero) : _mm_unpacklo_epi8(decoded_pixels, zero);
+			const __m128i difference = _mm_sub_epi16(first, second);
+			add(squared, _mm_mullo_epi16(difference, difference));
+			add(source_sum, first);
+			add(decoded_sum, second);
+			add(source_squared, _mm_mullo_epi16(first, first));
+			add(decoded_squared, _mm_mullo_epi16(second, second));
+			add(product, _mm_mullo_epi16(first, second));
+		}
+	}
+
+	block_sums sums{};
+	const auto store = [](std::array<std::uint32_t, channels>& destination, __m128i total) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination.data()), total);
+	};
+	store(sums.squared, squared);
+	store(sums.source, source_sum);
+	store(sums.decoded, decoded_sum);
+	store(sums.source_squared, source_squared);
+	store(sums.decoded_squared, decoded_squared);
+	store(sums.product, product);
+	return sums;
+}
+#else
+block_sums full_block_sums(const std::uint32_t* source, const std::uint32_t* decoded) noexcept {
+	return partial_block_sums(source, decoded, todds::pixel_block_side, todds::pixel_block_side);
+}
+#endif
+
+void add_block(const block_sums& sums, std::size_t pixels, todds::image_error& error) noexcept {
+	const auto count = static_cast<double>(pixels);
+	for (std::size_t channel = 0UL; channel < channels; ++channel) {
+		error.squared_error[channel] += sums.squared[channel];
+		const double mean_source = sums.source[channel] / count;
+		const double mean_decoded = sums.decoded[channel] / count;
+		const double variance_source = sums.source_squared[channel] / count - mean_source * mean_source;
+		const double variance_decoded = sums.decoded_squared[channel] / count - mean_decoded * mean_decoded;
+		const double covariance = sums.product[channel] / count - mean_source * mean_decoded;
+		error.ssim[channel] += ((2.0 * mean_source * mean_decoded + ssim_c1) * (2.0 * covariance + ssim_c2)) /
+													 ((mean_source * mean_source + mean_decoded * mean_decoded + ssim_c1) *
+														 (variance_source + variance_decoded + ssim_c2));
+	}
+	error.pixels += pixels;
+	++error.blocks;
+}
+
+} // Anonymous namespace
+
+namespace todds {
+
+image_error& image_error::operator+=(const image_error& other) noexcept {
+	for (std::size_t channel = 0UL; channel < channels; ++channel) {
+		squared_error[channel] += other.squared_error[channel];
+		ssim[channel] += other.ssim[channel];
+	}
+	pixels += other.pixels;
+	blocks += other.blocks;
+	return *this;
+}
+
+double image_error::mse(std::size_t channel) const noexcept {
+	if (pixels == 0U) { return 0.0; }
+	return static_cast<double>(squared_error[channel]) / static_cast<double>(pixels);
+}
+
+double image_error::mse(bool alpha) const noexcept {
+	const std::size_t used_channels = alpha ? channels : channels - 1UL;
+	double total{};
+	for (std::size_t channel = 0UL; channel < used_channels; ++channel) { total += mse(channel); }
+	return total / static_cast<double>(used_channels);
+}
+
+double image_error::mean_ssim(bool alpha) const noexcept {
+	if (blocks == 0U) { return 1.0; }
+	const std::size_t used_channels = alpha ? channels : channels - 1UL;
+	double total{};
+	for (std::size_t channel = 0UL; channel < used_channels; ++channel) { total += ssim[channel]; }
+	return total / static_cast<double>(used_channels * blocks);
+}
+
+double psnr(double mse) noexcept {
+	if (mse <= 0.0) { return std::numeric_limits<double>::infinity(); }
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void add_error(const image& source, std::size_t first_block, pixel_block_image decoded, std::size_t height,
+	image_error& error) noexcept {
+	assert(source.layout() == pixel_layout::blocks);
+	assert(height <= source.height());
+	const auto source_data = source.data();
+	const auto* source_pixels = reinterpret_cast<const std::uint32_t*>(source_data.data());
+	assert((first_block * block_pixels) + decoded.size() <= source_data.size() / image::bytes_per_pixel);
+
+	const std::size_t blocks_per_row = source.padded_width() / pixel_block_side;
+	const std::size_t block_count = decoded.size() / block_pixels;
+	for (std::size_t index = 0UL; index < block_count; ++index) {
+		const std::size_t block_index = first_block + index;
+		const std::size_t block_x = (block_index % blocks_per_row) * pixel_block_side;
+		const std::size_t block_y = (block_index / blocks_per_row) * pixel_block_side;
+		if (block_y >= height) { break; }
+		const std::size_t columns = std::min(pixel_block_side, source.width() - block_x);
+		const std::size_t rows = std::min(pixel_block_side, height - block_y);
+		const std::uint32_t* source_block = source_pixels + block_index * block_pixels;
+		const std::uint32_t* decoded_block = &decoded[index * block_pixels];
+		if (columns == pixel_block_side && rows == pixel_block_side) {
+			add_block(full_block_sums(source_block, decoded_block), block_pixels, error);
+		} else {
+			add_block(partial_block_sums(source_block, decoded_block, columns, rows), columns * rows, error);
+		}
+	}
+}
+
+image_error compare(const image& source, pixel_block_image decoded) noexcept {
+	image_error result{};
+	add_error(source, 0UL, decoded, source.height(), result);
+	return result;
+}
+
+} // namespace todds
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "todds/image.hpp"
+#include "todds/image_types.hpp"
 
 namespace todds {
 
@@ -25,4 +26,12 @@ float alpha_coverage(std::uint8_t alpha_reference, const image& img);
  */
 void scale_alpha_to_coverage(float desired_coverage, std::uint8_t alpha_reference, image& img);
 
+/**
+ * Check if any pixel of an image is not fully opaque. When using alpha_format, this determines if a file should be
+ * encoded with the alpha format.
+ * @param pixels Pixels of the image.
+ * @return True if any pixel has an alpha value below the maximum.
+ */
+[[nodiscard]] bool has_alpha(pixel_block_image pixels) noexcept;
+
 } // namespace todds
@@ -9,11 +9,25 @@
 
 #include <opencv2/core.hpp>
 
+#include <cassert>
 #include <cstdint>
 #include <span>
 
 namespace todds {
 
+/**
+ * Arrangement of the pixels of an image in memory.
+ */
+enum class pixel_layout : std::uint8_t {
+	/** Pixels are stored row by row. */
+	rows,
+	/**
+	 * Pixels are stored in 4x4 blocks, and blocks are stored row by row. This is the layout used by DDS encoders.
+	 * Width and height are padded to multiples of 4 by repeating the last column and the last row.
+	 */
+	blocks,
+};
+
 /**
  * Image loaded in memory in an RGBA memory layout.
  * Image is only a view and is not the owner of the memory. See mipmap_image for details.
@@ -22,7 +36,7 @@ class image final {
 public:
 	static constexpr std::uint8_t bytes_per_pixel = 4U;
 
-	image(std::size_t width, std::size_t height);
+	image(std::size_t width, std::size_t height, pixel_layout layout = pixel_layout::rows);
 	image(const image&) = delete;
 	image(image&&) noexcept = default;
 	image& operator=(const image&) = delete;
@@ -41,6 +55,24 @@ public:
 	 */
 	[[nodiscard]] std::size_t height() const noexcept;
 
+	/**
+	 * Width of the image in memory, including padding.
+	 * @return Width of this image in memory.
+	 */
+	[[nodiscard]] std::size_t padded_width() const noexcept;
+
+	/**
+	 * Height of the image in memory, including padding.
+	 * @return Height of this image in memory.
+	 */
+	[[nodiscard]] std::size_t padded_height() const noexcept;
+
+	/**
+	 * Memory layout of the pixels of this image.
+	 * @return Pixel layout.
+	 */
+	[[nodiscard]] pixel_layout layout() const noexcept;
+
 	void set_data(std::span<std::uint8_t> data);
 
 	/**
@@ -57,19 +89,35 @@ public:
 	[[nodiscard]] std::span<const std::uint8_t> data() const noexcept;
 
 	/**
-	 * Reference to the first byte of the first pixel of a row.
+	 * Reference to the first byte of the first pixel of a row. Only available for pixel_layout::rows.
 	 * @param row Y coordinate of the row.
 	 * @return Reference to the accessed byte.
 	 */
 	[[nodiscard]] const std::uint8_t& row_start(std::size_t row) const noexcept;
 
 	/**
-	 * Reference to the first byte of the first pixel of a row.
+	 * Reference to the first byte of the first pixel of a row. Only available for pixel_layout::rows.
 	 * @param row Y coordinate of the row.
 	 * @return Reference to the accessed byte.
 	 */
 	[[nodiscard]] std::uint8_t& row_start(std::size_t row) noexcept;
 
+	/**
+	 * Copy the pixels of a row into a buffer. Supports every pixel layout.
+	 * @param row Y coordinate of the row.
+	 * @param output Buffer of at least width * bytes_per_pixel bytes.
+	 */
+	void read_row(std::size_t row, std::span<std::uint8_t> output) const noexcept;
+
+	/**
+	 * Copy the pixels of a row from a buffer. Supports every pixel layout.
+	 * When using pixel_layout::blocks, padding columns are filled with the last pixel of the row, and writing the last
+	 * row also fills the padding rows.
+	 * @param row Y coordinate of the row.
+	 * @param input Buffer of at least width * bytes_per_pixel bytes.
+	 */
+	void write_row(std::size_t row, std::span<const std::uint8_t> input) noexcept;
+
 	/**
 	 * Write-access to an specific pixel of the image.
 	 * @param pixel_x X coordinate of the pixel.
@@ -88,13 +136,17 @@ public:
 		std::size_t pixel_x, std::size_t pixel_y) const noexcept;
 
 	explicit operator cv::Mat() {
+		assert(_layout == pixel_layout::rows);
 		constexpr auto image_type = CV_8UC4; // NOLINT
 		return {static_cast<int>(height()), static_cast<int>(width()), image_type, static_cast<void*>(_data.data())};
 	}
 
 private:
+	[[nodiscard]] std::size_t pixel_position(std::size_t pixel_x, std::size_t pixel_y) const noexcept;
+
 	std::size_t _width;
 	std::size_t _height;
+	pixel_layout _layout;
 	std::span<std::uint8_t> _data;
 };
 
@@ -0,0 +1,86 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/image.hpp"
+#include "todds/image_types.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace todds {
+
+/**
+ * Difference between an image and a lossy version of it, such as the result of decoding its DDS encoding. The errors of
+ * several images can be added together to obtain the error of all of them.
+ */
+struct image_error {
+	/** Number of channels of each pixel, in RGBA order. */
+	static constexpr std::size_t channels = 4UL;
+
+	/** Sum of the squared differences of each channel. */
+	std::array<std::uint64_t, channels> squared_error{};
+
+	/** Sum of the structural similarity of each channel in each compared 4x4 pixel block. */
+	std::array<double, channels> ssim{};
+
+	/** Number of pixels compared. */
+	std::uint64_t pixels{};
+
+	/** Number of 4x4 pixel blocks compared. */
+	std::uint64_t blocks{};
+
+	image_error& operator+=(const image_error& other) noexcept;
+
+	/**
+	 * Mean squared error of a single channel.
+	 * @param channel Channel index in RGBA order.
+	 * @return Mean squared error, or zero if no pixels have been compared.
+	 */
+	[[nodiscard]] double mse(std::size_t channel) const noexcept;
+
+	/**
+	 * Mean squared error of the color channels.
+	 * @param alpha Include the alpha channel.
+	 * @return Mean squared error, or zero if no pixels have been compared.
+	 */
+	[[nodiscard]] double mse(bool alpha) const noexcept;
+
+	/**
+	 * Mean structural similarity of the color channels, computed over 4x4 pixel blocks.
+	 * @param alpha Include the alpha channel.
+	 * @return Value in [-1, 1], where 1 means that both images are identical.
+	 */
+	[[nodiscard]] double mean_ssim(bool alpha) const noexcept;
+};
+
+/**
+ * Peak signal-to-noise ratio of 8 bit channels.
+ * @param mse Mean squared error.
+ * @return PSNR in decibels. Infinite if mse is zero.
+ */
+[[nodiscard]] double psnr(double mse) noexcept;
+
+/**
+ * Add the error of consecutive 4x4 pixel blocks of a lossy version of an image. Padding pixels are not compared.
+ * @param source Original image, using pixel_layout::blocks.
+ * @param first_block Index in source of the first block of decoded.
+ * @param decoded Pixel blocks to compare with the blocks of source starting at first_block.
+ * @param height Rows of source to compare. Any rows after them are considered padding.
+ * @param error Error in which the result is added.
+ */
+void add_error(const image& source, std::size_t first_block, pixel_block_image decoded, std::size_t height,
+	image_error& error) noexcept;
+
+/**
+ * Compare an image with a lossy version of it. Padding pixels are not compared.
+ * @param source Original image, using pixel_layout::blocks.
+ * @param decoded Pixel blocks with the same dimensions as source.
+ * @return Error of decoded.
+ */
+[[nodiscard]] image_error compare(const image& source, pixel_block_image decoded) noexcept;
+
+} // namespace todds
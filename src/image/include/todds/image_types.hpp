@@ -5,22 +5,21 @@
 
 #pragma once
 
-#include "todds/mipmap_image.hpp"
 #include "todds/vector.hpp"
 
 #include <cstdint>
+#include <span>
 
 namespace todds {
 
 constexpr std::size_t pixel_block_side = 4UL;
 
 /**
- * RGBA pixel block image.
+ * RGBA pixel block image. Each value is a pixel, and every 16 consecutive values form a 4x4 pixel block.
+ * Pixel block images are views of the memory of a mipmap_image using pixel_layout::blocks.
  */
-using pixel_block_image = vector<std::uint32_t>;
+using pixel_block_image = std::span<const std::uint32_t>;
 
-using dds_image = vector<std::uint64_t>;
-
-pixel_block_image to_pixel_blocks(const mipmap_image& img);
+using dds_image = pooled_vector<std::uint64_t>;
 
 } // namespace todds
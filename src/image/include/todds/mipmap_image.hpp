@@ -8,15 +8,29 @@
 #include "todds/image.hpp"
 #include "todds/vector.hpp"
 
+#include <cstdint>
+#include <span>
+
 namespace todds {
+
+/**
+ * Number of images of a mipmap_image with mipmaps, including the main one.
+ * @param width Width of the main image.
+ * @param height Height of the main image.
+ * @return Number of mipmap levels.
+ */
+[[nodiscard]] std::size_t mipmap_levels(std::size_t width, std::size_t height) noexcept;
+
 /**
  * Array composed of a main image and its mipmaps, loaded in memory in an RGBA memory layout.
- * Each image is padded to keep the width and height divisible by 4.
+ * When using pixel_layout::blocks, each image is padded to keep the width and height divisible by 4.
  * mipmap_image is the owner of the memory used for each image.
  */
 class mipmap_image final {
 public:
-	mipmap_image(std::size_t file_index, std::size_t width, std::size_t height, bool mipmaps);
+	mipmap_image(std::size_t file_index, std::size_t width, std::size_t height, bool mipmaps,
+		pixel_layout layout = pixel_layout::rows,
+		allocations::category memory_category = allocations::category::mipmap_images);
 	/**
 	 * Creates a mipmap image of the same size and with the same mipmaps, but it does not copy data.
 	 * @param other Image to copy.
@@ -45,9 +59,16 @@ public:
 
 	[[nodiscard]] std::size_t data_size() const noexcept;
 
+	/**
+	 * View of every image as consecutive 4x4 pixel blocks, ready to be used by DDS encoders.
+	 * Only available for pixel_layout::blocks.
+	 * @return Pixel blocks of every image. Each value is an RGBA pixel.
+	 */
+	[[nodiscard]] std::span<const std::uint32_t> pixel_blocks() const noexcept;
+
 private:
 	std::size_t _file_index;
-	vector<std::uint8_t> _data;
+	pooled_vector<std::uint8_t> _data;
 	vector<image> _images;
 };
 
@@ -0,0 +1,127 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/filter.hpp"
+#include "todds/image.hpp"
+#include "todds/vector.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+
+namespace todds::resample {
+
+/**
+ * Identifies a resampling operation. Images sharing the same key can reuse the same plan.
+ */
+struct plan_key {
+	std::size_t src_width{};
+	std::size_t src_height{};
+	std::size_t dst_width{};
+	std::size_t dst_height{};
+	filter::type filter{};
+	/** Standard deviation of the gaussian blur applied to the source before resampling. Zero disables blurring. */
+	double blur{};
+
+	[[nodiscard]] bool operator==(const plan_key& other) const noexcept = default;
+};
+
+/**
+ * Precomputed coefficients of a one-dimensional resampling operation.
+ * Destination index i is calculated from source indices [start[i], start[i] + taps(i)) using the weights stored in
+ * weights[offset[i]] onwards. Source indices are always inside of the source image.
+ */
+struct axis_plan {
+	vector<std::size_t> start;
+	/** Contains one more element than start, so the number of taps of index i is offset[i + 1] - offset[i]. */
+	vector<std::size_t> offset;
+	vector<float> weights;
+
+	[[nodiscard]] std::size_t taps(std::size_t index) const noexcept { return offset[index + 1UL] - offset[index]; }
+};
+
+/**
+ * Separable resampling plan combining an optional gaussian blur with a scaling filter.
+ * Plans are immutable after construction and can be shared between threads.
+ */
+class plan final {
+public:
+	explicit plan(const plan_key& key);
+
+	[[nodiscard]] const plan_key& key() const noexcept;
+
+	[[nodiscard]] const axis_plan& horizontal() const noexcept;
+
+	[[nodiscard]] const axis_plan& vertical() const noexcept;
+
+	/**
+	 * Number of horizontally resampled source rows that must be kept in memory at the same time.
+	 * @return Size of the row ring buffer.
+	 */
+	[[nodiscard]] std::size_t ring_rows() const noexcept;
+
+private:
+	plan_key _key;
+	std::shared_ptr<const axis_plan> _horizontal;
+	std::shared_ptr<const axis_plan> _vertical;
+	std::size_t _ring_rows;
+};
+
+/**
+ * Obtain a resampling plan from the process-wide plan cache, creating it if necessary. Thread-safe.
+ * @param key Resampling operation.
+ * @return Shared plan for this operation.
+ */
+[[nodiscard]] std::shared_ptr<const plan> get_plan(const plan_key& key);
+
+/**
+ * Resamples an RGBA image one source row at a time.
+ * Each source row is resampled horizontally once and kept in a ring buffer until every destination row using it has
+ * been generated. Only ring_rows() source rows are kept in memory at any given time.
+ */
+class row_resampler final {
+public:
+	/** Receives each destination row as soon as it is available, in order. */
+	using row_callback = std::function<void(std::size_t row, std::span<const std::uint8_t> data)>;
+
+	row_resampler(std::shared_ptr<const plan> resampling_plan, row_callback callback);
+
+	/**
+	 * Feed the next source row.
+	 * @param row RGBA data of the row. It must contain src_width pixels.
+	 */
+	void push_row(std::span<const std::uint8_t> row);
+
+	/**
+	 * Checks if every destination row has been generated.
+	 * @return True after receiving the last source row.
+	 */
+	[[nodiscard]] bool finished() const noexcept;
+
+private:
+	void emit_rows();
+
+	std::shared_ptr<const plan> _plan;
+	row_callback _callback;
+	pooled_vector<float> _ring;
+	pooled_vector<float> _accumulator;
+	pooled_vector<std::uint8_t> _output;
+	std::size_t _rows_pushed;
+	std::size_t _rows_emitted;
+};
+
+/**
+ * Resample an image using a cached plan.
+ * @param src Source image.
+ * @param dst Destination image. Its width and height determine the scaling.
+ * @param filter Scaling interpolation filter.
+ * @param blur Gaussian blur applied to src before resampling. Zero disables blurring.
+ */
+void resample(const image& src, image& dst, filter::type filter, double blur);
+
+} // namespace todds::resample
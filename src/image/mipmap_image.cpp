@@ -4,39 +4,53 @@
  */
 #include "todds/mipmap_image.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace todds {
 
-mipmap_image::mipmap_image(std::size_t file_index, std::size_t width, std::size_t height, bool mipmaps)
+std::size_t mipmap_levels(std::size_t width, std::size_t height) noexcept {
+	constexpr std::size_t minimum_size = 1ULL;
+	std::size_t levels = 1ULL;
+	while (width > minimum_size || height > minimum_size) {
+		width = std::max(width >> 1ULL, minimum_size);
+		height = std::max(height >> 1ULL, minimum_size);
+		++levels;
+	}
+	return levels;
+}
+
+mipmap_image::mipmap_image(
+	std::size_t file_index, std::size_t width, std::size_t height, bool mipmaps, pixel_layout layout,
+	allocations::category memory_category)
 	: _file_index{file_index}
-	, _data{}
+	, _data{pooled_allocator<std::uint8_t>(memory_category)}
 	, _images{} {
 	std::size_t pixels_required{};
 
 	// The first image is always included.
-	_images.emplace_back(width, height);
-	pixels_required += _images.back().width() * _images.back().height();
+	_images.emplace_back(width, height, layout);
+	pixels_required += _images.back().padded_width() * _images.back().padded_height();
 
 	if (mipmaps) {
 		constexpr std::size_t minimum_size = 1ULL;
 		while (width > minimum_size || height > minimum_size) {
 			if (width > minimum_size) { width >>= 1ULL; }
 			if (height > minimum_size) { height >>= 1ULL; }
-			_images.emplace_back(width, height);
-			pixels_required += _images.back().width() * _images.back().height();
+			_images.emplace_back(width, height, layout);
+			pixels_required += _images.back().padded_width() * _images.back().padded_height();
 		}
 	}
 
 	if (pixels_required == 0ULL) { return; }
 
 	// Allocate the memory required for every image in a single contiguous array.
-	_data = todds::vector<std::uint8_t>(pixels_required * image::bytes_per_pixel);
+	_data.resize(pixels_required * image::bytes_per_pixel);
 
 	std::size_t memory_start = 0ULL;
 	// Point each image to its memory chunk.
 	for (image& current : _images) {
-		const std::size_t required_memory = current.width() * current.height() * image::bytes_per_pixel;
+		const std::size_t required_memory = current.padded_width() * current.padded_height() * image::bytes_per_pixel;
 		current.set_data(std::span<std::uint8_t>(&_data[memory_start], required_memory));
 		memory_start += required_memory;
 	}
@@ -46,13 +60,13 @@ mipmap_image::mipmap_image(std::size_t file_index, std::size_t width, std::size_
 
 mipmap_image::mipmap_image(const mipmap_image& other)
 	: _file_index{other.file_index()}
-	, _data(other._data.size())
+	, _data(other._data.size(), other._data.get_allocator())
 	, _images{} {
 	std::size_t memory_start = 0ULL;
 	for (const auto& original_img : other._images) {
-		_images.emplace_back(original_img.width(), original_img.height());
+		_images.emplace_back(original_img.width(), original_img.height(), original_img.layout());
 		image& current = _images.back();
-		const std::size_t required_memory = current.width() * current.height() * image::bytes_per_pixel;
+		const std::size_t required_memory = current.padded_width() * current.padded_height() * image::bytes_per_pixel;
 		current.set_data(std::span<std::uint8_t>(&_data[memory_start], required_memory));
 		memory_start += required_memory;
 	}
@@ -69,4 +83,10 @@ mipmap_image::mipmap_image(const mipmap_image& other)
 
 [[nodiscard]] std::size_t mipmap_image::data_size() const noexcept { return _data.size(); }
 
+[[nodiscard]] std::span<const std::uint32_t> mipmap_image::pixel_blocks() const noexcept {
+	assert(_images.empty() || _images.front().layout() == pixel_layout::blocks);
+	assert(reinterpret_cast<std::uintptr_t>(_data.data()) % alignof(std::uint32_t) == 0U);
+	return {reinterpret_cast<const std::uint32_t*>(_data.data()), _data.size() / sizeof(std::uint32_t)};
+}
+
 } // namespace todds
@@ -0,0 +1,348 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "todds/resample.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <numbers>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+
+using todds::resample::axis_plan;
+using todds::resample::plan_key;
+
+constexpr auto bytes_per_pixel = todds::image::bytes_per_pixel;
+
+// Weights smaller than this value at the borders of a resampling window are discarded.
+constexpr double weight_epsilon = 1e-9;
+
+// The cache is cleared when it reaches this size, to avoid growing without bounds on datasets with many dimensions.
+constexpr std::size_t max_cached_plans = 256UL;
+
+struct tap {
+	std::ptrdiff_t index;
+	double weight;
+};
+
+// Bicubic convolution kernel, using the same coefficient as OpenCV.
+double cubic_weight(double distance) {
+	constexpr double coefficient = -0.75;
+	distance = std::abs(distance);
+	if (distance <= 1.0) { return ((coefficient + 2.0) * distance - (coefficient + 3.0)) * distance * distance + 1.0; }
+	if (distance < 2.0) {
+		return ((coefficient * distance - 5.0 * coefficient) * distance + 8.0 * coefficient) * distance -
+					 4.0 * coefficient;
+	}
+	return 0.0;
+}
+
+// Lanczos kernel with a window of 4 pixels, equivalent to cv::INTER_LANCZOS4.
+double lanczos_weight(double distance) {
+	constexpr double window = 4.0;
+	if (distance == 0.0) { return 1.0; }
+	if (std::abs(distance) >= window) { return 0.0; }
+	const double pi_distance = std::numbers::pi * distance;
+	return window * std::sin(pi_distance) * std::sin(pi_distance / window) / (pi_distance * pi_distance);
+}
+
+// Source taps contributing to a destination index, before clamping them to the source image.
+void scaling_taps(
+	todds::filter::type filter, std::size_t src, std::size_t dst, std::size_t index, std::vector<tap>& taps) {
+	using todds::filter::type;
+	const double scale = static_cast<double>(src) / static_cast<double>(dst);
+	const double center = (static_cast<double>(index) + 0.5) * scale - 0.5;
+	const double base = std::floor(center);
+	const double fraction = center - base;
+	const auto base_index = static_cast<std::ptrdiff_t>(base);
+
+	switch (filter) {
+	case type::nearest:
+		taps.push_back({static_cast<std::ptrdiff_t>(std::floor(static_cast<double>(index) * scale)), 1.0});
+		break;
+	case type::linear:
+		taps.push_back({base_index, 1.0 - fraction});
+		taps.push_back({base_index + 1, fraction});
+		break;
+	case type::cubic:
+		for (std::ptrdiff_t offset = -1; offset <= 2; ++offset) {
+			taps.push_back({base_index + offset, cubic_weight(fraction - static_cast<double>(offset))});
+		}
+		break;
+	case type::area: {
+		// When upscaling, most destination pixels are covered by a single source pixel. Unlike cv::INTER_AREA, which
+		// switches to linear interpolation in this case, this repeats source pixels as nearest neighbor scaling does.
+		const double begin = static_cast<double>(index) * scale;
+		const double end = begin + scale;
+		for (auto current = static_cast<std::ptrdiff_t>(std::floor(begin)); static_cast<double>(current) < end; ++current) {
+			const double overlap =
+				std::min(end, static_cast<double>(current + 1)) - std::max(begin, static_cast<double>(current));
+			if (overlap > 0.0) { taps.push_back({current, overlap / scale}); }
+		}
+		break;
+	}
+	case type::lanczos:
+		for (std::ptrdiff_t offset = -3; offset <= 4; ++offset) {
+			taps.push_back({base_index + offset, lanczos_weight(fraction - static_cast<double>(offset))});
+		}
+		break;
+	}
+}
+
+// Border handling used by gaussian blur, equivalent to cv::BORDER_REFLECT_101.
+std::size_t reflect_101(std::ptrdiff_t index, std::size_t size) {
+	if (size == 1UL) { return 0UL; }
+	const auto last = static_cast<std::ptrdiff_t>(size - 1UL);
+	while (index < 0 || index > last) {
+		if (index < 0) { index = -index; }
+		if (index > last) { index = 2 * last - index; }
+	}
+	return static_cast<std::size_t>(index);
+}
+
+// Gaussian kernel using the same kernel size as cv::GaussianBlur for 8-bit images.
+std::vector<double> gaussian_kernel(double sigma) {
+	if (sigma <= 0.0) { return {1.0}; }
+	const auto kernel_size = static_cast<std::size_t>(std::lround(sigma * 6.0 + 1.0)) | 1UL;
+	const auto radius = static_cast<std::ptrdiff_t>(kernel_size / 2UL);
+	std::vector<double> kernel(kernel_size);
+	double sum{};
+	for (std::ptrdiff_t offset = -radius; offset <= radius; ++offset) {
+		const auto distance = static_cast<double>(offset);
+		const double weight = std::exp(-(distance * distance) / (2.0 * sigma * sigma));
+		kernel[static_cast<std::size_t>(offset + radius)] = weight;
+		sum += weight;
+	}
+	for (double& weight : kernel) { weight /= sum; }
+	return kernel;
+}
+
+std::shared_ptr<const axis_plan> create_axis_plan(
+	todds::filter::type filter, std::size_t src, std::size_t dst, const std::vector<double>& kernel) {
+	assert(src > 0UL && dst > 0UL);
+	auto axis = std::make_shared<axis_plan>();
+	axis->start.reserve(dst);
+	axis->offset.reserve(dst + 1UL);
+	axis->offset.push_back(0UL);
+
+	const auto radius = static_cast<std::ptrdiff_t>(kernel.size() / 2UL);
+	const auto last = static_cast<std::ptrdiff_t>(src - 1UL);
+	std::vector<tap> taps;
+	std::vector<double> window;
+
+	for (std::size_t index = 0UL; index < dst; ++index) {
+		taps.clear();
+		scaling_taps(filter, src, dst, index, taps);
+
+		// Resizing replicates border pixels, while the blur reflects them. Both are folded into the same window.
+		std::size_t window_begin = src;
+		std::size_t window_end = 0UL;
+		for (tap& current : taps) {
+			current.index = std::clamp<std::ptrdiff_t>(current.index, 0, last);
+			for (std::ptrdiff_t offset = -radius; offset <= radius; ++offset) {
+				const std::size_t source = reflect_101(current.index + offset, src);
+				window_begin = std::min(window_begin, source);
+				window_end = std::max(window_end, source + 1UL);
+			}
+		}
+
+		window.assign(window_end - window_begin, 0.0);
+		for (const tap& current : taps) {
+			for (std::ptrdiff_t offset = -radius; offset <= radius; ++offset) {
+				const std::size_t source = reflect_101(current.index + offset, src);
+				window[source - window_begin] += current.weight * kernel[static_cast<std::size_t>(offset + radius)];
+			}
+		}
+
+		// Discard empty weights at both ends of the window.
+		std::size_t first = 0UL;
+		std::size_t end = window.size();
+		while (first + 1UL < end && std::abs(window[first]) < weight_epsilon) { ++first; }
+		while (end - 1UL > first && std::abs(window[end - 1UL]) < weight_epsilon) { --end; }
+
+		double sum{};
+		for (std::size_t position = first; position < end; ++position) { sum += window[position]; }
+		for (std::size_t position = first; position < end; ++position) {
+			axis->weights.push_back(static_cast<float>(window[position] / sum));
+		}
+		axis->start.push_back(window_begin + first);
+		axis->offset.push_back(axis->weights.size());
+	}
+
+	return axis;
+}
+
+// Destination rows are generated in order. A source row must be kept while any pending destination row uses it.
+std::size_t ring_size(const axis_plan& axis) {
+	const std::size_t count = axis.start.size();
+	std::vector<std::size_t> suffix_min_start(count);
+	std::size_t min_start = std::numeric_limits<std::size_t>::max();
+	for (std::size_t index = count; index > 0UL; --index) {
+		min_start = std::min(min_start, axis.start[index - 1UL]);
+		suffix_min_start[index - 1UL] = min_start;
+	}
+
+	std::size_t max_end{};
+	std::size_t rows = 1UL;
+	for (std::size_t index = 0UL; index < count; ++index) {
+		max_end = std::max(max_end, axis.start[index] + axis.taps(index));
+		rows = std::max(rows, max_end - suffix_min_start[index]);
+	}
+	return rows;
+}
+
+struct plan_key_hash {
+	std::size_t operator()(const plan_key& key) const noexcept {
+		std::size_t seed = std::hash<std::size_t>{}(key.src_width);
+		const auto combine = [&seed](std::size_t value) { seed ^= value + 0x9e3779b9UL + (seed << 6UL) + (seed >> 2UL); };
+		combine(std::hash<std::size_t>{}(key.src_height));
+		combine(std::hash<std::size_t>{}(key.dst_width));
+		combine(std::hash<std::size_t>{}(key.dst_height));
+		combine(static_cast<std::size_t>(key.filter));
+		combine(std::hash<double>{}(key.blur));
+		return seed;
+	}
+};
+
+std::uint8_t to_byte(float value) {
+	constexpr float max_value = 255.0F;
+	return static_cast<std::uint8_t>(std::clamp(value, 0.0F, max_value) + 0.5F);
+}
+
+} // Anonymous namespace
+
+namespace todds::resample {
+
+plan::plan(const plan_key& key)
+	: _key{key}
+	, _horizontal{}
+	, _vertical{}
+	, _ring_rows{} {
+	const std::vector<double> kernel = gaussian_kernel(key.blur);
+	_horizontal = create_axis_plan(key.filter, key.src_width, key.dst_width, kernel);
+	if (key.src_width == key.src_height && key.dst_width == key.dst_height) {
+		_vertical = _horizontal;
+	} else {
+		_vertical = create_axis_plan(key.filter, key.src_height, key.dst_height, kernel);
+	}
+	_ring_rows = ring_size(*_vertical);
+}
+
+const plan_key& plan::key() const noexcept { return _key; }
+
+const axis_plan& plan::horizontal() const noexcept { return *_horizontal; }
+
+const axis_plan& plan::vertical() const noexcept { return *_vertical; }
+
+std::size_t plan::ring_rows() const noexcept { return _ring_rows; }
+
+std::shared_ptr<const plan> get_plan(const plan_key& key) {
+	static std::shared_mutex mutex;
+	static std::unordered_map<plan_key, std::shared_ptr<const plan>, plan_key_hash> cache;
+
+	{
+		const std::shared_lock lock{mutex};
+		if (const auto found = cache.find(key); found != cache.end()) { return found->second; }
+	}
+
+	// Plans are created outside of the lock. If two threads race to create the same plan, the first one is kept.
+	auto created = std::make_shared<const plan>(key);
+	const std::unique_lock lock{mutex};
+	if (cache.size() >= max_cached_plans) { cache.clear(); }
+	return cache.try_emplace(key, std::move(created)).first->second;
+}
+
+row_resampler::row_resampler(std::shared_ptr<const plan> resampling_plan, row_callback callback)
+	: _plan{std::move(resampling_plan)}
+	, _callback{std::move(callback)}
+	, _ring(_plan->ring_rows() * _plan->key().dst_width * bytes_per_pixel, 0.0F,
+			pooled_allocator<float>(allocations::category::blur_scratch))
+	, _accumulator(
+			_plan->key().dst_width * bytes_per_pixel, 0.0F, pooled_allocator<float>(allocations::category::blur_scratch))
+	, _output(_plan->key().dst_width * bytes_per_pixel, std::uint8_t{},
+			pooled_allocator<std::uint8_t>(allocations::category::blur_scratch))
+	, _rows_pushed{}
+	, _rows_emitted{} {}
+
+void row_resampler::push_row(std::span<const std::uint8_t> row) {
+	const axis_plan& horizontal = _plan->horizontal();
+	const std::size_t dst_width = _plan->key().dst_width;
+	assert(row.size() >= _plan->key().src_width * bytes_per_pixel);
+	assert(_rows_pushed < _plan->key().src_height);
+
+	float* ring_row = &_ring[(_rows_pushed % _plan->ring_rows()) * dst_width * bytes_per_pixel];
+	for (std::size_t dst_x = 0UL; dst_x < dst_width; ++dst_x) {
+		const std::uint8_t* pixel = &row[horizontal.start[dst_x] * bytes_per_pixel];
+		const float* weight = &horizontal.weights[horizontal.offset[dst_x]];
+		const std::size_t taps = horizontal.taps(dst_x);
+		float red{};
+		float green{};
+		float blue{};
+		float alpha{};
+		for (std::size_t index = 0UL; index < taps; ++index) {
+			red += weight[index] * static_cast<float>(pixel[0UL]);
+			green += weight[index] * static_cast<float>(pixel[1UL]);
+			blue += weight[index] * static_cast<float>(pixel[2UL]);
+			alpha += weight[index] * static_cast<float>(pixel[3UL]);
+			pixel += bytes_per_pixel;
+		}
+		ring_row[0UL] = red;
+		ring_row[1UL] = green;
+		ring_row[2UL] = blue;
+		ring_row[3UL] = alpha;
+		ring_row += bytes_per_pixel;
+	}
+
+	++_rows_pushed;
+	emit_rows();
+}
+
+void row_resampler::emit_rows() {
+	const axis_plan& vertical = _plan->vertical();
+	const std::size_t dst_height = _plan->key().dst_height;
+	const std::size_t row_size = _accumulator.size();
+	const std::size_t ring_rows = _plan->ring_rows();
+
+	while (_rows_emitted < dst_height && vertical.start[_rows_emitted] + vertical.taps(_rows_emitted) <= _rows_pushed) {
+		std::fill(_accumulator.begin(), _accumulator.end(), 0.0F);
+		const float* weight = &vertical.weights[vertical.offset[_rows_emitted]];
+		const std::size_t taps = vertical.taps(_rows_emitted);
+		for (std::size_t index = 0UL; index < taps; ++index) {
+			const float* ring_row = &_ring[((vertical.start[_rows_emitted] + index) % ring_rows) * row_size];
+			const float current_weight = weight[index];
+			for (std::size_t position = 0UL; position < row_size; ++position) {
+				_accumulator[position] += current_weight * ring_row[position];
+			}
+		}
+		std::transform(_accumulator.cbegin(), _accumulator.cend(), _output.begin(), to_byte);
+		_callback(_rows_emitted, _output);
+		++_rows_emitted;
+	}
+}
+
+bool row_resampler::finished() const noexcept { return _rows_emitted == _plan->key().dst_height; }
+
+void resample(const image& src, image& dst, filter::type filter, double blur) {
+	row_resampler resampler{get_plan({src.width(), src.height(), dst.width(), dst.height(), filter, blur}),
+		[&dst](std::size_t row, std::span<const std::uint8_t> data) { dst.write_row(row, data); }};
+
+	const std::size_t row_size = src.width() * image::bytes_per_pixel;
+	if (src.layout() == pixel_layout::rows) {
+		for (std::size_t row = 0UL; row < src.height(); ++row) { resampler.push_row({&src.row_start(row), row_size}); }
+	} else {
+		pooled_vector<std::uint8_t> buffer(row_size, pooled_allocator<std::uint8_t>(allocations::category::blur_scratch));
+		for (std::size_t row = 0UL; row < src.height(); ++row) {
+			src.read_row(row, buffer);
+			resampler.push_row(buffer);
+		}
+	}
+	assert(resampler.finished());
+}
+
+} // namespace todds::resample
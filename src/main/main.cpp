@@ -57,19 +57,20 @@ void handle_ctrl_c_signal() {
 }
 #endif
 
-void process_pipeline_reports(
-	const todds::args::data& data, std::future<void>& pipeline, todds::report_queue& updates) {
+void process_pipeline_reports(const todds::args::data& data, todds::report_queue& updates) {
 	std::size_t current_texture_count{};
 	std::size_t total_texture_count{};
+	// Progress counters are not reported through events. While they are displayed, they are checked periodically.
+	constexpr std::chrono::milliseconds progress_interval{50};
 
-	while (!updates.empty() || pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+	bool running = true;
+	while (running) {
+		running = data.progress ? updates.wait_for(progress_interval) : updates.wait();
 		todds::report update{};
-		const std::size_t previous_texture_count = current_texture_count;
 
 		while (updates.try_pop(update)) {
 			switch (update.type()) {
 			case todds::report_type::retrieving_files_started: cout << "Retrieving files to be processed.\n"; break;
-			case todds::report_type::retrieving_files_progress: break;
 			case todds::report_type::file_retrieval_time:
 				cout << fmt::format("File retrieval time: {:.3f} seconds.\n", (static_cast<double>(update.value()) / 1000.0));
 				break;
@@ -80,11 +81,20 @@ void process_pipeline_reports(
 				total_texture_count = update.value();
 				cout << fmt::format("Processing {:d} textures.\n", total_texture_count);
 				break;
-			case todds::report_type::encoding_progress: ++current_texture_count; break;
 			case todds::report_type::pipeline_error: cerr << update.data() << '\n'; break;
+			case todds::report_type::memory_statistics:
+			case todds::report_type::numa_statistics:
+			case todds::report_type::resource_limits:
+				if (data.verbose) { cout << fmt::format("{:s}\n", update.data()); }
+				break;
+			case todds::report_type::stage_statistics:
+			case todds::report_type::performance_counters:
+			case todds::report_type::sweep_results: cout << fmt::format("{:s}\n", update.data()); break;
 			}
 		}
 
+		const std::size_t previous_texture_count = current_texture_count;
+		current_texture_count = updates.progress(todds::progress_type::encoded_textures);
 		if (data.progress && previous_texture_count < current_texture_count) {
 			// \r without a \n at the end to reuse the same line.
 			cout << fmt::format("\rProgress: {:d}/{:d}", current_texture_count, total_texture_count);
@@ -92,8 +102,6 @@ void process_pipeline_reports(
 
 		cout.flush();
 		cerr.flush();
-		using namespace std::chrono_literals;
-		std::this_thread::sleep_for(50ms);
 	}
 
 	// Set up the stream for the next string.
@@ -122,7 +130,8 @@ int main(int argc, char** argv) {
 			handle_ctrl_c_signal();
 			todds::report_queue updates;
 			std::future<void> pipeline = todds::run(data, force_finish, updates);
-			process_pipeline_reports(data, pipeline, updates);
+			process_pipeline_reports(data, updates);
+			pipeline.wait();
 
 			execution_status = EXIT_SUCCESS;
 			if (encoding_cancelled) { cout << "Encoding cancelled.\n"; }
@@ -0,0 +1,142 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/capture.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+using todds::capture::alignment;
+
+// The file header and each record header are padded to the alignment of the records.
+constexpr std::size_t header_values = alignment / sizeof(std::uint64_t);
+
+using header = std::array<std::uint64_t, header_values>;
+
+// Positions of each value in the headers.
+constexpr std::size_t magic_position = 0UL;
+constexpr std::size_t version_position = 1UL;
+constexpr std::size_t images_position = 2UL;
+constexpr std::size_t file_index_position = 0UL;
+constexpr std::size_t width_position = 1UL;
+constexpr std::size_t height_position = 2UL;
+constexpr std::size_t bytes_position = 3UL;
+
+constexpr std::size_t aligned(std::size_t bytes) noexcept { return (bytes + alignment - 1UL) / alignment * alignment; }
+
+void write_header(boost::nowide::ofstream& output, const header& values) {
+	output.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(sizeof(header)));
+}
+
+header read_header(std::span<const std::uint8_t> data, std::size_t position) {
+	header result{};
+	std::memcpy(result.data(), data.data() + position, sizeof(header));
+	return result;
+}
+
+} // Anonymous namespace
+
+namespace todds::capture {
+
+writer::writer(const boost::filesystem::path& path)
+	: _enabled{!path.empty()} {
+	if (!_enabled) { return; }
+	_output.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	header values{};
+	values[magic_position] = magic;
+	values[version_position] = version;
+	write_header(_output, values);
+}
+
+bool writer::enabled() const noexcept { return _enabled; }
+
+bool writer::good() const {
+	const std::lock_guard lock{_mutex};
+	return !_enabled || static_cast<bool>(_output);
+}
+
+void writer::write(const mipmap_image& img) {
+	const image& main = img.get_image(0UL);
+	// The reader expects the padded size of pixel_layout::blocks.
+	assert(main.layout() == pixel_layout::blocks);
+	const auto data = main.data();
+	header values{};
+	values[file_index_position] = img.file_index();
+	values[width_position] = main.width();
+	values[height_position] = main.height();
+	values[bytes_position] = data.size();
+	constexpr std::array<char, alignment> padding{};
+
+	const std::lock_guard lock{_mutex};
+	write_header(_output, values);
+	_output.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	_output.write(padding.data(), static_cast<std::streamsize>(aligned(data.size()) - data.size()));
+	++_images;
+}
+
+void writer::close() {
+	if (!_enabled) { return; }
+	const std::lock_guard lock{_mutex};
+	_output.seekp(static_cast<std::streamoff>(images_position * sizeof(std::uint64_t)));
+	_output.write(reinterpret_cast<const char*>(&_images), static_cast<std::streamsize>(sizeof(_images)));
+	_output.close();
+}
+
+reader::reader(const boost::filesystem::path& path) {
+	try {
+		_file = boost::interprocess::file_mapping{path.string().c_str(), boost::interprocess::read_only};
+		_region = boost::interprocess::mapped_region{_file, boost::interprocess::copy_on_write};
+	} catch (const boost::interprocess::interprocess_exception& exception) {
+		throw std::runtime_error{fmt::format("Could not map {:s}: {:s}", path.string(), exception.what())};
+	}
+
+	const std::span<std::uint8_t> data{static_cast<std::uint8_t*>(_region.get_address()), _region.get_size()};
+	const auto invalid = [&path](std::string_view reason) {
+		return std::runtime_error{fmt::format("{:s} is not a valid capture file: {:s}", path.string(), reason)};
+	};
+	if (data.size() < sizeof(header)) { throw invalid("missing header"); }
+	const header values = read_header(data, 0UL);
+	if (values[magic_position] != magic) { throw invalid("unknown format"); }
+	if (values[version_position] != version) { throw invalid(fmt::format("version {:d}", values[version_position])); }
+
+	const std::size_t images = values[images_position];
+	_entries.reserve(images);
+	std::size_t position = sizeof(header);
+	for (std::size_t index = 0UL; index < images; ++index) {
+		if (data.size() - position < sizeof(header)) { throw invalid("truncated record"); }
+		const header record = read_header(data, position);
+		const image expected{record[width_position], record[height_position], pixel_layout::blocks};
+		const std::size_t bytes = record[bytes_position];
+		position += sizeof(header);
+		if (bytes != expected.padded_width() * expected.padded_height() * image::bytes_per_pixel ||
+				data.size() - position < bytes) {
+			throw invalid("truncated image");
+		}
+		_entries.push_back({record[file_index_position], record[width_position], record[height_position],
+			data.subspan(position, bytes)});
+		position += std::min(aligned(bytes), data.size() - position);
+	}
+}
+
+std::size_t reader::size() const noexcept { return _entries.size(); }
+
+std::size_t reader::file_index(std::size_t index) const noexcept { return _entries[index].file_index; }
+
+image reader::get_image(std::size_t index) const {
+	const entry& current = _entries[index];
+	image result{current.width, current.height, pixel_layout::blocks};
+	result.set_data(current.data);
+	return result;
+}
+
+} // namespace todds::capture
@@ -0,0 +1,184 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "file_report.hpp"
+
+#include "todds/format.hpp"
+#include "todds/image_types.hpp"
+#include "todds/string.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+using todds::pipeline::impl::stage;
+
+// Fields of each record, in order.
+constexpr std::array<std::string_view, 18UL> field_names{"file", "width", "height", "mipmaps", "format", "numa_node",
+	"thread", "input_bytes", "output_bytes", "load_ms", "decode_ms", "scale_ms", "mipmap_ms", "encode_ms", "save_ms",
+	"stream_ms", "solid_blocks", "total_ms"};
+
+// Fields added when the report includes error metrics. Mipmap fields contain a value for each level, starting with the
+// main image.
+constexpr std::array<std::string_view, 8UL> error_field_names{
+	"rmse", "psnr", "red_rmse", "green_rmse", "blue_rmse", "alpha_rmse", "mip_rmse", "mip_psnr"};
+
+// Values are formatted directly into todds strings, so their allocations are recorded like the rest of the record.
+template<typename... Args> todds::string format_text(fmt::format_string<Args...> text, Args&&... args) {
+	todds::string result{};
+	fmt::format_to(std::back_inserter(result), text, std::forward<Args>(args)...);
+	return result;
+}
+
+double to_milliseconds(std::int64_t nanoseconds) noexcept { return static_cast<double>(nanoseconds) / 1.0e6; }
+
+todds::string milliseconds(const todds::pipeline::impl::file_data& data, stage type) {
+	return format_text(
+		"{:.3f}", to_milliseconds(data.durations[static_cast<std::size_t>(type)].load(std::memory_order_relaxed)));
+}
+
+// JSON does not support infinite values, which are written for levels without any error.
+todds::string psnr_value(double mse, bool csv) {
+	const double value = todds::psnr(mse);
+	if (std::isinf(value)) { return todds::string{csv ? "inf" : "null"}; }
+	return format_text("{:.3f}", value);
+}
+
+todds::string rmse_value(double mse) { return format_text("{:.4f}", std::sqrt(mse)); }
+
+// Values of each level are separated by semicolons in CSV, and written as an array in JSON.
+template<typename Function> todds::string level_values(const todds::vector<todds::image_error>& errors, bool csv,
+	Function value) {
+	todds::string result{csv ? "" : "["};
+	for (std::size_t index = 0UL; index < errors.size(); ++index) {
+		if (index > 0UL) { result += csv ? ';' : ','; }
+		result += value(errors[index]);
+	}
+	if (!csv) { result += ']'; }
+	return result;
+}
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+string quote(std::string_view text, bool csv) {
+	constexpr unsigned int first_printable = 0x20U;
+	string result{'"'};
+	for (const char character : text) {
+		const auto code = static_cast<unsigned char>(character);
+		if (csv) {
+			if (character == '"') { result += '"'; }
+			result += character;
+		} else if (character == '"' || character == '\\') {
+			result += '\\';
+			result += character;
+		} else if (character == '\n') {
+			result += R"(\n)";
+		} else if (character == '\t') {
+			result += R"(\t)";
+		} else if (code < first_printable) {
+			result += fmt::format(R"(\u{:04x})", code);
+		} else {
+			result += character;
+		}
+	}
+	result += '"';
+	return result;
+}
+
+std::size_t solid_blocks(std::span<const std::uint32_t> blocks) noexcept {
+	constexpr std::size_t block_pixels = pixel_block_side * pixel_block_side;
+	std::size_t result{};
+	for (std::size_t start = 0UL; start + block_pixels <= blocks.size(); start += block_pixels) {
+		const auto block = blocks.subspan(start, block_pixels);
+		if (std::all_of(block.begin() + 1, block.end(), [first = block.front()](std::uint32_t pixel) {
+					return pixel == first;
+				})) {
+			++result;
+		}
+	}
+	return result;
+}
+
+file_report::file_report(const boost::filesystem::path& path, bool errors)
+	: _enabled{!path.empty()}
+	, _errors{_enabled && errors}
+	, _csv{path.extension() == ".csv"} {
+	if (!_enabled) { return; }
+	_output.open(path, std::ios::out);
+	if (!_csv) { return; }
+	for (std::size_t index = 0UL; index < field_names.size(); ++index) {
+		_output << (index > 0UL ? "," : "") << field_names[index];
+	}
+	if (_errors) {
+		for (const std::string_view name : error_field_names) { _output << ',' << name; }
+	}
+	_output << '\n';
+}
+
+bool file_report::enabled() const noexcept { return _enabled; }
+
+bool file_report::errors() const noexcept { return _errors; }
+
+bool file_report::good() const {
+	const std::lock_guard lock{_mutex};
+	return !_enabled || _output.good();
+}
+
+void file_report::write(const boost::filesystem::path& path, const file_data& data) {
+	const auto total =
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - data.start).count();
+	const string file = quote(path.string(), _csv);
+	const std::string_view format_name = format::name(data.format);
+	const string format_value = _csv ? string{format_name} : quote(format_name, false);
+	const std::size_t solid_blocks = data.solid_blocks.load(std::memory_order_relaxed);
+
+	const std::array<string, field_names.size()> values{file, format_text("{:d}", data.width),
+		format_text("{:d}", data.height), format_text("{:d}", data.mipmaps), format_value,
+		format_text("{:d}", data.numa_node), format_text("{:d}", data.thread), format_text("{:d}", data.input_bytes),
+		format_text("{:d}", data.output_bytes), milliseconds(data, stage::load), milliseconds(data, stage::decode),
+		milliseconds(data, stage::scale), milliseconds(data, stage::mipmap), milliseconds(data, stage::encode),
+		milliseconds(data, stage::save), milliseconds(data, stage::stream), format_text("{:d}", solid_blocks),
+		format_text("{:.3f}", to_milliseconds(total))};
+
+	string record{_csv ? "" : "{"};
+	for (std::size_t index = 0UL; index < values.size(); ++index) {
+		if (index > 0UL) { record += ','; }
+		if (!_csv) { record += fmt::format(R"("{:s}":)", field_names[index]); }
+		record += values[index];
+	}
+	if (_errors) {
+		image_error total{};
+		for (const image_error& level : data.level_errors) { total += level; }
+		const bool alpha = data.alpha;
+		const std::array<string, error_field_names.size()> error_values{rmse_value(total.mse(alpha)),
+			psnr_value(total.mse(alpha), _csv), rmse_value(total.mse(0UL)), rmse_value(total.mse(1UL)),
+			rmse_value(total.mse(2UL)), rmse_value(total.mse(3UL)),
+			level_values(data.level_errors, _csv, [alpha](const image_error& level) { return rmse_value(level.mse(alpha)); }),
+			level_values(data.level_errors, _csv,
+				[alpha, csv = _csv](const image_error& level) { return psnr_value(level.mse(alpha), csv); })};
+		for (std::size_t index = 0UL; index < error_values.size(); ++index) {
+			record += ',';
+			if (!_csv) { record += fmt::format(R"("{:s}":)", error_field_names[index]); }
+			record += error_values[index];
+		}
+	}
+	record += _csv ? "\n" : "}\n";
+
+	// Each record is flushed, so the report is complete up to the last saved file even if todds is terminated.
+	const std::lock_guard lock{_mutex};
+	_output << record;
+	_output.flush();
+}
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,55 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/string.hpp"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+
+#include "filter_common.hpp"
+
+namespace todds::pipeline::impl {
+
+// Paths are quoted in both formats. CSV escapes quotes by doubling them, and JSON with a backslash. JSON also escapes
+// control characters, while CSV keeps them inside the quotes.
+[[nodiscard]] string quote(std::string_view text, bool csv);
+
+// Number of 4x4 pixel blocks in which every pixel has the same value.
+[[nodiscard]] std::size_t solid_blocks(std::span<const std::uint32_t> blocks) noexcept;
+
+// Writes the measurements of each file as soon as it has been saved, so the report can be followed during the run.
+// Files ending in .csv use comma separated values with a header row. Any other file uses JSON Lines.
+class file_report final {
+public:
+	// An empty path disables the report. When errors is true, records include the error of each file and mipmap level.
+	explicit file_report(const boost::filesystem::path& path, bool errors = false);
+
+	[[nodiscard]] bool enabled() const noexcept;
+
+	// True if the encoding stages must measure the error of each mipmap level.
+	[[nodiscard]] bool errors() const noexcept;
+
+	// False if the report could not be opened or written.
+	[[nodiscard]] bool good() const;
+
+	// Write the record of a file. Thread-safe.
+	void write(const boost::filesystem::path& path, const file_data& data);
+
+private:
+	bool _enabled;
+	bool _errors;
+	bool _csv;
+	mutable std::mutex _mutex;
+	boost::nowide::ofstream _output;
+};
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,23 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "filter_capture.hpp"
+
+#include "todds/profiler.hpp"
+
+namespace todds::pipeline::impl {
+
+oneapi::tbb::filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>> capture_filter(
+	capture::writer& output) {
+	return oneapi::tbb::make_filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>>(
+		oneapi::tbb::filter_mode::parallel, [&output](std::unique_ptr<mipmap_image> img) {
+			TracyZoneScopedN("capture");
+			// Files which could not be decoded are not captured.
+			if (img != nullptr) { output.write(*img); }
+			return img;
+		});
+}
+
+} // namespace todds::pipeline::impl
@@ -5,12 +5,17 @@
 
 #pragma once
 
+#include "todds/capture.hpp"
 #include "todds/mipmap_image.hpp"
 
-#include "filter_common.hpp"
-#include "filter_decode_png.hpp"
+#include <oneapi/tbb/parallel_pipeline.h>
+
+#include <memory>
 
 namespace todds::pipeline::impl {
-oneapi::tbb::filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>> generate_mipmaps_filter(
-	filter::type filter, double blur);
+
+// Writes each decoded image into a capture file, and passes it unchanged to the next filter.
+oneapi::tbb::filter<std::unique_ptr<mipmap_image>, std::unique_ptr<mipmap_image>> capture_filter(
+	capture::writer& output);
+
 } // namespace todds::pipeline::impl
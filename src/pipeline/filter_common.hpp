@@ -6,26 +6,80 @@
 #pragma once
 
 #include "todds/format.hpp"
+#include "todds/image_error.hpp"
 #include "todds/report.hpp"
+#include "todds/vector.hpp"
 
 #include <oneapi/tbb/concurrent_queue.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <limits>
+#include <string_view>
 
 namespace todds::pipeline::impl {
 
 // Files using this file index have triggered errors and should not be processed.
 constexpr std::size_t error_file_index = std::numeric_limits<std::size_t>::max();
 
+// Work measured by stage_statistics. Pixels are converted into 4x4 blocks while decoding, so this conversion is
+// included in the decode and scale stages.
+enum class stage {
+	// Reading PNG files from disk.
+	load,
+	// Decoding PNG files at their original size.
+	decode,
+	// Decoding PNG files while resampling them to a different size.
+	scale,
+	// Generating each mipmap level from the previous one.
+	mipmap,
+	// Encoding each mipmap level as DDS, or each image as PNG.
+	encode,
+	// Writing encoded files to disk.
+	save,
+	// Loading, decoding, generating mipmaps, encoding and saving large images in bands of rows.
+	stream,
+};
+
+constexpr std::size_t stage_count = 7UL;
+
+constexpr std::array<std::string_view, stage_count> stage_names{
+	"load", "decode", "scale", "mipmap", "encode", "save", "stream"};
+
 struct file_data {
 	// Width of the image excluding extra columns. Set during the decoding PNG stage.
 	std::size_t width{};
 	// Height of the image excluding extra rows. Set during the decoding PNG stage.
 	std::size_t height{};
-	// Number of mipmap levels in the image, including the main one. Set during the decode PNG stage.
+	// Number of mipmap levels in the image, including the main one. Set during the encoding DDS stage.
 	std::size_t mipmaps{};
 	// DDS format of the image. Set during the encoding DDS stage.
 	format::type format{};
+	// Index of the NUMA node processing the file. Set during the loading PNG stage.
+	std::size_t numa_node{};
+	// True once the file has been written to disk. Set during the saving stage.
+	bool saved{};
+
+	// The following values are only measured when a file report has been requested.
+	// Size of the PNG file. Set during the loading PNG stage.
+	std::size_t input_bytes{};
+	// Size of the file written to disk. Set during the saving stage.
+	std::size_t output_bytes{};
+	// Time in which the file started loading.
+	std::chrono::steady_clock::time_point start{};
+	// Nanoseconds spent by each stage on this file. Mipmap levels are generated and encoded by concurrent tasks.
+	std::array<std::atomic<std::int64_t>, stage_count> durations{};
+	// Index of the worker thread which encoded the file, in the task arena of its NUMA node.
+	std::size_t thread{};
+	// Encoded 4x4 blocks in which every pixel has the same value, in every mipmap level.
+	std::atomic<std::size_t> solid_blocks{};
+	// Error of each encoded mipmap level, only measured when the report includes error metrics. Each level is measured
+	// by a different task, so the vector is sized before encoding starts.
+	vector<image_error> level_errors{};
+	// True if the alpha channel is included in the error metrics, which happens for files using the alpha format.
+	bool alpha{};
 };
 
 } // namespace todds::pipeline::impl
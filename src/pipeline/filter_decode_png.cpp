@@ -9,11 +9,14 @@
 #include "todds/mipmap_image.hpp"
 #include "todds/png.hpp"
 #include "todds/profiler.hpp"
+#include "todds/resample.hpp"
 #include "todds/string.hpp"
 #include "todds/util.hpp"
 
 #include <fmt/format.h>
 
+#include <algorithm>
+
 #if defined(TODDS_PIPELINE_DUMP)
 #include <boost/dll/runtime_symbol_info.hpp>
 #include <boost/nowide/fstream.hpp>
@@ -21,20 +24,22 @@
 
 namespace {
 
-std::unique_ptr<todds::mipmap_image> fix_image_size(todds::mipmap_image& original, bool mipmaps) {
-	const auto& original_img = original.get_image(0UL);
-	const auto new_width = todds::util::next_divisible_by_4(original_img.width());
-	const auto new_height = todds::util::next_divisible_by_4(original_img.height());
-	std::unique_ptr<todds::mipmap_image> resized =
-		std::make_unique<todds::mipmap_image>(original.file_index(), new_width, new_height, mipmaps);
-
-	auto& resized_img = resized->get_image(0UL);
-	for (std::size_t row = 0UL; row < original_img.height(); ++row) {
-		const std::uint8_t* original_start = &original_img.row_start(row);
-		const std::uint8_t* original_end = original_start + original_img.width() * todds::image::bytes_per_pixel;
-		std::copy(original_start, original_end, &resized_img.row_start(row));
+std::pair<std::size_t, std::size_t> scaled_size(
+	std::size_t width, std::size_t height, std::uint16_t scale, std::uint32_t max_size) noexcept {
+	width = (width * scale) / 100U;
+	height = (height * scale) / 100U;
+	if (max_size > 0U && (width > max_size || height > max_size)) {
+		if (width > height) {
+			const double ratio = static_cast<double>(max_size) / static_cast<double>(width);
+			width = max_size;
+			height = static_cast<std::size_t>(static_cast<double>(height) * ratio);
+		} else {
+			const double ratio = static_cast<double>(max_size) / static_cast<double>(height);
+			height = max_size;
+			width = static_cast<std::size_t>(static_cast<double>(width) * ratio);
+		}
 	}
-	return resized;
+	return {width, height};
 }
 
 } // namespace
@@ -43,44 +48,47 @@ namespace todds::pipeline::impl {
 
 class decode_png final {
 public:
-	explicit decode_png(vector<file_data>& files_data, const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size,
-		report_queue& updates) noexcept
+	explicit decode_png(vector<file_data>& files_data, const paths_vector& paths, bool vflip, bool fix_size,
+		std::uint16_t scale, std::uint32_t max_size, filter::type scale_filter, pixel_layout layout,
+		report_queue& updates, stage_statistics& statistics) noexcept
 		: _files_data{files_data}
 		, _paths{paths}
 		, _vflip{vflip}
 		, _updates{updates}
-		, _mipmaps{mipmaps}
-		, _fix_size{fix_size} {}
+		, _fix_size{fix_size}
+		, _scale{scale}
+		, _max_size{max_size}
+		, _scale_filter{scale_filter}
+		, _layout{layout}
+		, _statistics{statistics} {}
 
 	std::unique_ptr<mipmap_image> operator()(const png_file& file) const {
 		TracyZoneScopedN("decode");
 		TracyZoneFileIndex(file.file_index);
+		const occupancy_scope scope{_statistics.filters(), pipeline_filter::decode, file.file_index};
 		std::unique_ptr<mipmap_image> result{};
 
 		// If the data is empty, assume that load_png_file already reported an error.
 		if (!file.buffer.empty()) [[likely]] {
-			const string& path = _paths[file.file_index].first.string();
+			const string path{_paths[file.file_index].first.string()};
 			try {
-				auto& file_data = _files_data[file.file_index];
-				// Load the first image of the mipmap image and reserve the memory for the rest of the images.
-				result = png::decode(file.file_index, path, file.buffer, _vflip, file_data.width, file_data.height, _mipmaps);
-				const auto& first = result->get_image(0UL);
-				if (_fix_size && (first.width() % 4 != 0 || first.height() % 4 != 0)) [[unlikely]] {
-					result = fix_image_size(*result, _mipmaps);
-					const auto& new_first = result->get_image(0UL);
-					file_data.width = new_first.width();
-					file_data.height = new_first.height();
-				}
-				file_data.mipmaps = result->mipmap_count();
+				const bool scaled = _scale != 100U || _max_size > 0U;
+				stage_timer timer{_statistics, scaled ? stage::scale : stage::decode, _files_data[file.file_index]};
+				result = scaled ? decode_scaled(file, path) : decode_full(file, path, _layout);
+				if (result != nullptr) { timer.set_bytes(result->data_size()); }
 
 #if defined(TODDS_PIPELINE_DUMP)
-				const auto dmp_path = boost::dll::program_location().parent_path() / "decode_png.dmp";
-				boost::nowide::ofstream dmp{dmp_path, std::ios::out | std::ios::binary};
-				const std::uint8_t* image_start = result->get_image(0).data().data();
-				dmp.write(reinterpret_cast<const char*>(image_start), static_cast<std::ptrdiff_t>(result->data_size()));
+				if (result != nullptr) {
+					const auto dmp_path = boost::dll::program_location().parent_path() / "decode_png.dmp";
+					boost::nowide::ofstream dmp{dmp_path, std::ios::out | std::ios::binary};
+					const std::uint8_t* image_start = result->get_image(0).data().data();
+					dmp.write(reinterpret_cast<const char*>(image_start), static_cast<std::ptrdiff_t>(result->data_size()));
+				}
 #endif // defined(TODDS_PIPELINE_DUMP)
 			} catch (const std::runtime_error& exc) {
 				_updates.emplace(report_type::pipeline_error, fmt::format("PNG Decoding error {:s} -> {:s}", path, exc.what()));
+				_updates.add(progress_type::failed_textures);
+				result = nullptr;
 			}
 		}
 
@@ -88,18 +96,105 @@ public:
 	}
 
 private:
+	// Load the main image. Mipmaps are generated level by level while encoding.
+	std::unique_ptr<mipmap_image> decode_full(const png_file& file, const string& path, pixel_layout layout) const {
+		auto& file_data = _files_data[file.file_index];
+		return png::decode(
+			file.file_index, path, file.buffer, _vflip, _fix_size, file_data.width, file_data.height, false, layout);
+	}
+
+	// Decode the image directly at its scaled size. Non-interlaced files are resampled while their rows are being
+	// decoded, so the source image is never fully stored in memory.
+	std::unique_ptr<mipmap_image> decode_scaled(const png_file& file, const string& path) const {
+		const png::header header = png::read_header(path, file.buffer);
+		auto src_width = header.width;
+		auto src_height = header.height;
+		if (_fix_size) {
+			src_width = util::next_divisible_by_4(src_width);
+			src_height = util::next_divisible_by_4(src_height);
+		}
+
+		const auto [width, height] = scaled_size(src_width, src_height, _scale, _max_size);
+		if (width == 0 || height == 0) {
+			_updates.emplace(report_type::pipeline_error,
+				fmt::format("Could not scale {:s} from ({:d}, {:d}) to ({:d}, {:d}).", path, src_width, src_height, width,
+					height));
+			_updates.add(progress_type::failed_textures);
+			return nullptr;
+		}
+
+		auto result = std::make_unique<mipmap_image>(file.file_index, width, height, false, _layout);
+		// Rows of interlaced files are not decoded in order, so the whole source image is required. Nearest neighbor
+		// scaling is not symmetric, so the source must also be flipped before resampling it.
+		if (header.interlaced || (_vflip && _scale_filter == filter::type::nearest)) [[unlikely]] {
+			const auto source = decode_full(file, path, pixel_layout::rows);
+			resample::resample(source->get_image(0UL), result->get_image(0UL), _scale_filter, 0.0);
+		} else {
+			stream_scaled(file, path, header.height, src_width, src_height, result->get_image(0UL));
+		}
+
+		auto& file_data = _files_data[file.file_index];
+		file_data.width = width;
+		file_data.height = height;
+		return result;
+	}
+
+	void stream_scaled(const png_file& file, const string& path, std::size_t file_height, std::size_t src_width,
+		std::size_t src_height, image& target) const {
+		// Flipping the source vertically is equivalent to flipping the resampled rows.
+		resample::row_resampler resampler{
+			resample::get_plan({src_width, src_height, target.width(), target.height(), _scale_filter, 0.0}),
+			[&target, flip = _vflip](std::size_t row, std::span<const std::uint8_t> data) {
+				const std::size_t target_row = !flip ? row : target.height() - row - 1UL;
+				target.write_row(target_row, data);
+			}};
+
+		// Extra columns and rows added by fix_size are left transparent black, as in png::decode. Extra rows go after
+		// the flipped image, so they are pushed before the first row when flipping.
+		const vector<std::uint8_t> empty_row(src_width * image::bytes_per_pixel);
+		const auto push_extra_rows = [&resampler, &empty_row, extra_rows = src_height - file_height] {
+			for (std::size_t row = 0UL; row < extra_rows && !resampler.finished(); ++row) { resampler.push_row(empty_row); }
+		};
+		if (_vflip) { push_extra_rows(); }
+
+		vector<std::uint8_t> padded_row(empty_row);
+		std::size_t rows{};
+		png::decode_rows(path, file.buffer, [&](std::span<const std::uint8_t> row) {
+			++rows;
+			// Trailing source rows may not contribute to any destination row.
+			if (resampler.finished()) { return; }
+			if (row.size() == padded_row.size()) [[likely]] {
+				resampler.push_row(row);
+			} else {
+				std::copy(row.begin(), row.end(), padded_row.begin());
+				resampler.push_row(padded_row);
+			}
+		});
+
+		if (!_vflip) { push_extra_rows(); }
+
+		if (rows != file_height || !resampler.finished()) [[unlikely]] {
+			throw std::runtime_error{fmt::format("Could not decode every row of {:s}", path)};
+		}
+	}
+
 	vector<file_data>& _files_data;
 	const paths_vector& _paths;
 	bool _vflip;
 	report_queue& _updates;
-	bool _mipmaps;
 	bool _fix_size;
+	std::uint16_t _scale;
+	std::uint32_t _max_size;
+	filter::type _scale_filter;
+	pixel_layout _layout;
+	stage_statistics& _statistics;
 };
 
 oneapi::tbb::filter<png_file, std::unique_ptr<mipmap_image>> decode_png_filter(vector<file_data>& files_data,
-	const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size, report_queue& updates) {
-	return oneapi::tbb::make_filter<png_file, std::unique_ptr<mipmap_image>>(
-		oneapi::tbb::filter_mode::parallel, decode_png(files_data, paths, vflip, mipmaps, fix_size, updates));
+	const paths_vector& paths, bool vflip, bool fix_size, std::uint16_t scale, std::uint32_t max_size,
+	filter::type scale_filter, pixel_layout layout, report_queue& updates, stage_statistics& statistics) {
+	return oneapi::tbb::make_filter<png_file, std::unique_ptr<mipmap_image>>(oneapi::tbb::filter_mode::parallel,
+		decode_png(files_data, paths, vflip, fix_size, scale, max_size, scale_filter, layout, updates, statistics));
 }
 
 } // namespace todds::pipeline::impl
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "todds/filter.hpp"
 #include "todds/input.hpp"
 #include "todds/mipmap_image.hpp"
 #include "todds/vector.hpp"
@@ -17,8 +18,10 @@
 
 #include "filter_common.hpp"
 #include "filter_load_png.hpp"
+#include "stage_statistics.hpp"
 
 namespace todds::pipeline::impl {
 oneapi::tbb::filter<png_file, std::unique_ptr<mipmap_image>> decode_png_filter(vector<file_data>& files_data,
-	const paths_vector& paths, bool vflip, bool mipmaps, bool fix_size, report_queue& updates);
+	const paths_vector& paths, bool vflip, bool fix_size, std::uint16_t scale, std::uint32_t max_size,
+	filter::type scale_filter, pixel_layout layout, report_queue& updates, stage_statistics& statistics);
 } // namespace todds::pipeline::impl
@@ -5,10 +5,19 @@
 
 #include "filter_encode_dds.hpp"
 
+#include "todds/alpha_coverage.hpp"
 #include "todds/dds.hpp"
+#include "todds/profiler.hpp"
+#include "todds/resample.hpp"
+#include "todds/util.hpp"
 
+#include <oneapi/tbb/blocked_range.h>
+#include <oneapi/tbb/parallel_reduce.h>
+#include <oneapi/tbb/task_arena.h>
+#include <oneapi/tbb/task_group.h>
+
+#include <algorithm>
 #include <cassert>
-#include <limits>
 
 #if defined(TODDS_PIPELINE_DUMP)
 #include <boost/dll/runtime_symbol_info.hpp>
@@ -29,139 +38,173 @@ todds::pipeline::impl::dds_data create_dds_data(todds::dds_image image, std::siz
 	return data;
 }
 
-// When using alpha_format, this function determines if a file should be encoded as alpha.
-bool has_alpha(const todds::pixel_block_image& img) {
-	const auto* current_alpha = reinterpret_cast<const std::uint8_t*>(img.data()) + 3U;
-	const auto* end = reinterpret_cast<const std::uint8_t*>(&img.back());
+constexpr std::size_t block_pixels = todds::pixel_block_side * todds::pixel_block_side;
 
-	while (current_alpha <= end) {
-		if (*current_alpha != std::numeric_limits<std::uint8_t>::max()) { return true; }
-		current_alpha += todds::image::bytes_per_pixel;
-	}
+// Number of blocks encoded before measuring their error, when the error of each level is measured.
+constexpr std::size_t group_blocks = 64UL;
+
+// Size of a mipmap level, calculated as in mipmap_image.
+constexpr std::size_t next_level_size(std::size_t size) noexcept { return std::max(size >> 1UL, 1UL); }
 
-	return false;
+// Size of the encoded data of every mipmap level of an image.
+std::size_t encoded_size(todds::format::type format, std::size_t width, std::size_t height, std::size_t levels) {
+	using todds::util::next_divisible_by_4;
+	std::size_t size{};
+	for (std::size_t index = 0UL; index < levels; ++index) {
+		size += todds::dds::encoded_size(format, next_divisible_by_4(width) * next_divisible_by_4(height));
+		width = next_level_size(width);
+		height = next_level_size(height);
+	}
+	return size;
 }
 
 } // Anonymous namespace
 
 namespace todds::pipeline::impl {
 
-class encode_bc1_image final {
+// Each mipmap level is a separate unit of work. A level starts being encoded as soon as it exists, while the next level
+// is being generated from it. Levels are released once they have been encoded and the next level has been generated,
+// so the memory of a file shrinks as its encoding progresses.
+class encode_dds_image final {
 public:
-	encode_bc1_image(vector<file_data>& files_data, const format::quality quality, const bool alpha_black) noexcept
+	explicit encode_dds_image(vector<file_data>& files_data, format::type format, format::type alpha_format,
+		format::quality quality, bool alpha_black, bool mipmaps, filter::type mipmap_filter, double mipmap_blur,
+		stage_statistics& statistics) noexcept
 		: _files_data{files_data}
+		, _format{format}
+		, _alpha_format{alpha_format}
+		, _params{dds::bc7_encode_params(quality)}
 		, _quality{quality}
-		, _alpha_black{alpha_black} {}
-
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		_files_data[pixel_data.file_index].format = format::type::bc1;
-		return create_dds_data(dds::bc1_encode(_quality, _alpha_black, pixel_data.image), pixel_data.file_index);
-	}
-
-private:
-	vector<file_data>& _files_data;
-	format::quality _quality;
-	bool _alpha_black;
-};
+		, _alpha_black{alpha_black}
+		, _mipmaps{mipmaps}
+		, _mipmap_filter{mipmap_filter}
+		, _mipmap_blur{mipmap_blur}
+		, _statistics{statistics} {}
+
+	dds_data operator()(std::unique_ptr<mipmap_image> img) const {
+		TracyZoneScopedN("encode");
+		const occupancy_scope scope{
+			_statistics.filters(), pipeline_filter::encode, img != nullptr ? img->file_index() : error_file_index};
+		if (img == nullptr) [[unlikely]] { return {{}, error_file_index}; }
+		const std::size_t file_index = img->file_index();
+		TracyZoneFileIndex(file_index);
+
+		std::shared_ptr<const mipmap_image> level = std::move(img);
+		const image& first = level->get_image(0UL);
+		// Mipmaps are generated from the main image, so checking it is enough.
+		const bool alpha = _alpha_format != format::type::invalid && has_alpha(level->pixel_blocks());
+		const format::type format = alpha ? _alpha_format : _format;
+		const std::size_t levels = _mipmaps ? mipmap_levels(first.width(), first.height()) : 1UL;
+		auto& file_data = _files_data[file_index];
+		file_data.format = format;
+		file_data.mipmaps = levels;
+		if (_statistics.files().enabled()) {
+			file_data.thread = static_cast<std::size_t>(oneapi::tbb::this_task_arena::current_thread_index());
+		}
+		const bool errors = _statistics.files().errors();
+		if (errors) {
+			file_data.alpha = alpha;
+			file_data.level_errors.assign(levels, image_error{});
+		}
 
-class encode_bc3_image final {
-public:
-	encode_bc3_image(vector<file_data>& files_data, const format::quality quality) noexcept
-		: _files_data{files_data}
-		, _quality{quality} {}
+		dds_image result(encoded_size(format, first.width(), first.height(), levels),
+			pooled_allocator<std::uint64_t>(allocations::category::dds_output));
+		std::span<std::uint64_t> output{result};
+		oneapi::tbb::task_group encoding;
+		for (std::size_t index = 0UL; index < levels; ++index) {
+			const image& current = level->get_image(0UL);
+			const std::size_t size = dds::encoded_size(format, current.padded_width() * current.padded_height());
+			// Each task keeps its level alive until it has been encoded.
+			image_error* error = errors ? &file_data.level_errors[index] : nullptr;
+			encoding.run([this, format, level, destination = output.first(size), error, &file_data] {
+				encode(format, *level, destination, error, file_data);
+			});
+			output = output.subspan(size);
+			if (index + 1UL < levels) { level = next_level(*level); }
+		}
+		assert(output.empty());
+		level.reset();
+		encoding.wait();
 
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		_files_data[pixel_data.file_index].format = format::type::bc3;
-		return create_dds_data(dds::bc3_encode(_quality, pixel_data.image), pixel_data.file_index);
+		return create_dds_data(std::move(result), file_index);
 	}
 
 private:
-	vector<file_data>& _files_data;
-	format::quality _quality;
-};
-
-class encode_bc7_image final {
-public:
-	encode_bc7_image(vector<file_data>& files_data, format::quality quality) noexcept
-		: _files_data{files_data}
-		, _params{dds::bc7_encode_params(quality)} {}
-
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		_files_data[pixel_data.file_index].format = format::type::bc7;
-		return create_dds_data(dds::bc7_encode(_params, pixel_data.image), pixel_data.file_index);
+	// The next mipmap level is calculated by resizing a blurred version of the current one. The resampling plan applies
+	// both operations in a single pass, and it is shared between all images with the same dimensions.
+	[[nodiscard]] std::shared_ptr<const mipmap_image> next_level(const mipmap_image& level) const {
+		TracyZoneScopedN("mipmap");
+		stage_timer timer{_statistics, stage::mipmap, _files_data[level.file_index()]};
+		const image& source = level.get_image(0UL);
+		auto result = std::make_shared<mipmap_image>(level.file_index(), next_level_size(source.width()),
+			next_level_size(source.height()), false, pixel_layout::blocks);
+		resample::resample(source, result->get_image(0UL), _mipmap_filter, _mipmap_blur);
+		timer.set_bytes(result->data_size());
+		return result;
 	}
 
-private:
-	vector<file_data>& _files_data;
-	dds::bc7_params _params;
-};
+	// When error is not null, the error of the level is measured while encoding it.
+	void encode(format::type format, const mipmap_image& level, std::span<std::uint64_t> output, image_error* error,
+		file_data& data) const {
+		const pixel_block_image blocks = level.pixel_blocks();
+		stage_timer timer{_statistics, stage::encode, data};
+		timer.set_bytes(output.size_bytes());
+		if (_statistics.files().enabled()) { data.solid_blocks += solid_blocks(blocks); }
+		if (error == nullptr) {
+			encode_blocks(format, blocks, output);
+			return;
+		}
 
-class encode_alpha_format_image final {
-public:
-	explicit encode_alpha_format_image(vector<file_data>& files_data, const format::type format,
-		const format::type alpha_format, const format::quality quality, const bool alpha_black) noexcept
-		: _files_data{files_data}
-		, _format{format}
-		, _alpha_format{alpha_format}
-		, _params{dds::bc7_encode_params(quality)}
-		, _quality{quality}
-		, _alpha_black{alpha_black} {
-		assert(_alpha_format != format::type::invalid);
+		// Blocks are encoded in groups, and each group is decoded and compared right after being encoded, while its
+		// pixels are still in the cache.
+		using blocked_range = oneapi::tbb::blocked_range<std::size_t>;
+		const std::size_t block_size = dds::encoded_size(format, block_pixels);
+		const image& source = level.get_image(0UL);
+		*error = oneapi::tbb::parallel_reduce(
+			blocked_range(0UL, blocks.size() / block_pixels, group_blocks), image_error{},
+			[this, format, blocks, output, block_size, &source](const blocked_range& range, image_error total) {
+				for (std::size_t start = range.begin(); start < range.end(); start += group_blocks) {
+					const std::size_t count = std::min(group_blocks, range.end() - start);
+					const auto encoded = output.subspan(start * block_size, count * block_size);
+					encode_blocks(format, blocks.subspan(start * block_pixels, count * block_pixels), encoded);
+					dds::add_decode_error(format, encoded, source, start, source.height(), total);
+				}
+				return total;
+			},
+			[](image_error first, const image_error& second) {
+				first += second;
+				return first;
+			});
 	}
 
-	dds_data operator()(const pixel_block_data& pixel_data) const {
-		if (pixel_data.file_index == error_file_index) [[unlikely]] { return {{}, error_file_index}; }
-		const auto format = has_alpha(pixel_data.image) ? _alpha_format : _format;
-		_files_data[pixel_data.file_index].format = format;
-
-		vector<std::uint64_t> image_data;
+	void encode_blocks(format::type format, pixel_block_image blocks, std::span<std::uint64_t> output) const {
 		switch (format) {
-		case format::type::bc1: image_data = dds::bc1_encode(_quality, _alpha_black, pixel_data.image); break;
-		case format::type::bc3: image_data = dds::bc3_encode(_quality, pixel_data.image); break;
-		case format::type::bc7: image_data = dds::bc7_encode(_params, pixel_data.image); break;
+		case format::type::bc1: dds::bc1_encode(_quality, _alpha_black, blocks, output); break;
+		case format::type::bc3: dds::bc3_encode(_quality, blocks, output); break;
+		case format::type::bc7: dds::bc7_encode(_params, blocks, output); break;
 		case format::type::png:
 		case format::type::invalid: assert(false); break;
 		}
-
-		return create_dds_data(image_data, pixel_data.file_index);
 	}
 
-private:
 	vector<file_data>& _files_data;
 	format::type _format;
 	format::type _alpha_format;
 	dds::bc7_params _params;
 	format::quality _quality;
 	bool _alpha_black;
+	bool _mipmaps;
+	filter::type _mipmap_filter;
+	double _mipmap_blur;
+	stage_statistics& _statistics;
 };
 
-oneapi::tbb::filter<pixel_block_data, dds_data> encode_dds_filter(vector<file_data>& files_data, format::type format,
-	format::type alpha_format, const format::quality quality, const bool alpha_black) {
-	using oneapi::tbb::filter_mode;
-	using oneapi::tbb::make_filter;
-
-	if (alpha_format != format::type::invalid) {
-		return make_filter<pixel_block_data, dds_data>(
-			filter_mode::parallel, encode_alpha_format_image{files_data, format, alpha_format, quality, alpha_black});
-	}
-
-	switch (format) {
-	case format::type::bc1:
-		return make_filter<pixel_block_data, dds_data>(
-			filter_mode::parallel, encode_bc1_image{files_data, quality, alpha_black});
-	case format::type::bc3:
-		return make_filter<pixel_block_data, dds_data>(filter_mode::parallel, encode_bc3_image{files_data, quality});
-	case format::type::bc7:
-		return make_filter<pixel_block_data, dds_data>(filter_mode::parallel, encode_bc7_image{files_data, quality});
-	case format::type::png:
-	case format::type::invalid: break;
-	}
-
-	assert(false);
-	return {};
+oneapi::tbb::filter<std::unique_ptr<mipmap_image>, dds_data> encode_dds_filter(vector<file_data>& files_data,
+	format::type format, format::type alpha_format, format::quality quality, bool alpha_black, bool mipmaps,
+	filter::type mipmap_filter, double mipmap_blur, stage_statistics& statistics) {
+	return oneapi::tbb::make_filter<std::unique_ptr<mipmap_image>, dds_data>(oneapi::tbb::filter_mode::parallel,
+		encode_dds_image{
+			files_data, format, alpha_format, quality, alpha_black, mipmaps, mipmap_filter, mipmap_blur, statistics});
 }
 
 } // namespace todds::pipeline::impl
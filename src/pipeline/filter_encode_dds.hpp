@@ -5,11 +5,17 @@
 
 #pragma once
 
+#include "todds/filter.hpp"
+#include "todds/format.hpp"
 #include "todds/image_types.hpp"
+#include "todds/mipmap_image.hpp"
 
 #include <oneapi/tbb/parallel_pipeline.h>
 
-#include "filter_pixel_blocks.hpp"
+#include <memory>
+
+#include "filter_common.hpp"
+#include "stage_statistics.hpp"
 
 namespace todds::pipeline::impl {
 
@@ -18,6 +24,8 @@ struct dds_data {
 	std::size_t file_index;
 };
 
-oneapi::tbb::filter<pixel_block_data, dds_data> encode_dds_filter(todds::vector<file_data>& files_data,
-	todds::format::type format, todds::format::type alpha_format, todds::format::quality quality, bool alpha_black);
+// Generates the mipmaps of each image and encodes every level as a DDS image.
+oneapi::tbb::filter<std::unique_ptr<mipmap_image>, dds_data> encode_dds_filter(todds::vector<file_data>& files_data,
+	todds::format::type format, todds::format::type alpha_format, todds::format::quality quality, bool alpha_black,
+	bool mipmaps, todds::filter::type mipmap_filter, double mipmap_blur, stage_statistics& statistics);
 } // namespace todds::pipeline::impl
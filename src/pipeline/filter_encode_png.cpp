@@ -9,6 +9,7 @@
 #include "todds/profiler.hpp"
 
 #include <fmt/format.h>
+#include <oneapi/tbb/task_arena.h>
 
 #include "filter_common.hpp"
 
@@ -16,12 +17,17 @@ namespace todds::pipeline::impl {
 
 class encode_png_image final {
 public:
-	explicit encode_png_image(const paths_vector& paths, report_queue& updates)
-		: _paths{paths}
-		, _updates{updates} {}
+	explicit encode_png_image(
+		vector<file_data>& files_data, const paths_vector& paths, report_queue& updates, stage_statistics& statistics)
+		: _files_data{files_data}
+		, _paths{paths}
+		, _updates{updates}
+		, _statistics{statistics} {}
 
 	png_data operator()(std::unique_ptr<mipmap_image> input) const {
 		TracyZoneScopedN("encode_png");
+		const occupancy_scope scope{
+			_statistics.filters(), pipeline_filter::encode, input != nullptr ? input->file_index() : error_file_index};
 		if (input == nullptr || input->file_index() == error_file_index) [[unlikely]] {
 			png_data error{};
 			error.file_index = error_file_index;
@@ -29,28 +35,39 @@ public:
 		}
 
 		TracyZoneFileIndex(input->file_index());
-		const string& path = _paths[input->file_index()].first.string();
+		const string path{_paths[input->file_index()].first.string()};
 		try {
+			auto& file_data = _files_data[input->file_index()];
+			file_data.format = format::type::png;
+			file_data.mipmaps = input->mipmap_count();
+			if (_statistics.files().enabled()) {
+				file_data.thread = static_cast<std::size_t>(oneapi::tbb::this_task_arena::current_thread_index());
+			}
+			stage_timer timer{_statistics, stage::encode, file_data};
 			png_data result;
 			result.file_index = input->file_index();
 			result.image = png::encode(path, std::move(input));
+			timer.set_bytes(result.image.size());
 			return result;
 		} catch (const std::runtime_error& exc) {
 			_updates.emplace(report_type::pipeline_error, fmt::format("PNG Encoding error {:s} -> {:s}", path, exc.what()));
+			_updates.add(progress_type::failed_textures);
 		}
 
 		return {};
 	}
 
 private:
+	vector<file_data>& _files_data;
 	const paths_vector& _paths;
 	report_queue& _updates;
+	stage_statistics& _statistics;
 };
 
-oneapi::tbb::filter<std::unique_ptr<mipmap_image>, png_data> encode_png_filter(
-	const paths_vector& paths, report_queue& updates) {
+oneapi::tbb::filter<std::unique_ptr<mipmap_image>, png_data> encode_png_filter(vector<file_data>& files_data,
+	const paths_vector& paths, report_queue& updates, stage_statistics& statistics) {
 	return make_filter<std::unique_ptr<mipmap_image>, png_data>(
-		tbb::filter_mode::parallel, encode_png_image{paths, updates});
+		tbb::filter_mode::parallel, encode_png_image{files_data, paths, updates, statistics});
 }
 
 } // namespace todds::pipeline::impl
@@ -12,6 +12,7 @@
 #include <oneapi/tbb/parallel_pipeline.h>
 
 #include "filter_common.hpp"
+#include "stage_statistics.hpp"
 
 namespace todds::pipeline::impl {
 
@@ -20,7 +21,7 @@ struct png_data {
 	std::size_t file_index{};
 };
 
-oneapi::tbb::filter<std::unique_ptr<mipmap_image>, png_data> encode_png_filter(
-	const paths_vector& paths, report_queue& updates);
+oneapi::tbb::filter<std::unique_ptr<mipmap_image>, png_data> encode_png_filter(vector<file_data>& files_data,
+	const paths_vector& paths, report_queue& updates, stage_statistics& statistics);
 
 } // namespace todds::pipeline::impl
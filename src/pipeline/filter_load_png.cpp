@@ -20,11 +20,16 @@ namespace todds::pipeline::impl {
 class load_png_file final {
 public:
 	explicit load_png_file(const paths_vector& paths, std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish,
-		report_queue& updates) noexcept
+		report_queue& updates, vector<file_data>& files_data, std::size_t numa_node, throttle& limits,
+		stage_statistics& statistics) noexcept
 		: _paths{paths}
 		, _counter{counter}
 		, _force_finish{force_finish}
-		, _updates{updates} {}
+		, _updates{updates}
+		, _files_data{files_data}
+		, _numa_node{numa_node}
+		, _throttle{limits}
+		, _statistics{statistics} {}
 
 	png_file operator()(oneapi::tbb::flow_control& flow) const {
 		const std::size_t index = _counter++;
@@ -35,6 +40,12 @@ public:
 			flow.stop();
 			return {};
 		}
+		auto& file_data = _files_data[index];
+		file_data.numa_node = _numa_node;
+		_throttle.admit_file();
+		if (_statistics.files().enabled()) { file_data.start = std::chrono::steady_clock::now(); }
+		const occupancy_scope scope{_statistics.filters(), pipeline_filter::load, index};
+		stage_timer timer{_statistics, stage::load, file_data};
 
 #if BOOST_OS_WINDOWS
 		const boost::filesystem::path input{R"(\\?\)" + _paths[index].first.string()};
@@ -48,11 +59,25 @@ public:
 				report_type::pipeline_error, fmt::format("Load PNG file error in {:s}", _paths[index].first.string()));
 		}
 
-		png_file result{{std::istreambuf_iterator<char>{ifs}, {}}, index};
+		png_file result{pooled_vector<std::uint8_t>(pooled_allocator<std::uint8_t>(allocations::category::png_buffers)),
+			index};
+		// Read the whole file at once into a buffer of its exact size, which is usually recycled from a previous file.
+		ifs.seekg(0, std::ios::end);
+		const std::streamoff file_size = ifs.tellg();
+		if (file_size > 0) [[likely]] {
+			ifs.seekg(0, std::ios::beg);
+			_throttle.transfer(static_cast<std::size_t>(file_size));
+			result.buffer.resize(static_cast<std::size_t>(file_size));
+			if (!ifs.read(reinterpret_cast<char*>(result.buffer.data()), file_size)) [[unlikely]] { result.buffer.clear(); }
+			timer.set_bytes(result.buffer.size());
+			file_data.input_bytes = result.buffer.size();
+			_statistics.add_read(result.buffer.size());
+		}
 
 		if (result.buffer.empty()) [[unlikely]] {
 			_updates.emplace(report_type::pipeline_error,
 				fmt::format("Could not load any data for PNG file {:s}", _paths[index].first.string()));
+			_updates.add(progress_type::failed_textures);
 		}
 #if defined(TODDS_PIPELINE_DUMP)
 		else {
@@ -71,11 +96,16 @@ private:
 	std::atomic<std::size_t>& _counter;
 	std::atomic<bool>& _force_finish;
 	report_queue& _updates;
+	vector<file_data>& _files_data;
+	std::size_t _numa_node;
+	throttle& _throttle;
+	stage_statistics& _statistics;
 };
 
 oneapi::tbb::filter<void, png_file> load_png_filter(const paths_vector& paths, std::atomic<std::size_t>& counter,
-	std::atomic<bool>& force_finish, report_queue& updates) {
-	return oneapi::tbb::make_filter<void, png_file>(
-		oneapi::tbb::filter_mode::parallel, load_png_file(paths, counter, force_finish, updates));
+	std::atomic<bool>& force_finish, report_queue& updates, vector<file_data>& files_data, std::size_t numa_node,
+	throttle& limits, stage_statistics& statistics) {
+	return oneapi::tbb::make_filter<void, png_file>(oneapi::tbb::filter_mode::parallel,
+		load_png_file(paths, counter, force_finish, updates, files_data, numa_node, limits, statistics));
 }
 } // namespace todds::pipeline::impl
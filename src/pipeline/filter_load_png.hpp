@@ -14,15 +14,18 @@
 #include <cstdint>
 
 #include "filter_common.hpp"
+#include "stage_statistics.hpp"
+#include "throttle.hpp"
 
 namespace todds::pipeline::impl {
 
 struct png_file {
-	vector<std::uint8_t> buffer;
+	pooled_vector<std::uint8_t> buffer;
 	std::size_t file_index;
 };
 
-oneapi::tbb::filter<void, png_file> load_png_filter(
-	const paths_vector& paths, std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish, report_queue& updates);
+oneapi::tbb::filter<void, png_file> load_png_filter(const paths_vector& paths, std::atomic<std::size_t>& counter,
+	std::atomic<bool>& force_finish, report_queue& updates, vector<file_data>& files_data, std::size_t numa_node,
+	throttle& limits, stage_statistics& statistics);
 
 } // namespace todds::pipeline::impl
@@ -12,24 +12,41 @@
 #include <boost/predef.h>
 #include <dds_defs.h>
 
-#include "filter_pixel_blocks.hpp"
+#include <string_view>
 
 namespace todds::pipeline::impl {
 
 // Header extension for BC7 files.
 constexpr DDS_HEADER_DXT10 header_extension{DXGI_FORMAT_BC7_UNORM, D3D10_RESOURCE_DIMENSION_TEXTURE2D, 0U, 1U, 0U};
 
+std::size_t write_dds_header(std::ostream& output, const file_data& data) {
+	constexpr std::string_view magic{"DDS "};
+	output.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+	const auto header = dds::dds_header(data.format, data.width, data.height, data.mipmaps);
+	output.write(header.data(), header.size());
+	std::size_t written = magic.size() + header.size();
+	if (data.format == format::type::bc7) {
+		output.write(reinterpret_cast<const char*>(&header_extension), sizeof(header_extension));
+		written += sizeof(header_extension);
+	}
+	return written;
+}
+
 class save_dds_file final {
 public:
-	explicit save_dds_file(const vector<file_data>& files_data, const paths_vector& paths, report_queue& updates) noexcept
+	explicit save_dds_file(vector<file_data>& files_data, const paths_vector& paths, report_queue& updates,
+		throttle& limits, stage_statistics& statistics) noexcept
 		: _files_data{files_data}
 		, _paths{paths}
-		, _updates{updates} {}
+		, _updates{updates}
+		, _throttle{limits}
+		, _statistics{statistics} {}
 
 	void operator()(const dds_data& dds_img) const {
 		TracyZoneScopedN("save");
 		const std::size_t file_index = dds_img.file_index;
 		TracyZoneFileIndex(file_index);
+		const occupancy_scope scope{_statistics.filters(), pipeline_filter::save, file_index};
 
 		if (file_index == error_file_index) [[unlikely]] { return; }
 
@@ -39,32 +56,41 @@ public:
 		const boost::filesystem::path& output{_paths[file_index].second.string()};
 #endif
 
-		boost::nowide::ofstream ofs{output, std::ios::out | std::ios::binary};
-
-		ofs << "DDS ";
-		const auto& file_data = _files_data[file_index];
-		const auto header = dds::dds_header(file_data.format, file_data.width, file_data.height, file_data.mipmaps);
-		ofs.write(header.data(), header.size());
-		if (file_data.format == format::type::bc7) {
-			ofs.write(reinterpret_cast<const char*>(&header_extension), sizeof(header_extension));
-		}
-
 		const std::size_t block_size_bytes = dds_img.image.size() * sizeof(std::uint64_t);
-		ofs.write(reinterpret_cast<const char*>(dds_img.image.data()), static_cast<std::ptrdiff_t>(block_size_bytes));
-		ofs.close();
-		_updates.emplace(report_type::encoding_progress);
+		_throttle.transfer(block_size_bytes);
+		auto& file_data = _files_data[file_index];
+		{
+			stage_timer timer{_statistics, stage::save, file_data};
+			timer.set_bytes(block_size_bytes);
+
+			boost::nowide::ofstream ofs{output, std::ios::out | std::ios::binary};
+
+			const std::size_t header_bytes = write_dds_header(ofs, file_data);
+			ofs.write(reinterpret_cast<const char*>(dds_img.image.data()), static_cast<std::ptrdiff_t>(block_size_bytes));
+			ofs.close();
+			file_data.output_bytes = header_bytes + block_size_bytes;
+		}
+		file_data.saved = true;
+		// BC1 blocks take one element of the image, and BC3 and BC7 blocks take two.
+		const std::size_t blocks =
+			file_data.format == format::type::bc1 ? dds_img.image.size() : dds_img.image.size() / 2UL;
+		_statistics.add_written(file_data.format, file_data.output_bytes, blocks);
+		_updates.add(progress_type::encoded_textures);
+		if (_statistics.files().enabled()) { _statistics.files().write(_paths[file_index].first, file_data); }
 	}
 
 private:
-	const vector<file_data>& _files_data;
+	vector<file_data>& _files_data;
 	const paths_vector& _paths;
 	report_queue& _updates;
+	throttle& _throttle;
+	stage_statistics& _statistics;
 };
 
-oneapi::tbb::filter<dds_data, void> save_dds_filter(
-	const vector<file_data>& files_data, const paths_vector& paths, report_queue& updates) {
+oneapi::tbb::filter<dds_data, void> save_dds_filter(vector<file_data>& files_data, const paths_vector& paths,
+	report_queue& updates, throttle& limits, stage_statistics& statistics) {
 	return oneapi::tbb::make_filter<dds_data, void>(
-		oneapi::tbb::filter_mode::parallel, save_dds_file(files_data, paths, updates));
+		oneapi::tbb::filter_mode::parallel, save_dds_file(files_data, paths, updates, limits, statistics));
 }
 
 } // namespace todds::pipeline::impl
@@ -5,14 +5,23 @@
 
 #pragma once
 
+#include "todds/input.hpp"
+
 #include <oneapi/tbb/parallel_pipeline.h>
 
+#include <ostream>
+
 #include "filter_common.hpp"
 #include "filter_encode_dds.hpp"
+#include "stage_statistics.hpp"
+#include "throttle.hpp"
 
 namespace todds::pipeline::impl {
 
-oneapi::tbb::filter<dds_data, void> save_dds_filter(
-	const vector<file_data>& files_data, const paths_vector& paths, report_queue& updates);
+// Writes the magic number, the DDS header and the header extension if needed. Returns the number of bytes written.
+std::size_t write_dds_header(std::ostream& output, const file_data& data);
+
+oneapi::tbb::filter<dds_data, void> save_dds_filter(vector<file_data>& files_data, const paths_vector& paths,
+	report_queue& updates, throttle& limits, stage_statistics& statistics);
 
 } // namespace todds::pipeline::impl
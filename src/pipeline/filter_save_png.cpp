@@ -10,18 +10,21 @@
 #include <boost/nowide/fstream.hpp>
 #include <boost/predef.h>
 
-#include "filter_pixel_blocks.hpp"
-
 namespace todds::pipeline::impl {
 
 class save_png_file final {
 public:
-	explicit save_png_file(const paths_vector& paths) noexcept
-		: _paths{paths} {}
+	explicit save_png_file(
+		vector<file_data>& files_data, const paths_vector& paths, throttle& limits, stage_statistics& statistics) noexcept
+		: _files_data{files_data}
+		, _paths{paths}
+		, _throttle{limits}
+		, _statistics{statistics} {}
 
 	void operator()(const png_data& input) const {
 		TracyZoneScopedN("save_png");
 		const std::size_t file_index = input.file_index;
+		const occupancy_scope scope{_statistics.filters(), pipeline_filter::save, file_index};
 		if (file_index == error_file_index) [[unlikely]] { return; }
 		TracyZoneFileIndex(file_index);
 
@@ -31,19 +34,34 @@ public:
 		const boost::filesystem::path& output_path{_paths[file_index].second.string()};
 #endif
 
-		boost::nowide::ofstream ofs{output_path, std::ios::out | std::ios::binary};
+		_throttle.transfer(input.image.size());
+		auto& file_data = _files_data[file_index];
+		{
+			stage_timer timer{_statistics, stage::save, file_data};
+			timer.set_bytes(input.image.size());
+			boost::nowide::ofstream ofs{output_path, std::ios::out | std::ios::binary};
 
-		const auto size = static_cast<std::ptrdiff_t>(input.image.size());
-		ofs.write(reinterpret_cast<const char*>(input.image.data()), size);
-		ofs.close();
+			const auto size = static_cast<std::ptrdiff_t>(input.image.size());
+			ofs.write(reinterpret_cast<const char*>(input.image.data()), size);
+			ofs.close();
+			file_data.output_bytes = input.image.size();
+		}
+		file_data.saved = true;
+		_statistics.add_written(format::type::png, file_data.output_bytes, 0UL);
+		if (_statistics.files().enabled()) { _statistics.files().write(_paths[file_index].first, file_data); }
 	}
 
 private:
+	vector<file_data>& _files_data;
 	const paths_vector& _paths;
+	throttle& _throttle;
+	stage_statistics& _statistics;
 };
 
-oneapi::tbb::filter<png_data, void> save_png_filter(const paths_vector& paths) {
-	return oneapi::tbb::make_filter<png_data, void>(oneapi::tbb::filter_mode::parallel, save_png_file(paths));
+oneapi::tbb::filter<png_data, void> save_png_filter(
+	vector<file_data>& files_data, const paths_vector& paths, throttle& limits, stage_statistics& statistics) {
+	return oneapi::tbb::make_filter<png_data, void>(
+		oneapi::tbb::filter_mode::parallel, save_png_file(files_data, paths, limits, statistics));
 }
 
 } // namespace todds::pipeline::impl
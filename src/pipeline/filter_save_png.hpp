@@ -12,9 +12,12 @@
 
 #include "filter_common.hpp"
 #include "filter_encode_png.hpp"
+#include "stage_statistics.hpp"
+#include "throttle.hpp"
 
 namespace todds::pipeline::impl {
 
-oneapi::tbb::filter<png_data, void> save_png_filter(const paths_vector& paths);
+oneapi::tbb::filter<png_data, void> save_png_filter(
+	vector<file_data>& files_data, const paths_vector& paths, throttle& limits, stage_statistics& statistics);
 
 } // namespace todds::pipeline::impl
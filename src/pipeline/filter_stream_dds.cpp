@@ -0,0 +1,312 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "filter_stream_dds.hpp"
+
+#include "todds/dds.hpp"
+#include "todds/image_types.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/png.hpp"
+#include "todds/profiler.hpp"
+#include "todds/resample.hpp"
+#include "todds/util.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/predef.h>
+#include <fmt/format.h>
+#include <oneapi/tbb/task_arena.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <limits>
+
+#include "file_report.hpp"
+#include "filter_save_dds.hpp"
+
+namespace {
+
+using todds::format::type;
+
+constexpr std::size_t pixels_per_megapixel = 1000000UL;
+
+// Size in bytes of an encoded 4x4 pixel block.
+constexpr std::size_t block_bytes(type format) noexcept { return format == type::bc1 ? 8UL : 16UL; }
+
+// Number of encoded 4x4 pixel blocks of an image.
+std::size_t block_count(std::size_t width, std::size_t height) noexcept {
+	using todds::pixel_block_side;
+	using todds::util::next_divisible_by_4;
+	return (next_divisible_by_4(width) / pixel_block_side) * (next_divisible_by_4(height) / pixel_block_side);
+}
+
+// Number of images in the DDS file, including the main one.
+std::size_t level_count(std::size_t width, std::size_t height, bool mipmaps) noexcept {
+	return mipmaps ? todds::mipmap_levels(width, height) : 1UL;
+}
+
+// When using alpha_format, the encoding format must be known before writing the header.
+bool has_alpha(const todds::string& path, std::span<const std::uint8_t> buffer) {
+	bool alpha = false;
+	todds::png::decode_rows(path, buffer, [&alpha](std::span<const std::uint8_t> row) {
+		for (std::size_t index = 3UL; !alpha && index < row.size(); index += todds::image::bytes_per_pixel) {
+			alpha = row[index] != std::numeric_limits<std::uint8_t>::max();
+		}
+	});
+	return alpha;
+}
+
+class band_encoder final {
+public:
+	band_encoder(type format, todds::format::quality quality, bool alpha_black) noexcept
+		: _format{format}
+		, _quality{quality}
+		, _alpha_black{alpha_black}
+		, _params{todds::dds::bc7_encode_params(quality)} {}
+
+	[[nodiscard]] todds::dds_image operator()(todds::pixel_block_image blocks) const {
+		switch (_format) {
+		case type::bc1: return todds::dds::bc1_encode(_quality, _alpha_black, blocks);
+		case type::bc3: return todds::dds::bc3_encode(_quality, blocks);
+		case type::bc7: return todds::dds::bc7_encode(_params, blocks);
+		case type::png:
+		case type::invalid: break;
+		}
+		assert(false);
+		return {};
+	}
+
+	[[nodiscard]] type format() const noexcept { return _format; }
+
+private:
+	type _format;
+	todds::format::quality _quality;
+	bool _alpha_black;
+	todds::dds::bc7_params _params;
+};
+
+// Receives the rows of the main image in order. Every mipmap level keeps a band of four rows, which is encoded and
+// written into its position in the DDS file as soon as it is complete. Rows of each level are also resampled into the
+// next level as they arrive, so memory usage depends on the width of the image instead of its area.
+// When solid_blocks is not null, the solid blocks of every band are added to it. When errors is not empty, each band is
+// decoded after encoding it, and its error is added to the error of its level.
+class band_stream final {
+public:
+	band_stream(std::size_t width, std::size_t height, bool mipmaps, todds::filter::type filter, double blur,
+		const band_encoder& encoder, std::size_t block_size, std::ostream& output, std::streamoff data_start,
+		todds::pipeline::impl::throttle& limits, std::atomic<std::size_t>* solid_blocks,
+		std::span<todds::image_error> errors)
+		: _encoder{encoder}
+		, _output{output}
+		, _throttle{limits}
+		, _solid_blocks{solid_blocks}
+		, _errors{errors} {
+		const std::size_t count = level_count(width, height, mipmaps);
+		_levels.reserve(count);
+		std::streamoff offset = data_start;
+		for (std::size_t index = 0UL; index < count; ++index) {
+			_levels.emplace_back(width, height, offset);
+			offset += static_cast<std::streamoff>(block_count(width, height) * block_size);
+			width = std::max(width >> 1UL, 1UL);
+			height = std::max(height >> 1UL, 1UL);
+		}
+		_end = offset;
+
+		for (std::size_t index = 0UL; index + 1UL < _levels.size(); ++index) {
+			const level& source = _levels[index];
+			const level& target = _levels[index + 1UL];
+			_levels[index].next = std::make_unique<todds::resample::row_resampler>(
+				todds::resample::get_plan({source.width, source.height, target.width, target.height, filter, blur}),
+				[this, next_index = index + 1UL](
+					std::size_t /*row*/, std::span<const std::uint8_t> data) { push_row(next_index, data); });
+		}
+	}
+
+	void push_row(std::span<const std::uint8_t> row) { push_row(0UL, row); }
+
+	// Position in the output of the end of the last level.
+	[[nodiscard]] std::streamoff end() const noexcept { return _end; }
+
+	[[nodiscard]] bool finished() const noexcept {
+		return std::all_of(
+			_levels.cbegin(), _levels.cend(), [](const level& current) { return current.rows == current.height; });
+	}
+
+private:
+	struct level {
+		level(std::size_t level_width, std::size_t level_height, std::streamoff level_offset)
+			: width{level_width}
+			, height{level_height}
+			, band{0UL, level_width, std::min(level_height, todds::pixel_block_side), false, todds::pixel_layout::blocks,
+					todds::allocations::category::pixel_blocks}
+			, offset{level_offset} {}
+
+		std::size_t width;
+		std::size_t height;
+		todds::mipmap_image band;
+		// Rows currently stored in the band.
+		std::size_t band_rows{};
+		// Rows of this level received so far.
+		std::size_t rows{};
+		// Position in the output file of the next band.
+		std::streamoff offset;
+		// Generates the rows of the next mipmap level.
+		std::unique_ptr<todds::resample::row_resampler> next;
+	};
+
+	void push_row(std::size_t level_index, std::span<const std::uint8_t> row) {
+		level& current = _levels[level_index];
+		todds::image& band = current.band.get_image(0UL);
+		band.write_row(current.band_rows, row);
+		++current.band_rows;
+		++current.rows;
+		if (current.next != nullptr) { current.next->push_row(row); }
+		const std::size_t band_rows = current.band_rows;
+		if (current.rows == current.height) {
+			// Incomplete bands repeat the last row of the level, in the same way as the padding rows of an image.
+			for (; current.band_rows < band.height(); ++current.band_rows) { band.write_row(current.band_rows, row); }
+		}
+		if (current.band_rows == band.height()) { write_band(level_index, band_rows); }
+	}
+
+	// Repeated rows of incomplete bands are not included in the error of the level.
+	void write_band(std::size_t level_index, std::size_t band_rows) {
+		level& current = _levels[level_index];
+		if (_solid_blocks != nullptr) {
+			*_solid_blocks += todds::pipeline::impl::solid_blocks(current.band.pixel_blocks());
+		}
+		const todds::dds_image encoded = _encoder(current.band.pixel_blocks());
+		if (!_errors.empty()) {
+			todds::dds::add_decode_error(
+				_encoder.format(), encoded, current.band.get_image(0UL), 0UL, band_rows, _errors[level_index]);
+		}
+		const auto encoded_size = static_cast<std::streamsize>(encoded.size() * sizeof(std::uint64_t));
+		_throttle.transfer(static_cast<std::size_t>(encoded_size));
+		_output.seekp(current.offset);
+		_output.write(reinterpret_cast<const char*>(encoded.data()), encoded_size);
+		current.offset += encoded_size;
+		current.band_rows = 0UL;
+	}
+
+	const band_encoder& _encoder;
+	std::ostream& _output;
+	todds::pipeline::impl::throttle& _throttle;
+	std::atomic<std::size_t>* _solid_blocks;
+	std::span<todds::image_error> _errors;
+	todds::vector<level> _levels;
+	std::streamoff _end{};
+};
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+class stream_dds final {
+public:
+	explicit stream_dds(vector<file_data>& files_data, const input& input_data, report_queue& updates, throttle& limits,
+		stage_statistics& statistics) noexcept
+		: _files_data{files_data}
+		, _input{input_data}
+		, _updates{updates}
+		, _throttle{limits}
+		, _statistics{statistics} {}
+
+	png_file operator()(png_file file) const {
+		TracyZoneScopedN("stream");
+		TracyZoneFileIndex(file.file_index);
+		const occupancy_scope scope{_statistics.filters(), pipeline_filter::stream, file.file_index};
+
+		if (file.buffer.empty()) [[unlikely]] { return file; }
+
+		const string path{_input.paths[file.file_index].first.string()};
+		auto& data = _files_data[file.file_index];
+		try {
+			if (!stream(file, path)) { return file; }
+			if (_statistics.files().enabled()) { _statistics.files().write(_input.paths[file.file_index].first, data); }
+		} catch (const std::runtime_error& exc) {
+			_updates.emplace(report_type::pipeline_error, fmt::format("Band streaming error {:s} -> {:s}", path, exc.what()));
+			_updates.add(progress_type::failed_textures);
+		}
+
+		return {{}, file.file_index};
+	}
+
+private:
+	// Files that must be flipped, scaled or padded are processed by the rest of the pipeline instead.
+	[[nodiscard]] bool can_stream(const png::header& header) const noexcept {
+		const bool padding = _input.fix_size && (header.width % 4UL != 0UL || header.height % 4UL != 0UL);
+		return !header.interlaced && !_input.vflip && !padding && _input.scale == 100U && _input.max_size == 0U &&
+					 header.width * header.height >= _input.stream_threshold * pixels_per_megapixel;
+	}
+
+	bool stream(const png_file& file, const string& path) const {
+		const png::header header = png::read_header(path, file.buffer);
+		if (!can_stream(header)) { return false; }
+		auto& data = _files_data[file.file_index];
+		stage_timer timer{_statistics, stage::stream, data};
+		timer.set_bytes(file.buffer.size());
+		const bool reporting = _statistics.files().enabled();
+		if (reporting) { data.thread = static_cast<std::size_t>(oneapi::tbb::this_task_arena::current_thread_index()); }
+
+		const bool alpha = _input.alpha_format != type::invalid && has_alpha(path, file.buffer);
+		const type format = alpha ? _input.alpha_format : _input.format;
+
+#if BOOST_OS_WINDOWS
+		const boost::filesystem::path output{R"(\\?\)" + _input.paths[file.file_index].second.string()};
+#else
+		const boost::filesystem::path& output{_input.paths[file.file_index].second.string()};
+#endif
+		boost::nowide::ofstream ofs{output, std::ios::out | std::ios::binary};
+		if (!ofs.is_open()) [[unlikely]] { throw std::runtime_error{"Could not open the output file"}; }
+
+		const band_encoder encoder{format, _input.quality, _input.alpha_black};
+		const auto data_start = static_cast<std::streamoff>(write_header(ofs, file.file_index, header, format));
+		if (_statistics.files().errors()) {
+			data.alpha = alpha;
+			data.level_errors.assign(data.mipmaps, image_error{});
+		}
+		band_stream bands{header.width, header.height, _input.mipmaps, _input.mipmap_filter, _input.mipmap_blur, encoder,
+			block_bytes(format), ofs, data_start, _throttle, reporting ? &data.solid_blocks : nullptr, data.level_errors};
+		png::decode_rows(path, file.buffer, [&bands](std::span<const std::uint8_t> row) { bands.push_row(row); });
+		ofs.close();
+
+		if (!bands.finished() || ofs.fail()) [[unlikely]] {
+			boost::system::error_code error_code;
+			boost::filesystem::remove(output, error_code);
+			throw std::runtime_error{"Could not encode every band of the image"};
+		}
+
+		data.output_bytes = static_cast<std::size_t>(bands.end());
+		data.saved = true;
+		const auto blocks = static_cast<std::size_t>(bands.end() - data_start) / block_bytes(format);
+		_statistics.add_written(format, data.output_bytes, blocks);
+		_updates.add(progress_type::encoded_textures);
+		return true;
+	}
+
+	std::size_t write_header(std::ostream& output, std::size_t file_index, const png::header& header, type format) const {
+		auto& data = _files_data[file_index];
+		data.width = header.width;
+		data.height = header.height;
+		data.format = format;
+		data.mipmaps = level_count(header.width, header.height, _input.mipmaps);
+		return write_dds_header(output, data);
+	}
+
+	vector<file_data>& _files_data;
+	const input& _input;
+	report_queue& _updates;
+	throttle& _throttle;
+	stage_statistics& _statistics;
+};
+
+oneapi::tbb::filter<png_file, png_file> stream_dds_filter(vector<file_data>& files_data, const input& input_data,
+	report_queue& updates, throttle& limits, stage_statistics& statistics) {
+	return oneapi::tbb::make_filter<png_file, png_file>(
+		oneapi::tbb::filter_mode::parallel, stream_dds(files_data, input_data, updates, limits, statistics));
+}
+
+} // namespace todds::pipeline::impl
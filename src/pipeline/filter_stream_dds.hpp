@@ -0,0 +1,24 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/input.hpp"
+
+#include <oneapi/tbb/parallel_pipeline.h>
+
+#include "filter_common.hpp"
+#include "filter_load_png.hpp"
+#include "stage_statistics.hpp"
+#include "throttle.hpp"
+
+namespace todds::pipeline::impl {
+
+// Encodes images larger than input_data.stream_threshold directly into DDS files, one band of rows at a time.
+// Streamed files are returned with an empty buffer so the rest of the pipeline skips them.
+oneapi::tbb::filter<png_file, png_file> stream_dds_filter(vector<file_data>& files_data, const input& input_data,
+	report_queue& updates, throttle& limits, stage_statistics& statistics);
+
+} // namespace todds::pipeline::impl
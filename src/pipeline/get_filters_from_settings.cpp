@@ -7,62 +7,67 @@
 
 #include "todds/report.hpp"
 
+#include "filter_capture.hpp"
 #include "filter_decode_png.hpp"
 #include "filter_encode_dds.hpp"
 #include "filter_encode_png.hpp"
-#include "filter_generate_mipmaps.hpp"
 #include "filter_load_png.hpp"
-#include "filter_pixel_blocks.hpp"
 #include "filter_save_dds.hpp"
 #include "filter_save_png.hpp"
-#include "filter_scale_image.hpp"
+#include "filter_stream_dds.hpp"
 
 namespace todds::pipeline::impl {
 
 inline oneapi::tbb::filter<void, std::unique_ptr<mipmap_image>> png_decoding_filters(const input& input_data,
 	std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish, report_queue& updates,
-	vector<impl::file_data>& files_data) {
-	// If scale and mipmaps are enabled, space for mipmaps will be allocated by the scale filter.
-	const bool should_allocate_mipmaps = input_data.mipmaps && input_data.scale == 100U;
-	return // Load PNG files from disk into memory.
-		impl::load_png_filter(input_data.paths, counter, force_finish, updates) &
-		// Decode a PNG file to raw pixels. Fix size and allocate for mipmaps if needed.
-		impl::decode_png_filter(
-			files_data, input_data.paths, input_data.vflip, should_allocate_mipmaps, input_data.fix_size, updates);
+	vector<impl::file_data>& files_data, std::size_t numa_node, throttle& limits, stage_statistics& statistics) {
+	// Load PNG files from disk into memory.
+	auto load_png = impl::load_png_filter(
+		input_data.paths, counter, force_finish, updates, files_data, numa_node, limits, statistics);
+	if (input_data.stream_threshold > 0U && input_data.format != format::type::png) {
+		// Encode very large files band by band directly from their PNG data. The next stages will skip these files.
+		load_png &= impl::stream_dds_filter(files_data, input_data, updates, limits, statistics);
+	}
+
+	// DDS encoders use images stored as 4x4 pixel blocks.
+	const auto layout = input_data.format == format::type::png ? pixel_layout::rows : pixel_layout::blocks;
+	return load_png &
+				 // Decode a PNG file to raw pixels. Fix size and scale if needed.
+				 impl::decode_png_filter(files_data, input_data.paths, input_data.vflip, input_data.fix_size,
+					 input_data.scale, input_data.max_size, input_data.scale_filter, layout, updates, statistics);
 }
 
-inline oneapi::tbb::filter<std::unique_ptr<mipmap_image>, void> dds_encoding_filters(
-	const input& input_data, vector<impl::file_data>& files_data, report_queue& updates) {
-	return
-		// Convert images into pixel block images. The pixels of these images are rearranged into 4x4 blocks,
-		// ready for the DDS encoding stage.
-		impl::pixel_blocks_filter() &
-		// Encode pixel block images as DDS files.
-		impl::encode_dds_filter(
-			files_data, input_data.format, input_data.alpha_format, input_data.quality, input_data.alpha_black) &
+inline oneapi::tbb::filter<std::unique_ptr<mipmap_image>, void> dds_encoding_filters(const input& input_data,
+	vector<impl::file_data>& files_data, report_queue& updates, throttle& limits, stage_statistics& statistics,
+	capture::writer& capture) {
+	auto encode_dds =
+		// Generate mipmaps if needed, and encode each level as soon as it is available.
+		impl::encode_dds_filter(files_data, input_data.format, input_data.alpha_format, input_data.quality,
+			input_data.alpha_black, input_data.mipmaps, input_data.mipmap_filter, input_data.mipmap_blur, statistics) &
 		// Save DDS files back into the file system, one by one.
-		impl::save_dds_filter(files_data, input_data.paths, updates);
+		impl::save_dds_filter(files_data, input_data.paths, updates, limits, statistics);
+	if (!capture.enabled()) { return encode_dds; }
+	// Store the images received by the encoder, so they can be replayed later.
+	return impl::capture_filter(capture) & encode_dds;
 }
 
-inline oneapi::tbb::filter<std::unique_ptr<mipmap_image>, void> png_encoding_filters(
-	const input& input_data, report_queue& updates) {
-	return impl::encode_png_filter(input_data.paths, updates) & impl::save_png_filter(input_data.paths);
+inline oneapi::tbb::filter<std::unique_ptr<mipmap_image>, void> png_encoding_filters(const input& input_data,
+	vector<impl::file_data>& files_data, report_queue& updates, throttle& limits, stage_statistics& statistics) {
+	return impl::encode_png_filter(files_data, input_data.paths, updates, statistics) &
+				 impl::save_png_filter(files_data, input_data.paths, limits, statistics);
 }
 
 oneapi::tbb::filter<void, void> get_filters_from_settings(const input& input_data, std::atomic<std::size_t>& counter,
-	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data) {
-	auto prepare_image = png_decoding_filters(input_data, counter, force_finish, updates, files_data);
-	if (input_data.scale != 100U || input_data.max_size > 0U) {
-		prepare_image &= impl::scale_image_filter(files_data, input_data.mipmaps, input_data.scale, input_data.max_size,
-			input_data.scale_filter, input_data.paths, updates);
-	}
+	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data, std::size_t numa_node,
+	throttle& limits, stage_statistics& statistics, capture::writer& capture) {
+	const auto prepare_image =
+		png_decoding_filters(input_data, counter, force_finish, updates, files_data, numa_node, limits, statistics);
 
-	if (input_data.format == format::type::png) { return prepare_image & png_encoding_filters(input_data, updates); }
-
-	if (input_data.mipmaps) {
-		prepare_image &= impl::generate_mipmaps_filter(input_data.mipmap_filter, input_data.mipmap_blur);
+	if (input_data.format == format::type::png) {
+		return prepare_image & png_encoding_filters(input_data, files_data, updates, limits, statistics);
 	}
-	return prepare_image & dds_encoding_filters(input_data, files_data, updates);
+
+	return prepare_image & dds_encoding_filters(input_data, files_data, updates, limits, statistics, capture);
 }
 
 } // namespace todds::pipeline::impl
@@ -4,15 +4,19 @@
  */
 #pragma once
 
+#include "todds/capture.hpp"
 #include "todds/input.hpp"
 
 #include <oneapi/tbb/parallel_pipeline.h>
 
 #include "filter_common.hpp"
+#include "stage_statistics.hpp"
+#include "throttle.hpp"
 
 namespace todds::pipeline::impl {
 
 oneapi::tbb::filter<void, void> get_filters_from_settings(const input& input_data, std::atomic<std::size_t>& counter,
-	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data);
+	std::atomic<bool>& force_finish, report_queue& updates, vector<impl::file_data>& files_data, std::size_t numa_node,
+	throttle& limits, stage_statistics& statistics, capture::writer& capture);
 
 } // namespace todds::pipeline::impl
@@ -0,0 +1,134 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/image.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/vector.hpp"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+
+/**
+ * Capture files store the decoded images of a whole dataset, as they are received by the DDS encoding stage. They can
+ * be replayed to measure mipmap generation and DDS encoding without reading or decoding PNG files.
+ *
+ * A capture file starts with a header containing capture::magic, capture::version and the number of images. Each image
+ * is stored as a record header with its file index, width, height and size in bytes, followed by its pixels in
+ * pixel_layout::blocks. Records are aligned to capture::alignment bytes so images can be used directly from a memory
+ * mapping of the file. Values use the byte order of the computer which wrote the file.
+ */
+namespace todds::capture {
+
+/** Identifies capture files. */
+constexpr std::uint64_t magic = 0x5041435344444F54ULL;
+
+/** Version of the capture file format. Files using other versions are not supported. */
+constexpr std::uint64_t version = 1ULL;
+
+/** Alignment of each record in bytes. */
+constexpr std::size_t alignment = 64UL;
+
+/**
+ * Writes images into a capture file. Images can be written in any order from any thread.
+ */
+class writer final {
+public:
+	/**
+	 * Creates the capture file, replacing any previous file.
+	 * @param path Path of the capture file. An empty path disables the writer.
+	 */
+	explicit writer(const boost::filesystem::path& path);
+	writer(const writer&) = delete;
+	writer(writer&&) = delete;
+	writer& operator=(const writer&) = delete;
+	writer& operator=(writer&&) = delete;
+	~writer() = default;
+
+	[[nodiscard]] bool enabled() const noexcept;
+
+	/**
+	 * Checks if every image has been written.
+	 * @return False if the file could not be created or written.
+	 */
+	[[nodiscard]] bool good() const;
+
+	/**
+	 * Appends the main image of a mipmap image. Thread-safe.
+	 * @param img Image using pixel_layout::blocks.
+	 */
+	void write(const mipmap_image& img);
+
+	/**
+	 * Stores the number of images in the header and closes the file. Must be called after every image has been written.
+	 */
+	void close();
+
+private:
+	bool _enabled;
+	mutable std::mutex _mutex;
+	boost::nowide::ofstream _output;
+	std::uint64_t _images{};
+};
+
+/**
+ * Reads a capture file by mapping it into memory. Images are views of the mapping, so they are only valid while the
+ * reader exists. Pages are copied on write, so changes to the images are never written back to the file.
+ */
+class reader final {
+public:
+	/**
+	 * Maps a capture file into memory and finds each of its images.
+	 * @param path Path of the capture file.
+	 * @exception std::runtime_error If the file cannot be mapped or it is not a valid capture file.
+	 */
+	explicit reader(const boost::filesystem::path& path);
+	reader(const reader&) = delete;
+	reader(reader&&) = delete;
+	reader& operator=(const reader&) = delete;
+	reader& operator=(reader&&) = delete;
+	~reader() = default;
+
+	/**
+	 * Number of images in the capture file.
+	 * @return Image count.
+	 */
+	[[nodiscard]] std::size_t size() const noexcept;
+
+	/**
+	 * File index of an image in the run which captured it.
+	 * @param index Index of the image in the capture file.
+	 * @return File index.
+	 */
+	[[nodiscard]] std::size_t file_index(std::size_t index) const noexcept;
+
+	/**
+	 * View of an image of the capture file.
+	 * @param index Index of the image in the capture file.
+	 * @return Image using pixel_layout::blocks.
+	 */
+	[[nodiscard]] image get_image(std::size_t index) const;
+
+private:
+	struct entry {
+		std::size_t file_index;
+		std::size_t width;
+		std::size_t height;
+		std::span<std::uint8_t> data;
+	};
+
+	boost::interprocess::file_mapping _file;
+	boost::interprocess::mapped_region _region;
+	vector<entry> _entries;
+};
+
+} // namespace todds::capture
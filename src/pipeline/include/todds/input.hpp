@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "todds/cgroup.hpp"
 #include "todds/filter.hpp"
 #include "todds/format.hpp"
 #include "todds/vector.hpp"
@@ -21,6 +22,12 @@ struct input {
 	/** Maximum parallelism allowed for the internal TBB pipeline. */
 	std::size_t parallelism{};
 
+	/**
+	 * Maximum number of NUMA nodes used by the pipeline. Zero uses every node. When limited, the pipelines stay pinned to
+	 * their nodes even if only one node is used, so the throughput of each number of nodes can be compared.
+	 */
+	std::size_t numa_nodes{};
+
 	/** True if mipmaps should be generated. */
 	bool mipmaps{};
 
@@ -68,6 +75,57 @@ struct input {
 
 	/** Prints information about the encoding process of each file. */
 	bool report{};
+
+	/** Images with at least this many megapixels are encoded in bands of rows. Zero disables band streaming. */
+	uint32_t stream_threshold{};
+
+	/** Back large image buffers with huge pages when the system supports them. */
+	bool huge_pages{};
+
+	/** Lower the CPU and I/O priority of the pipeline threads. */
+	bool background{};
+
+	/**
+	 * Maximum CPU usage of the pipeline, as a percentage of the CPUs available to the process according to limits.
+	 * Zero disables the limit.
+	 */
+	uint16_t cpu_limit{};
+
+	/** Maximum speed of reading and writing files in MiB per second. Zero disables the limit. */
+	uint32_t io_limit{};
+
+	/** Measure the time spent by each stage of the pipeline, and report it after finishing. */
+	bool stats{};
+
+	/** If not empty, write the occupancy of the pipeline over time to this CSV file. Requires stats. */
+	boost::filesystem::path stats_timeline{};
+
+	/** If not empty, record the profiler zones of the pipeline and write them to this file as Chrome trace events. */
+	boost::filesystem::path trace{};
+
+	/** Count hardware events in each profiler zone, and report them after finishing. Only supported on Linux. */
+	bool perf_counters{};
+
+	/** If not empty, write the measurements of each file to this file while encoding. CSV or JSON Lines. */
+	boost::filesystem::path report_file{};
+
+	/** Decode each DDS mipmap level after encoding it, and add its error to the report of the file. */
+	bool error_metrics{};
+
+	/** If not empty, rewrite this file periodically with the current totals of the pipeline in Prometheus text format. */
+	boost::filesystem::path metrics_file{};
+
+	/** Seconds between each rewrite of the metrics file. */
+	uint32_t metrics_interval{};
+
+	/** If not empty, write the decoded image of each file encoded as DDS to this capture file. See todds/capture.hpp. */
+	boost::filesystem::path capture_file{};
+
+	/** Minimum PSNR in dB of every file for a quality level to be recommended by pipeline::sweep. */
+	double sweep_target{};
+
+	/** Resource limits of the process. Determine the number of tokens and the memory kept by the buffer pool. */
+	cgroup::limits limits{};
 };
 
 } // namespace todds::pipeline
@@ -18,4 +18,20 @@ namespace todds::pipeline {
  */
 void encode_as_dds(const input& input_data, std::atomic<bool>& force_finish, todds::report_queue& updates);
 
+/**
+ * Number of NUMA nodes which can be used by encode_as_dds.
+ * @return Number of nodes. Builds using the address sanitizer always use a single node.
+ */
+[[nodiscard]] std::size_t numa_node_count();
+
+/**
+ * Encodes a list of PNG files with every quality level up to input_data.quality, without saving them. The encoding time
+ * and the error of each quality level are reported as a table, recommending the fastest level whose PSNR reaches
+ * input_data.sweep_target in every file. Results of each file are written to input_data.report_file.
+ * @param input_data Input data to use for the sweep. Scaling is not applied.
+ * @param force_finish Used to stop the sweep early. Files already swept are still reported.
+ * @param updates The sweep will report updates back to the caller using this queue.
+ */
+void sweep(const input& input_data, std::atomic<bool>& force_finish, todds::report_queue& updates);
+
 } // namespace todds::pipeline
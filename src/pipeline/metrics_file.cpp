@@ -0,0 +1,126 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "metrics_file.hpp"
+
+#include "todds/buffer_pool.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <fmt/format.h>
+
+#include <array>
+#include <string_view>
+
+namespace {
+
+constexpr double nanoseconds_per_second = 1.0e9;
+
+constexpr std::array<std::string_view, todds::pipeline::impl::block_format_count> block_format_labels{
+	"bc1", "bc3", "bc7"};
+
+// Adds the metadata of a metric family. Names of counters must include the _total suffix, as their samples do.
+void add_family(todds::string& text, std::string_view name, std::string_view type, std::string_view help) {
+	text += fmt::format("# HELP {:s} {:s}\n# TYPE {:s} {:s}\n", name, help, name, type);
+}
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+string metrics_text(const stage_statistics& statistics, const report_queue& updates) {
+	const live_totals totals = statistics.totals();
+	const occupancy& filters = statistics.filters();
+	string text;
+
+	add_family(text, "todds_files_total", "counter", "Files processed by the pipeline.");
+	text += fmt::format("todds_files_total{{result=\"encoded\"}} {:d}\ntodds_files_total{{result=\"failed\"}} {:d}\n",
+		updates.progress(progress_type::encoded_textures), updates.progress(progress_type::failed_textures));
+
+	add_family(text, "todds_io_bytes_total", "counter", "Bytes read from input files and written to output files.");
+	text += fmt::format(
+		"todds_io_bytes_total{{direction=\"read\"}} {:d}\ntodds_io_bytes_total{{direction=\"written\"}} {:d}\n",
+		totals.read_bytes, totals.written_bytes);
+
+	add_family(text, "todds_stage_busy_seconds_total", "counter", "Time spent by every thread in each stage.");
+	for (std::size_t index = 0UL; index < stage_count; ++index) {
+		text += fmt::format("todds_stage_busy_seconds_total{{stage=\"{:s}\"}} {:.6f}\n", stage_names[index],
+			static_cast<double>(totals.busy_nanoseconds[index]) / nanoseconds_per_second);
+	}
+
+	std::size_t active{};
+	add_family(text, "todds_filter_files", "gauge", "Files currently being processed by each filter.");
+	for (std::size_t index = 0UL; index < pipeline_filter_count; ++index) {
+		const std::size_t files = filters.active(static_cast<pipeline_filter>(index));
+		active += files;
+		text += fmt::format("todds_filter_files{{filter=\"{:s}\"}} {:d}\n", pipeline_filter_names[index], files);
+	}
+
+	// Filters may be entered or left between reading both values.
+	const std::size_t in_flight = filters.in_flight();
+	add_family(text, "todds_tokens_in_flight", "gauge", "Files loaded by the pipeline which have not been saved yet.");
+	text += fmt::format("todds_tokens_in_flight {:d}\n", in_flight);
+	add_family(text, "todds_tokens_waiting", "gauge", "Files in flight waiting between two filters.");
+	text += fmt::format("todds_tokens_waiting {:d}\n", in_flight > active ? in_flight - active : 0UL);
+
+	add_family(text, "todds_blocks_encoded_total", "counter", "Blocks encoded in each format.");
+	for (std::size_t index = 0UL; index < block_format_count; ++index) {
+		text += fmt::format(
+			"todds_blocks_encoded_total{{format=\"{:s}\"}} {:d}\n", block_format_labels[index], totals.blocks[index]);
+	}
+
+	add_family(text, "todds_resident_memory_bytes", "gauge", "Resident memory of the process.");
+	text += fmt::format("todds_resident_memory_bytes {:d}\n", buffer_pool::get_statistics().resident_bytes);
+
+	// Prometheus parsers treat it as a comment. It lets other readers check that the file is complete.
+	text += "# EOF\n";
+	return text;
+}
+
+metrics_file::metrics_file(const boost::filesystem::path& path, std::chrono::seconds interval,
+	const stage_statistics& statistics, const report_queue& updates)
+	: _path{path}
+	, _interval{interval}
+	, _statistics{statistics}
+	, _updates{updates} {
+	if (!enabled()) { return; }
+	_writer = std::jthread{[this](const std::stop_token& stop) { write_loop(stop); }};
+}
+
+bool metrics_file::enabled() const noexcept { return !_path.empty(); }
+
+bool metrics_file::good() const noexcept { return _good.load(std::memory_order_relaxed); }
+
+void metrics_file::stop() {
+	if (!enabled()) { return; }
+	_writer.request_stop();
+	_writer.join();
+	write();
+}
+
+void metrics_file::write_loop(const std::stop_token& stop) {
+	std::unique_lock lock{_mutex};
+	while (!_condition.wait_for(lock, stop, _interval, [&stop] { return stop.stop_requested(); })) { write(); }
+}
+
+void metrics_file::write() {
+	boost::filesystem::path temporary{_path};
+	temporary += ".tmp";
+	{
+		boost::nowide::ofstream output{temporary, std::ios::out | std::ios::binary};
+		output << metrics_text(_statistics, _updates);
+		output.close();
+		if (!output) {
+			_good.store(false, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	boost::system::error_code error_code;
+	boost::filesystem::rename(temporary, _path, error_code);
+	if (error_code) { _good.store(false, std::memory_order_relaxed); }
+}
+
+} // namespace todds::pipeline::impl
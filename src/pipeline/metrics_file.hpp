@@ -0,0 +1,64 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/report.hpp"
+#include "todds/string.hpp"
+
+#include <boost/filesystem/path.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+#include "stage_statistics.hpp"
+
+namespace todds::pipeline::impl {
+
+// Current totals of the pipeline in the Prometheus text format 0.0.4, which the textfile collector of the node exporter
+// reads. The text ends with an OpenMetrics # EOF line.
+[[nodiscard]] string metrics_text(const stage_statistics& statistics, const report_queue& updates);
+
+// Rewrites a file with the current totals of the pipeline periodically, so long runs can be followed by monitoring
+// tools. Each version is written into a temporary file which then replaces the previous one, so readers never see a
+// partially written file.
+class metrics_file final {
+public:
+	// An empty path disables the file. The first version is written after the first interval.
+	metrics_file(const boost::filesystem::path& path, std::chrono::seconds interval, const stage_statistics& statistics,
+		const report_queue& updates);
+	metrics_file(const metrics_file&) = delete;
+	metrics_file(metrics_file&&) = delete;
+	metrics_file& operator=(const metrics_file&) = delete;
+	metrics_file& operator=(metrics_file&&) = delete;
+	~metrics_file() = default;
+
+	[[nodiscard]] bool enabled() const noexcept;
+
+	// False if any version of the file could not be written.
+	[[nodiscard]] bool good() const noexcept;
+
+	// Stop the periodic writes and write the final totals. Must be called after every pipeline has finished.
+	void stop();
+
+private:
+	void write_loop(const std::stop_token& stop);
+	void write();
+
+	boost::filesystem::path _path;
+	std::chrono::seconds _interval;
+	const stage_statistics& _statistics;
+	const report_queue& _updates;
+	std::atomic<bool> _good{true};
+	std::mutex _mutex;
+	std::condition_variable_any _condition;
+	std::jthread _writer;
+};
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,230 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "occupancy.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <string_view>
+
+namespace {
+
+constexpr std::chrono::milliseconds sample_interval{10};
+
+// Maximum number of samples kept in the time series. At the sampling interval, it covers about 40 seconds before
+// samples start being dropped.
+constexpr std::size_t max_series_samples = 4096UL;
+
+// Marks files which have not left any filter yet.
+constexpr std::int64_t not_started = -1;
+
+// Workers are considered to be starved of tokens when they are idle more than this fraction of the time, and the
+// token limit has been reached in more than this fraction of the samples.
+constexpr double starved_fraction = 0.1;
+constexpr double limited_fraction = 0.5;
+
+constexpr double nanoseconds_per_second = 1.0e9;
+constexpr double nanoseconds_per_millisecond = 1.0e6;
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+occupancy::occupancy(bool enabled, bool sampling, std::size_t files)
+	: _enabled{enabled}
+	, _sampling{enabled && sampling}
+	, _files{files} {
+	if (_enabled) { _last_leave.resize(files, not_started); }
+}
+
+bool occupancy::enabled() const noexcept { return _enabled; }
+
+std::size_t occupancy::in_flight() const noexcept { return _in_flight.load(std::memory_order_relaxed); }
+
+std::size_t occupancy::active(pipeline_filter filter) const noexcept {
+	return _active[static_cast<std::size_t>(filter)].load(std::memory_order_relaxed);
+}
+
+void occupancy::start(std::size_t parallelism, std::size_t tokens) {
+	if (!_enabled) { return; }
+	_parallelism = parallelism;
+	_tokens = tokens;
+	_start = clock::now();
+	if (_sampling) {
+		_token_samples.assign(tokens + 1UL, 0UL);
+		_series.reserve(max_series_samples);
+		_sampler = std::jthread{[this](const std::stop_token& stop) { sample_loop(stop); }};
+	}
+}
+
+void occupancy::stop() {
+	if (!_enabled) { return; }
+	if (_sampler.joinable()) {
+		_sampler.request_stop();
+		_sampler.join();
+	}
+	_duration = clock::now() - _start;
+}
+
+void occupancy::enter(pipeline_filter filter, std::size_t file_index) {
+	const auto index = static_cast<std::size_t>(filter);
+	_active[index].fetch_add(1UL, std::memory_order_relaxed);
+	if (filter == pipeline_filter::load) { _in_flight.fetch_add(1UL, std::memory_order_relaxed); }
+	if (file_index >= _last_leave.size() || _last_leave[file_index] == not_started) { return; }
+	const std::int64_t now = (clock::now() - _start).count();
+	const std::int64_t waited = std::max(now - _last_leave[file_index], std::int64_t{});
+	_threads.local().queueing[index].add(static_cast<std::uint64_t>(waited));
+}
+
+void occupancy::leave(pipeline_filter filter, std::size_t file_index, std::chrono::nanoseconds busy) {
+	const auto index = static_cast<std::size_t>(filter);
+	_threads.local().busy[index] += static_cast<std::uint64_t>(busy.count());
+	if (file_index < _last_leave.size()) { _last_leave[file_index] = (clock::now() - _start).count(); }
+	if (filter == pipeline_filter::save) {
+		_in_flight.fetch_sub(1UL, std::memory_order_relaxed);
+		_completed.fetch_add(1UL, std::memory_order_relaxed);
+	}
+	_active[index].fetch_sub(1UL, std::memory_order_relaxed);
+}
+
+void occupancy::sample_loop(const std::stop_token& stop) {
+	while (!stop.stop_requested()) {
+		sample current{std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - _start),
+			_in_flight.load(std::memory_order_relaxed), {}};
+		for (std::size_t index = 0UL; index < filter_count; ++index) {
+			current.active[index] = _active[index].load(std::memory_order_relaxed);
+		}
+		add_sample(current);
+		std::this_thread::sleep_for(sample_interval);
+	}
+}
+
+void occupancy::add_sample(const sample& current) {
+	++_token_samples[std::min(current.tokens, _token_samples.size() - 1UL)];
+	const bool keep = _sample_count % _series_stride == 0UL;
+	++_sample_count;
+	if (!keep) { return; }
+	if (_series.size() == max_series_samples) {
+		// Keep every other sample, so the series still covers the whole run at half the resolution.
+		for (std::size_t index = 0UL; index < max_series_samples / 2UL; ++index) { _series[index] = _series[index * 2UL]; }
+		_series.resize(max_series_samples / 2UL);
+		_series_stride *= 2UL;
+		if ((_sample_count - 1UL) % _series_stride != 0UL) { return; }
+	}
+	_series.push_back(current);
+}
+
+string occupancy::summary() const {
+	accumulators combined{};
+	for (const auto& local : _threads) {
+		for (std::size_t index = 0UL; index < filter_count; ++index) {
+			combined.busy[index] += local.busy[index];
+			combined.queueing[index].merge(local.queueing[index]);
+		}
+	}
+
+	const auto wall = static_cast<double>(_duration.count());
+	const auto total_busy =
+		static_cast<double>(std::accumulate(combined.busy.begin(), combined.busy.end(), std::uint64_t{}));
+	const double capacity = wall * static_cast<double>(_parallelism);
+	const double idle = capacity > 0.0 ? std::max(1.0 - total_busy / capacity, 0.0) : 0.0;
+
+	const double samples = std::max(static_cast<double>(_sample_count), 1.0);
+	const auto p95_rank = static_cast<std::uint64_t>(std::ceil(0.95 * static_cast<double>(_sample_count)));
+	std::uint64_t token_sum{};
+	std::uint64_t at_limit{};
+	std::uint64_t seen{};
+	std::size_t max_tokens{};
+	std::size_t p95_tokens{};
+	for (std::size_t count = 0UL; count < _token_samples.size(); ++count) {
+		const std::uint64_t current = _token_samples[count];
+		if (current == 0UL) { continue; }
+		token_sum += current * count;
+		if (count >= _tokens) { at_limit += current; }
+		if (seen < p95_rank) { p95_tokens = count; }
+		seen += current;
+		max_tokens = count;
+	}
+	const double mean_tokens = static_cast<double>(token_sum) / samples;
+	const double limited = static_cast<double>(at_limit) / samples;
+
+	string result{fmt::format(
+		"Tokens in flight: mean {:.1f}, 95th percentile {:d}, maximum {:d} of {:d} (at the limit in {:.1f}% of the "
+		"samples).\nWorkers: {:d}, idle {:.1f}% of the time. Files: {:d} of {:d} in {:.3f} seconds.",
+		mean_tokens, p95_tokens, max_tokens, _tokens, limited * 100.0, _parallelism, idle * 100.0,
+		_completed.load(std::memory_order_relaxed), _files, wall / nanoseconds_per_second)};
+
+	result += fmt::format("\n{:<8s}{:>11s}{:>9s}{:>9s}{:>18s}{:>17s}", "Filter", "Busy (s)", "Share", "Active",
+		"Queue mean (ms)", "Queue p95 (ms)");
+	std::size_t limiting{};
+	for (std::size_t index = 0UL; index < filter_count; ++index) {
+		const auto busy = static_cast<double>(combined.busy[index]);
+		if (busy == 0.0) { continue; }
+		if (combined.busy[index] > combined.busy[limiting]) { limiting = index; }
+		const auto& queueing = combined.queueing[index];
+		result += fmt::format("\n{:<8s}{:>11.3f}{:>8.1f}%{:>9.2f}{:>18.3f}{:>17.3f}", pipeline_filter_names[index],
+			busy / nanoseconds_per_second, total_busy > 0.0 ? busy / total_busy * 100.0 : 0.0,
+			wall > 0.0 ? busy / wall : 0.0, queueing.mean() / nanoseconds_per_millisecond,
+			static_cast<double>(queueing.percentile(0.95)) / nanoseconds_per_millisecond);
+	}
+
+	if (total_busy > 0.0) {
+		result += fmt::format("\nLimiting filter: {:s} ({:.1f}% of the busy time).", pipeline_filter_names[limiting],
+			static_cast<double>(combined.busy[limiting]) / total_busy * 100.0);
+	}
+
+	// When workers were idle while every token was in use, more tokens would have kept them busy. By Little's law, the
+	// tokens in flight are the throughput times the time that each file spends in the pipeline. Keeping every worker
+	// busy requires parallelism tokens being processed while the rest wait between filters, so the estimate is
+	// parallelism * (busy + queueing) / busy. It assumes that queueing delays stay the same with more tokens.
+	// Otherwise, the tokens used by most samples were enough, and the remaining ones only kept memory.
+	if (idle > starved_fraction && limited > limited_fraction) {
+		const auto total_queueing = static_cast<double>(std::accumulate(combined.queueing.begin(),
+			combined.queueing.end(), std::uint64_t{}, [](std::uint64_t sum, const histogram& queueing) {
+				return sum + queueing.total();
+			}));
+		const double residence = total_busy > 0.0 ? (total_busy + total_queueing) / total_busy : 0.0;
+		const auto needed = static_cast<std::size_t>(std::ceil(static_cast<double>(_parallelism) * residence));
+		result += fmt::format(
+			"\nSuggested tokens: {:d} (workers were idle while every token was in use; estimated from the time that files "
+			"spend in the filters and waiting between them).",
+			std::max(needed, _tokens + 1UL));
+	} else {
+		result += fmt::format("\nSuggested tokens: {:d} (95% of the samples had at most {:d} tokens in flight).",
+			std::max(_parallelism, p95_tokens), p95_tokens);
+	}
+	return result;
+}
+
+void occupancy::write_series(std::ostream& output) const {
+	output << "time_ms,tokens";
+	for (const auto name : pipeline_filter_names) { output << ',' << name; }
+	output << ",idle\n";
+	for (const auto& current : _series) {
+		const std::size_t active = std::accumulate(current.active.begin(), current.active.end(), 0UL);
+		output << fmt::format("{:d},{:d}", current.time.count(), current.tokens);
+		for (const auto value : current.active) { output << fmt::format(",{:d}", value); }
+		output << fmt::format(",{:d}\n", _parallelism > active ? _parallelism - active : 0UL);
+	}
+}
+
+occupancy_scope::occupancy_scope(occupancy& tracker, pipeline_filter filter, std::size_t file_index)
+	: _tracker{tracker}
+	, _filter{filter}
+	, _file_index{file_index} {
+	if (_tracker.enabled()) {
+		_start = std::chrono::steady_clock::now();
+		_tracker.enter(_filter, _file_index);
+	}
+}
+
+occupancy_scope::~occupancy_scope() {
+	if (_tracker.enabled()) { _tracker.leave(_filter, _file_index, std::chrono::steady_clock::now() - _start); }
+}
+
+} // namespace todds::pipeline::impl
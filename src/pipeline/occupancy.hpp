@@ -0,0 +1,136 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/histogram.hpp"
+#include "todds/string.hpp"
+#include "todds/vector.hpp"
+
+#include <oneapi/tbb/enumerable_thread_specific.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <thread>
+
+namespace todds::pipeline::impl {
+
+// Filters of the parallel pipeline. Every token goes through load and save, and through the filters between them
+// which are used by the current settings.
+enum class pipeline_filter {
+	load,
+	stream,
+	decode,
+	encode,
+	save,
+};
+
+constexpr std::size_t pipeline_filter_count = 5UL;
+
+constexpr std::array<std::string_view, pipeline_filter_count> pipeline_filter_names{
+	"load", "stream", "decode", "encode", "save"};
+
+// Measures how tokens flow through the filters of the pipeline: tokens in flight, files being processed by each
+// filter, time that tokens wait between filters and time that workers spend without a token. A background thread
+// samples the state of the pipeline periodically. Samples are folded into fixed-size counters, and a bounded number of
+// them is kept as a time series which covers the whole run.
+class occupancy final {
+public:
+	// Files must contain the number of files to process. Does nothing unless enabled. Without sampling, only the current
+	// state and the totals are available.
+	occupancy(bool enabled, bool sampling, std::size_t files);
+
+	[[nodiscard]] bool enabled() const noexcept;
+
+	// Start sampling. Parallelism and tokens are the threads and the maximum number of tokens of every pipeline.
+	void start(std::size_t parallelism, std::size_t tokens);
+
+	// Stop sampling. Must be called after every pipeline has finished.
+	void stop();
+
+	// Tokens currently in flight. Can be called while the pipeline is running.
+	[[nodiscard]] std::size_t in_flight() const noexcept;
+
+	// Files currently being processed by a filter. Can be called while the pipeline is running.
+	[[nodiscard]] std::size_t active(pipeline_filter filter) const noexcept;
+
+	// Called when a filter starts processing a file. Entering the load filter adds a token in flight.
+	void enter(pipeline_filter filter, std::size_t file_index);
+
+	// Called when a filter finishes processing a file. Leaving the save filter removes a token in flight.
+	void leave(pipeline_filter filter, std::size_t file_index, std::chrono::nanoseconds busy);
+
+	// Tokens in flight, idle workers, busy time and queueing delay of each filter, the filter limiting throughput and
+	// the suggested number of tokens. Must be called after stop.
+	[[nodiscard]] string summary() const;
+
+	// Write the time series in CSV format. Long runs keep one of every few samples. Must be called after stop.
+	void write_series(std::ostream& output) const;
+
+private:
+	using clock = std::chrono::steady_clock;
+	static constexpr std::size_t filter_count = pipeline_filter_count;
+
+	struct sample {
+		std::chrono::milliseconds time;
+		std::size_t tokens;
+		std::array<std::size_t, filter_count> active;
+	};
+
+	struct accumulators {
+		std::array<std::uint64_t, filter_count> busy{};
+		std::array<histogram, filter_count> queueing{};
+	};
+
+	void sample_loop(const std::stop_token& stop);
+
+	void add_sample(const sample& current);
+
+	bool _enabled;
+	bool _sampling;
+	std::size_t _parallelism{};
+	std::size_t _tokens{};
+	std::size_t _files{};
+	clock::time_point _start{};
+	std::chrono::nanoseconds _duration{};
+	std::atomic<std::size_t> _in_flight{};
+	std::atomic<std::size_t> _completed{};
+	std::array<std::atomic<std::size_t>, filter_count> _active{};
+	// Time at which each file left its previous filter, in nanoseconds since the start. The pipeline ensures that a
+	// file is only processed by one filter at a time.
+	vector<std::int64_t> _last_leave;
+	oneapi::tbb::enumerable_thread_specific<accumulators> _threads;
+	// Number of samples with each count of tokens in flight, from zero to the maximum number of tokens.
+	vector<std::uint64_t> _token_samples;
+	std::uint64_t _sample_count{};
+	// Time series. Only one of every _series_stride samples is kept, and the stride doubles when the series is full.
+	vector<sample> _series;
+	std::size_t _series_stride{1UL};
+	std::jthread _sampler;
+};
+
+// Registers the processing of a file by a filter during the lifetime of the scope.
+class occupancy_scope final {
+public:
+	occupancy_scope(occupancy& tracker, pipeline_filter filter, std::size_t file_index);
+	occupancy_scope(const occupancy_scope&) = delete;
+	occupancy_scope(occupancy_scope&&) = delete;
+	occupancy_scope& operator=(const occupancy_scope&) = delete;
+	occupancy_scope& operator=(occupancy_scope&&) = delete;
+	~occupancy_scope();
+
+private:
+	occupancy& _tracker;
+	pipeline_filter _filter;
+	std::size_t _file_index;
+	std::chrono::steady_clock::time_point _start;
+};
+
+} // namespace todds::pipeline::impl
@@ -5,51 +5,362 @@
 
 #include "todds/pipeline.hpp"
 
+#include "todds/allocations.hpp"
+#include "todds/buffer_pool.hpp"
+#include "todds/capture.hpp"
 #include "todds/dds.hpp"
+#include "todds/perf.hpp"
 #include "todds/string.hpp"
+#include "todds/trace.hpp"
 
+#include <boost/nowide/fstream.hpp>
 #include <boost/nowide/iostream.hpp>
 #include <fmt/format.h>
 #include <oneapi/tbb/global_control.h>
+#include <oneapi/tbb/info.h>
 #include <oneapi/tbb/parallel_pipeline.h>
+#include <oneapi/tbb/task_arena.h>
+#include <oneapi/tbb/task_scheduler_observer.h>
+#include <oneapi/tbb/tick_count.h>
+#include <opencv2/core.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 
 #include "filter_common.hpp"
 #include "get_filters_from_settings.hpp"
+#include "metrics_file.hpp"
+#include "stage_statistics.hpp"
+
+#if defined(__SANITIZE_ADDRESS__)
+#define TODDS_ADDRESS_SANITIZER
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define TODDS_ADDRESS_SANITIZER
+#endif
+#endif
 
 namespace otbb = oneapi::tbb;
 using todds::dds_image;
 using todds::pipeline::paths_vector;
+
+namespace {
+
+// Configures every thread joining the pipeline. Files are processed by the NUMA node of the thread which loads them,
+// and threads of each node only recycle buffers of their own node. In background mode, worker threads run with a
+// lowered priority while they are in the arena, and their previous priority is restored when they leave it.
+class thread_observer final : public otbb::task_scheduler_observer {
+public:
+	// Observes the worker threads joining the arena of the calling thread.
+	explicit thread_observer(std::size_t node)
+		: _node{node}
+		, _background{false} {
+		observe(true);
+	}
+
+	thread_observer(otbb::task_arena& arena, std::size_t node, bool background)
+		: otbb::task_scheduler_observer(arena)
+		, _node{node}
+		, _background{background} {
+		observe(true);
+	}
+
+	thread_observer(const thread_observer&) = delete;
+	thread_observer(thread_observer&&) = delete;
+	thread_observer& operator=(const thread_observer&) = delete;
+	thread_observer& operator=(thread_observer&&) = delete;
+
+	// Threads leaving the arena after observing stops would keep their lowered priority, so the observer waits until
+	// every lowered thread has left. Workers leave an arena as soon as it runs out of work, and threads joining it
+	// from now on are not lowered.
+	~thread_observer() override {
+		{
+			std::unique_lock lock{_mutex};
+			_closing = true;
+			_left.wait(lock, [this] { return _lowered == 0UL; });
+		}
+		observe(false);
+	}
+
+	void on_scheduler_entry(bool is_worker) override {
+		todds::buffer_pool::set_numa_node(_node);
+		if (!_background || !is_worker) { return; }
+		const std::lock_guard lock{_mutex};
+		if (_closing) { return; }
+		previous_priority() = todds::pipeline::impl::lower_thread_priority();
+		++_lowered;
+	}
+
+	void on_scheduler_exit(bool /*is_worker*/) override {
+		auto& previous = previous_priority();
+		if (!previous) { return; }
+		todds::pipeline::impl::restore_thread_priority(*previous);
+		previous.reset();
+		const std::lock_guard lock{_mutex};
+		--_lowered;
+		_left.notify_all();
+	}
+
+private:
+	// Priority of the calling thread before it was lowered. Worker threads are only in one arena at a time.
+	static std::optional<todds::pipeline::impl::thread_priority>& previous_priority() noexcept {
+		thread_local std::optional<todds::pipeline::impl::thread_priority> priority{};
+		return priority;
+	}
+
+	std::size_t _node;
+	bool _background;
+	std::mutex _mutex;
+	std::condition_variable _left;
+	std::size_t _lowered{};
+	bool _closing{};
+};
+
+constexpr std::size_t mebibyte = 1024UL * 1024UL;
+
+// Each token keeps the buffers of a single file. Most files need less memory, but a 4K image with its mipmaps, its
+// encoded data and its PNG file need close to this amount.
+constexpr std::size_t token_memory = 64UL * mebibyte;
+
+constexpr std::size_t maximum_tokens_per_thread = 4UL;
+
+// Maximum number of files that each thread of the pipeline can process at the same time. Under a memory limit, fewer
+// files are processed at the same time, but each thread always has at least one.
+std::size_t get_tokens_per_thread(std::size_t parallelism, std::size_t memory_limit) noexcept {
+	if (memory_limit == 0UL) { return maximum_tokens_per_thread; }
+	return std::clamp(memory_limit / (token_memory * parallelism), 1UL, maximum_tokens_per_thread);
+}
+
+// Memory kept in the buffer pool is not used by any file, so it is limited to a fraction of the memory limit.
+std::size_t get_cache_limit(std::size_t memory_limit) noexcept {
+	if (memory_limit == 0UL) { return todds::buffer_pool::default_cache_limit; }
+	return std::min(todds::buffer_pool::default_cache_limit, memory_limit / 4UL);
+}
+
+std::string cpu_limit_text(std::size_t cpus) { return cpus == 0UL ? "none" : fmt::format("{:d} CPUs", cpus); }
+
+std::string memory_limit_text(std::size_t bytes) {
+	return bytes == 0UL ? "none" : fmt::format("{:.1f} MiB", static_cast<double>(bytes) / static_cast<double>(mebibyte));
+}
+
+// oneTBB loads its topology library with RTLD_DEEPBIND, which is not supported by the address sanitizer.
+std::vector<otbb::numa_node_id> get_numa_nodes() {
+#if defined(TODDS_ADDRESS_SANITIZER)
+	return {otbb::task_arena::automatic};
+#else
+	return otbb::info::numa_nodes();
+#endif
+}
+
+// Distributes threads between NUMA nodes one at a time, without exceeding the processors of any node unless every
+// node is full. Nodes may end up without threads when parallelism is smaller than the number of nodes.
+todds::vector<std::size_t> threads_per_node(std::size_t parallelism, const std::vector<otbb::numa_node_id>& nodes) {
+	todds::vector<std::size_t> capacity(nodes.size());
+	std::size_t total_capacity{};
+	for (std::size_t node = 0UL; node < nodes.size(); ++node) {
+		capacity[node] = static_cast<std::size_t>(otbb::info::default_concurrency(nodes[node]));
+		total_capacity += capacity[node];
+	}
+
+	todds::vector<std::size_t> threads(nodes.size());
+	std::size_t assigned{};
+	while (assigned < parallelism) {
+		for (std::size_t node = 0UL; node < nodes.size() && assigned < parallelism; ++node) {
+			if (threads[node] < capacity[node] || assigned >= total_capacity) {
+				++threads[node];
+				++assigned;
+			}
+		}
+	}
+	return threads;
+}
+
+// Each NUMA node runs its own pipeline in an arena with threads pinned to the node. Every pipeline takes files from
+// the same counter, and keeps each file in its node from loading until saving. The main thread waits outside of the
+// arenas, so it never runs any part of the pipeline.
+void run_numa_pipelines(const todds::pipeline::input& input_data, const std::vector<otbb::numa_node_id>& nodes,
+	std::size_t tokens_per_thread, std::atomic<std::size_t>& counter, std::atomic<bool>& force_finish,
+	todds::report_queue& updates, todds::vector<todds::pipeline::impl::file_data>& files_data,
+	todds::pipeline::impl::throttle& limits, todds::pipeline::impl::stage_statistics& statistics,
+	todds::capture::writer& capture) {
+	const otbb::global_control control(otbb::global_control::max_allowed_parallelism, input_data.parallelism + 1UL);
+	const auto threads = threads_per_node(input_data.parallelism, nodes);
+	todds::vector<otbb::task_arena> arenas;
+	arenas.reserve(nodes.size());
+	todds::vector<std::unique_ptr<thread_observer>> observers;
+	const auto used_nodes = std::count_if(threads.begin(), threads.end(), [](std::size_t count) { return count > 0UL; });
+	std::latch finished{used_nodes};
+	todds::vector<std::exception_ptr> errors(nodes.size());
+	todds::vector<double> seconds(nodes.size());
+	for (std::size_t node = 0UL; node < nodes.size(); ++node) {
+		if (threads[node] == 0UL) { continue; }
+		// Every thread of the arena is a worker thread.
+		auto& arena =
+			arenas.emplace_back(otbb::task_arena::constraints{nodes[node], static_cast<int>(threads[node])}, 0U);
+		observers.emplace_back(std::make_unique<thread_observer>(arena, node, input_data.background));
+		arena.enqueue([&, node] {
+			try {
+				const auto start = otbb::tick_count::now();
+				const otbb::filter<void, void> filters = todds::pipeline::impl::get_filters_from_settings(
+					input_data, counter, force_finish, updates, files_data, node, limits, statistics, capture);
+				otbb::parallel_pipeline(threads[node] * tokens_per_thread, filters);
+				seconds[node] = (otbb::tick_count::now() - start).seconds();
+			} catch (...) {
+				errors[node] = std::current_exception();
+			}
+			finished.count_down();
+		});
+	}
+	finished.wait();
+	for (const auto& error : errors) {
+		if (error) { std::rethrow_exception(error); }
+	}
+
+	// Files which were not loaded, or which failed before being saved, are not counted.
+	todds::vector<std::size_t> files(nodes.size());
+	for (const auto& data : files_data) {
+		if (data.saved) { ++files[data.numa_node]; }
+	}
+	for (std::size_t node = 0UL; node < nodes.size(); ++node) {
+		if (threads[node] == 0UL) { continue; }
+		const double files_per_second = seconds[node] > 0.0 ? static_cast<double>(files[node]) / seconds[node] : 0.0;
+		updates.emplace(todds::report_type::numa_statistics,
+			fmt::format("NUMA node {:d}: {:d} threads, {:d} files in {:.3f} seconds ({:.2f} files per second).",
+				nodes[node], threads[node], files[node], seconds[node], files_per_second));
+	}
+}
+
+} // Anonymous namespace
+
 namespace todds::pipeline {
 
 void encode_as_dds(const input& input_data, std::atomic<bool>& force_finish, report_queue& updates) {
 	dds::initialize_encoding(input_data.format, input_data.alpha_format);
+	buffer_pool::set_huge_pages(input_data.huge_pages);
+	const auto& limits = input_data.limits;
+	const std::size_t tokens_per_thread = get_tokens_per_thread(input_data.parallelism, limits.memory);
+	const std::size_t cache_limit = get_cache_limit(limits.memory);
+	buffer_pool::set_cache_limit(cache_limit);
+	updates.emplace(report_type::resource_limits,
+		fmt::format("CPU quota: {:s}. Cpuset: {:s}. Memory limit: {:s}. Using {:d} threads, {:d} files in flight per "
+			"thread and a buffer pool of up to {:s}.",
+			cpu_limit_text(limits.cpu_quota), cpu_limit_text(limits.cpuset), memory_limit_text(limits.memory),
+			input_data.parallelism, tokens_per_thread, memory_limit_text(cache_limit)));
 
 	// Ensure that OpenCV is working in sequential mode.
 	cv::setNumThreads(0);
-	// Setup the parallel pipeline.
-	const otbb::global_control control(otbb::global_control::max_allowed_parallelism, input_data.parallelism);
-	// Maximum number of files that the pipeline can process at the same time.
-	const std::size_t tokens = input_data.parallelism * 4UL;
-
 	// Used to give each file processed in a token a unique file index to access the paths and files_data vectors.
 	std::atomic<std::size_t> counter;
 	// Contains extra data about each file being processed.
 	// Pipeline stages may write or read from this vector at any time. Since each token has a unique index, these
 	// accesses are thread-safe.
 	vector<impl::file_data> files_data(input_data.paths.size());
+	// Slows down the pipeline when it exceeds the CPU usage or the I/O bandwidth requested by the user.
+	impl::throttle resource_throttle{input_data.cpu_limit, input_data.io_limit * mebibyte, limits.cpus()};
+	// Time spent by each stage of the pipeline. Only measured when requested by the user.
+	impl::stage_statistics statistics{input_data.stats, !input_data.metrics_file.empty(), input_data.paths.size(),
+		input_data.report_file, input_data.error_metrics};
+	const bool report_opened = statistics.files().good();
+	if (!report_opened) {
+		updates.emplace(report_type::pipeline_error,
+			fmt::format("Could not open the file report {:s}", input_data.report_file.string()));
+	}
+	statistics.filters().start(input_data.parallelism, input_data.parallelism * tokens_per_thread);
+	impl::metrics_file metrics{
+		input_data.metrics_file, std::chrono::seconds{input_data.metrics_interval}, statistics, updates};
+	if (!input_data.trace.empty()) { trace::enable(); }
+	if (input_data.perf_counters) {
+		if (const string error = perf::enable(); !error.empty()) { updates.emplace(report_type::pipeline_error, error); }
+	}
+	// PNG files are encoded from images using pixel_layout::rows, which cannot be replayed.
+	capture::writer capture{input_data.format != format::type::png ? input_data.capture_file : boost::filesystem::path{}};
+
+	auto nodes = get_numa_nodes();
+	const bool limited_nodes = input_data.numa_nodes > 0UL && input_data.numa_nodes < nodes.size();
+	if (limited_nodes) { nodes.resize(input_data.numa_nodes); }
+	// In background mode, only worker threads run the pipeline, so the priority of the calling thread is not changed.
+	if (nodes.size() > 1UL || limited_nodes || input_data.background) {
+		run_numa_pipelines(input_data, nodes, tokens_per_thread, counter, force_finish, updates, files_data,
+			resource_throttle, statistics, capture);
+	} else {
+		const thread_observer observer{0UL};
+		// Setup the parallel pipeline.
+		const otbb::global_control control(otbb::global_control::max_allowed_parallelism, input_data.parallelism);
+		// Maximum number of files that the pipeline can process at the same time.
+		const std::size_t tokens = input_data.parallelism * tokens_per_thread;
+
+		const otbb::filter<void, void> filters = get_filters_from_settings(
+			input_data, counter, force_finish, updates, files_data, 0UL, resource_throttle, statistics, capture);
+
+		otbb::parallel_pipeline(tokens, filters);
+	}
 
-	const otbb::filter<void, void> filters =
-		get_filters_from_settings(input_data, counter, force_finish, updates, files_data);
+	statistics.filters().stop();
+	metrics.stop();
+	capture.close();
+	trace::disable();
+	const bool counted = perf::enabled();
+	perf::disable();
 
-	otbb::parallel_pipeline(tokens, filters);
+	const auto memory = buffer_pool::get_statistics();
+	updates.emplace(report_type::memory_statistics,
+		fmt::format("Buffer pool hit rate: {:.1f}% ({:d} hits, {:d} misses, {:d} on huge pages). "
+			"Page faults: {:d} minor, {:d} major. Peak resident memory: {:s}.",
+			memory.hit_rate() * 100.0, memory.hits, memory.misses, memory.huge_page_buffers, memory.minor_page_faults,
+			memory.major_page_faults, memory_limit_text(memory.peak_resident_bytes)));
+
+	if (statistics.enabled()) {
+		updates.emplace(report_type::stage_statistics,
+			statistics.summary() + '\n' + statistics.filters().summary() + '\n' + allocations::summary());
+	}
+
+	if (counted) { updates.emplace(report_type::performance_counters, perf::summary()); }
+
+	if (!input_data.stats_timeline.empty()) {
+		boost::nowide::ofstream timeline{input_data.stats_timeline, std::ios::out};
+		statistics.filters().write_series(timeline);
+		if (!timeline) {
+			updates.emplace(report_type::pipeline_error,
+				fmt::format("Could not write the statistics timeline to {:s}", input_data.stats_timeline.string()));
+		}
+	}
+
+	if (!input_data.trace.empty()) {
+		boost::nowide::ofstream trace_file{input_data.trace, std::ios::out};
+		trace::write(trace_file);
+		if (!trace_file) {
+			updates.emplace(
+				report_type::pipeline_error, fmt::format("Could not write the trace to {:s}", input_data.trace.string()));
+		}
+	}
+
+	if (!metrics.good()) {
+		updates.emplace(report_type::pipeline_error,
+			fmt::format("Could not write the metrics file {:s}", input_data.metrics_file.string()));
+	}
+
+	if (!capture.good()) {
+		updates.emplace(report_type::pipeline_error,
+			fmt::format("Could not write the capture file {:s}", input_data.capture_file.string()));
+	}
+
+	if (report_opened && !statistics.files().good()) {
+		updates.emplace(report_type::pipeline_error,
+			fmt::format("Could not write the file report {:s}", input_data.report_file.string()));
+	}
 
 	if (input_data.report) {
 		// Reports are not supported by the report system at the moment.
 		boost::nowide::cout << "File;Width;Height;Mipmaps;Format\n";
 		for (std::size_t index = 0U; index < input_data.paths.size(); ++index) {
-			const string& dds_path = input_data.paths[index].second.string();
+			const string dds_path{input_data.paths[index].second.string()};
 			const auto& data = files_data[index];
 			boost::nowide::cout << fmt::format(
 				"{:s};{:d};{:d};{:d};{:s}\n", dds_path, data.width, data.height, data.mipmaps, format::name(data.format));
@@ -57,4 +368,7 @@ void encode_as_dds(const input& input_data, std::atomic<bool>& force_finish, rep
 	}
 }
 
+
+std::size_t numa_node_count() { return get_numa_nodes().size(); }
+
 } // namespace todds::pipeline
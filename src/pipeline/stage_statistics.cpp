@@ -0,0 +1,122 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "stage_statistics.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <string_view>
+
+namespace {
+
+constexpr double nanoseconds_per_millisecond = 1.0e6;
+
+double to_milliseconds(double nanoseconds) noexcept { return nanoseconds / nanoseconds_per_millisecond; }
+
+double to_milliseconds(std::uint64_t nanoseconds) noexcept { return to_milliseconds(static_cast<double>(nanoseconds)); }
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+stage_statistics::stage_statistics(
+	bool enabled, bool live, std::size_t files, const boost::filesystem::path& report_path, bool error_metrics)
+	: _enabled{enabled}
+	, _live{live}
+	, _occupancy{enabled || live, enabled, files}
+	, _files{report_path, error_metrics} {}
+
+bool stage_statistics::enabled() const noexcept { return _enabled; }
+
+bool stage_statistics::live() const noexcept { return _live; }
+
+occupancy& stage_statistics::filters() noexcept { return _occupancy; }
+
+const occupancy& stage_statistics::filters() const noexcept { return _occupancy; }
+
+file_report& stage_statistics::files() noexcept { return _files; }
+
+void stage_statistics::add(stage type, std::chrono::nanoseconds duration, std::size_t bytes) {
+	auto& local = _threads.local();
+	const auto index = static_cast<std::size_t>(type);
+	local.durations[index].add(static_cast<std::uint64_t>(std::max(duration.count(), std::int64_t{})));
+	local.bytes[index] += bytes;
+}
+
+void stage_statistics::add_busy(stage type, std::chrono::nanoseconds duration) noexcept {
+	_live_counters.busy_nanoseconds[static_cast<std::size_t>(type)].fetch_add(
+		static_cast<std::uint64_t>(std::max(duration.count(), std::int64_t{})), std::memory_order_relaxed);
+}
+
+void stage_statistics::add_read(std::size_t bytes) noexcept {
+	if (_live) { _live_counters.read_bytes.fetch_add(bytes, std::memory_order_relaxed); }
+}
+
+void stage_statistics::add_written(format::type format, std::size_t bytes, std::size_t blocks) noexcept {
+	if (!_live) { return; }
+	_live_counters.written_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	const auto index = static_cast<std::size_t>(format);
+	if (index < block_format_count) { _live_counters.blocks[index].fetch_add(blocks, std::memory_order_relaxed); }
+}
+
+live_totals stage_statistics::totals() const noexcept {
+	live_totals result{};
+	for (std::size_t index = 0UL; index < stage_count; ++index) {
+		result.busy_nanoseconds[index] = _live_counters.busy_nanoseconds[index].load(std::memory_order_relaxed);
+	}
+	result.read_bytes = _live_counters.read_bytes.load(std::memory_order_relaxed);
+	result.written_bytes = _live_counters.written_bytes.load(std::memory_order_relaxed);
+	for (std::size_t index = 0UL; index < block_format_count; ++index) {
+		result.blocks[index] = _live_counters.blocks[index].load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+string stage_statistics::summary() const {
+	accumulators combined{};
+	for (const auto& local : _threads) {
+		for (std::size_t index = 0UL; index < stage_count; ++index) {
+			combined.durations[index].merge(local.durations[index]);
+			combined.bytes[index] += local.bytes[index];
+		}
+	}
+
+	string result{fmt::format("{:<8s}{:>10s}{:>12s}{:>11s}{:>11s}{:>11s}{:>11s}{:>11s}{:>12s}", "Stage", "Samples",
+		"Total (s)", "Mean (ms)", "p50 (ms)", "p95 (ms)", "p99 (ms)", "Max (ms)", "MiB")};
+	constexpr double mebibyte = 1024.0 * 1024.0;
+	for (std::size_t index = 0UL; index < stage_count; ++index) {
+		const auto& durations = combined.durations[index];
+		if (durations.count() == 0UL) { continue; }
+		result += fmt::format("\n{:<8s}{:>10d}{:>12.3f}{:>11.3f}{:>11.3f}{:>11.3f}{:>11.3f}{:>11.3f}{:>12.1f}",
+			stage_names[index], durations.count(), to_milliseconds(durations.total()) / 1000.0,
+			to_milliseconds(durations.mean()), to_milliseconds(durations.percentile(0.5)),
+			to_milliseconds(durations.percentile(0.95)), to_milliseconds(durations.percentile(0.99)),
+			to_milliseconds(durations.max()), static_cast<double>(combined.bytes[index]) / mebibyte);
+	}
+	return result;
+}
+
+stage_timer::stage_timer(stage_statistics& statistics, stage type, file_data& file) noexcept
+	: _statistics{statistics}
+	, _type{type}
+	, _file{file}
+	, _measuring{statistics.enabled() || statistics.live() || statistics.files().enabled()} {
+	if (_measuring) { _start = clock::now(); }
+}
+
+stage_timer::~stage_timer() {
+	if (!_measuring) { return; }
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _start);
+	if (_statistics.enabled()) { _statistics.add(_type, duration, _bytes); }
+	if (_statistics.live()) { _statistics.add_busy(_type, duration); }
+	if (_statistics.files().enabled()) {
+		_file.durations[static_cast<std::size_t>(_type)].fetch_add(duration.count(), std::memory_order_relaxed);
+	}
+}
+
+void stage_timer::set_bytes(std::size_t bytes) noexcept { _bytes = bytes; }
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,124 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/format.hpp"
+#include "todds/histogram.hpp"
+#include "todds/string.hpp"
+
+#include <oneapi/tbb/enumerable_thread_specific.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "file_report.hpp"
+#include "filter_common.hpp"
+#include "occupancy.hpp"
+
+namespace todds::pipeline::impl {
+
+// Number of formats encoded into blocks: BC1, BC3 and BC7.
+constexpr std::size_t block_format_count = 3UL;
+
+// Totals which are updated while the pipeline is running, so they can be exported before it finishes.
+struct live_totals {
+	std::array<std::uint64_t, stage_count> busy_nanoseconds{};
+	std::uint64_t read_bytes{};
+	std::uint64_t written_bytes{};
+	// Indexed by format::type.
+	std::array<std::uint64_t, block_format_count> blocks{};
+};
+
+// Duration and bytes processed by each invocation of each pipeline stage. Threads accumulate their samples separately,
+// so measuring a stage only costs reading the clock twice. Samples are combined after the pipeline finishes.
+class stage_statistics final {
+public:
+	// Files must contain the number of files to process. Live totals are only kept when live is true. Measurements of
+	// each file are written into report_path, if it is not empty, along with their error when error_metrics is true.
+	stage_statistics(bool enabled, bool live, std::size_t files, const boost::filesystem::path& report_path = {},
+		bool error_metrics = false);
+
+	[[nodiscard]] bool enabled() const noexcept;
+
+	[[nodiscard]] bool live() const noexcept;
+
+	// Flow of tokens through the filters of the pipeline. Enabled along with the statistics or the live totals, but
+	// only sampled over time along with the statistics.
+	[[nodiscard]] occupancy& filters() noexcept;
+	[[nodiscard]] const occupancy& filters() const noexcept;
+
+	// Report of the measurements of each file. Enabled independently from the statistics.
+	[[nodiscard]] file_report& files() noexcept;
+
+	// Add a sample to the accumulators of the calling thread.
+	void add(stage type, std::chrono::nanoseconds duration, std::size_t bytes);
+
+	// Add busy time to the live totals.
+	void add_busy(stage type, std::chrono::nanoseconds duration) noexcept;
+
+	// Add bytes read from an input file to the live totals.
+	void add_read(std::size_t bytes) noexcept;
+
+	// Add a written output file to the live totals. Blocks are only counted for block compressed formats.
+	void add_written(format::type format, std::size_t bytes, std::size_t blocks) noexcept;
+
+	// Current live totals. Can be called while the pipeline is running.
+	[[nodiscard]] live_totals totals() const noexcept;
+
+	// Table containing the samples, total time, mean, 50th, 95th and 99th percentiles, maximum and bytes processed of
+	// each stage which has been used. Must not be called while the pipeline is running.
+	[[nodiscard]] string summary() const;
+
+private:
+	struct accumulators {
+		std::array<histogram, stage_count> durations{};
+		std::array<std::uint64_t, stage_count> bytes{};
+	};
+
+	struct live_counters {
+		std::array<std::atomic<std::uint64_t>, stage_count> busy_nanoseconds{};
+		std::atomic<std::uint64_t> read_bytes{};
+		std::atomic<std::uint64_t> written_bytes{};
+		std::array<std::atomic<std::uint64_t>, block_format_count> blocks{};
+	};
+
+	bool _enabled;
+	bool _live;
+	live_counters _live_counters;
+	oneapi::tbb::enumerable_thread_specific<accumulators> _threads;
+	occupancy _occupancy;
+	file_report _files;
+};
+
+// Measures the duration of a scope, and adds it to the statistics, the live totals and the data of the file when the
+// scope ends. Does nothing when the statistics, the live totals and the file report are disabled.
+class stage_timer final {
+public:
+	stage_timer(stage_statistics& statistics, stage type, file_data& file) noexcept;
+	stage_timer(const stage_timer&) = delete;
+	stage_timer(stage_timer&&) = delete;
+	stage_timer& operator=(const stage_timer&) = delete;
+	stage_timer& operator=(stage_timer&&) = delete;
+	~stage_timer();
+
+	// Bytes produced or consumed by the stage.
+	void set_bytes(std::size_t bytes) noexcept;
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	stage_statistics& _statistics;
+	stage _type;
+	file_data& _file;
+	bool _measuring;
+	std::size_t _bytes{};
+	clock::time_point _start;
+};
+
+} // namespace todds::pipeline::impl
@@ -0,0 +1,274 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/pipeline.hpp"
+
+#include "todds/allocations.hpp"
+#include "todds/alpha_coverage.hpp"
+#include "todds/dds.hpp"
+#include "todds/image_error.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/png.hpp"
+#include "todds/resample.hpp"
+#include "todds/string.hpp"
+
+#include <boost/nowide/fstream.hpp>
+#include <fmt/format.h>
+#include <oneapi/tbb/global_control.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "file_report.hpp"
+
+namespace {
+
+using todds::format::quality;
+using todds::format::type;
+
+constexpr std::size_t quality_levels = static_cast<std::size_t>(quality::maximum) + 1UL;
+
+// Result of encoding every mipmap level of a file with a quality level.
+struct file_result {
+	double seconds{};
+	todds::image_error error{};
+};
+
+// Results of every swept file encoded with a format and a quality level. Files are weighted by their number of pixels.
+struct level_totals {
+	std::size_t files{};
+	double seconds{};
+	std::uint64_t pixels{};
+	double squared_error{};
+	std::uint64_t blocks{};
+	double ssim{};
+	double minimum_psnr{std::numeric_limits<double>::infinity()};
+
+	void add(const file_result& result, bool alpha) {
+		const todds::image_error& error = result.error;
+		++files;
+		seconds += result.seconds;
+		pixels += error.pixels;
+		squared_error += error.mse(alpha) * static_cast<double>(error.pixels);
+		blocks += error.blocks;
+		ssim += error.mean_ssim(alpha) * static_cast<double>(error.blocks);
+		minimum_psnr = std::min(minimum_psnr, todds::psnr(error.mse(alpha)));
+	}
+
+	[[nodiscard]] double psnr() const noexcept {
+		return todds::psnr(pixels > 0U ? squared_error / static_cast<double>(pixels) : 0.0);
+	}
+
+	[[nodiscard]] double mean_ssim() const noexcept { return blocks > 0U ? ssim / static_cast<double>(blocks) : 1.0; }
+};
+
+struct format_totals {
+	type format;
+	std::array<level_totals, quality_levels> levels{};
+};
+
+// Writes the result of each file and quality level, using the same formats as the file report.
+class sweep_report final {
+public:
+	explicit sweep_report(const boost::filesystem::path& path)
+		: _enabled{!path.empty()}
+		, _csv{path.extension() == ".csv"} {
+		if (!_enabled) { return; }
+		_output.open(path, std::ios::out);
+		if (_csv) { _output << "file,width,height,mipmaps,format,quality,encode_ms,mse,psnr,ssim\n"; }
+	}
+
+	[[nodiscard]] bool good() const { return !_enabled || _output.good(); }
+
+	void write(const todds::string& path, const todds::image& main, std::size_t mipmaps, type format,
+		std::size_t level, const file_result& result, bool alpha) {
+		if (!_enabled) { return; }
+		const double mse = result.error.mse(alpha);
+		const double psnr = todds::psnr(mse);
+		// JSON does not support infinite values.
+		const todds::string psnr_value =
+			std::isinf(psnr) ? todds::string{_csv ? "inf" : "null"} : todds::string{fmt::format("{:.3f}", psnr)};
+		const std::string_view format_name = todds::format::name(format);
+		const todds::string file = todds::pipeline::impl::quote(path, _csv);
+		if (_csv) {
+			_output << fmt::format("{:s},{:d},{:d},{:d},{:s},{:d},{:.3f},{:.4f},{:s},{:.5f}\n", file, main.width(),
+				main.height(), mipmaps, format_name, level, result.seconds * 1000.0, mse, psnr_value,
+				result.error.mean_ssim(alpha));
+		} else {
+			_output << fmt::format(
+				R"({{"file":{:s},"width":{:d},"height":{:d},"mipmaps":{:d},"format":"{:s}","quality":{:d},"encode_ms":{:.3f},)"
+				R"("mse":{:.4f},"psnr":{:s},"ssim":{:.5f}}})"
+				"\n",
+				file, main.width(), main.height(), mipmaps, format_name, level, result.seconds * 1000.0, mse, psnr_value,
+				result.error.mean_ssim(alpha));
+		}
+	}
+
+private:
+	bool _enabled;
+	bool _csv;
+	boost::nowide::ofstream _output;
+};
+
+// Reads a whole PNG file. Returns an empty buffer if the file could not be read.
+todds::vector<std::uint8_t> load(const boost::filesystem::path& path) {
+	boost::nowide::ifstream ifs{path, std::ios::in | std::ios::binary};
+	todds::vector<std::uint8_t> buffer;
+	ifs.seekg(0, std::ios::end);
+	const std::streamoff file_size = ifs.tellg();
+	if (!ifs.is_open() || file_size <= 0) { return buffer; }
+	ifs.seekg(0, std::ios::beg);
+	buffer.resize(static_cast<std::size_t>(file_size));
+	if (!ifs.read(reinterpret_cast<char*>(buffer.data()), file_size)) { buffer.clear(); }
+	return buffer;
+}
+
+// A level is Pareto optimal if no other level is both at least as fast and at least as accurate, and better in one.
+bool pareto_optimal(const format_totals& totals, std::size_t level) {
+	const level_totals& current = totals.levels[level];
+	return std::none_of(totals.levels.begin(), totals.levels.end(), [&current](const level_totals& other) {
+		return other.files > 0UL && other.seconds <= current.seconds && other.psnr() >= current.psnr() &&
+					 (other.seconds < current.seconds || other.psnr() > current.psnr());
+	});
+}
+
+todds::string summary(const todds::vector<format_totals>& formats, double target) {
+	todds::string result{fmt::format("{:<8s}{:>9s}{:>7s}{:>12s}{:>9s}{:>11s}{:>11s}{:>9s}{:>8s}", "Format", "Quality",
+		"Files", "Encode (s)", "MP/s", "PSNR (dB)", "Min (dB)", "SSIM", "Pareto")};
+	for (const auto& totals : formats) {
+		std::size_t recommended = quality_levels;
+		std::size_t best = quality_levels;
+		for (std::size_t level = 0UL; level < quality_levels; ++level) {
+			const level_totals& current = totals.levels[level];
+			if (current.files == 0UL) { continue; }
+			result += fmt::format("\n{:<8s}{:>9d}{:>7d}{:>12.3f}{:>9.2f}{:>11.2f}{:>11.2f}{:>9.5f}{:>8s}",
+				todds::format::name(totals.format), level, current.files, current.seconds,
+				current.seconds > 0.0 ? static_cast<double>(current.pixels) / 1.0e6 / current.seconds : 0.0,
+				current.psnr(), current.minimum_psnr, current.mean_ssim(), pareto_optimal(totals, level) ? "yes" : "no");
+			if (current.minimum_psnr >= target &&
+					(recommended == quality_levels || current.seconds < totals.levels[recommended].seconds)) {
+				recommended = level;
+			}
+			if (best == quality_levels || current.minimum_psnr > totals.levels[best].minimum_psnr) { best = level; }
+		}
+
+		if (best == quality_levels) { continue; }
+		if (recommended != quality_levels) {
+			result += fmt::format("\nRecommended {:s} quality: {:d}, the fastest level with every file at {:.2f} dB "
+				"or more.",
+				todds::format::name(totals.format), recommended, target);
+		} else {
+			result += fmt::format("\nNo {:s} quality level reaches {:.2f} dB in every file. Quality {:d} is the closest, "
+				"with {:.2f} dB in its worst file.",
+				todds::format::name(totals.format), target, best, totals.levels[best].minimum_psnr);
+		}
+	}
+	return result;
+}
+
+} // Anonymous namespace
+
+namespace todds::pipeline {
+
+void sweep(const input& input_data, std::atomic<bool>& force_finish, report_queue& updates) {
+	dds::initialize_encoding(input_data.format, input_data.alpha_format);
+	// Files are swept one by one, and each encoder uses every thread on each mipmap level. This keeps the encoding time
+	// of each file free from the work of other files.
+	const oneapi::tbb::global_control control(
+		oneapi::tbb::global_control::max_allowed_parallelism, input_data.parallelism);
+
+	const std::size_t levels_to_sweep = static_cast<std::size_t>(input_data.quality) + 1UL;
+	std::array<dds::bc7_params, quality_levels> bc7_params{};
+	for (std::size_t level = 0UL; level < levels_to_sweep; ++level) {
+		bc7_params[level] = dds::bc7_encode_params(static_cast<quality>(level));
+	}
+
+	todds::vector<format_totals> formats{{input_data.format}};
+	if (input_data.alpha_format != type::invalid && input_data.alpha_format != input_data.format) {
+		formats.push_back({input_data.alpha_format});
+	}
+	sweep_report report{input_data.report_file};
+	const bool report_opened = report.good();
+	if (!report_opened) {
+		updates.emplace(report_type::pipeline_error,
+			fmt::format("Could not open the file report {:s}", input_data.report_file.string()));
+	}
+
+	for (std::size_t file_index = 0UL; file_index < input_data.paths.size() && !force_finish; ++file_index) {
+		const string path{input_data.paths[file_index].first.string()};
+		const auto buffer = load(input_data.paths[file_index].first);
+		if (buffer.empty()) {
+			updates.emplace(report_type::pipeline_error, fmt::format("Could not load any data for PNG file {:s}", path));
+			updates.add(progress_type::failed_textures);
+			continue;
+		}
+
+		// Mipmap levels are generated once, and encoded with every quality level.
+		vector<std::unique_ptr<mipmap_image>> levels;
+		try {
+			std::size_t width{};
+			std::size_t height{};
+			levels.push_back(png::decode(file_index, path, buffer, input_data.vflip, input_data.fix_size, width, height,
+				false, pixel_layout::blocks));
+		} catch (const std::runtime_error& exc) {
+			updates.emplace(report_type::pipeline_error, fmt::format("PNG Decoding error {:s} -> {:s}", path, exc.what()));
+			updates.add(progress_type::failed_textures);
+			continue;
+		}
+		const image& main = levels.front()->get_image(0UL);
+		const std::size_t mipmaps = input_data.mipmaps ? mipmap_levels(main.width(), main.height()) : 1UL;
+		while (levels.size() < mipmaps) {
+			const image& source = levels.back()->get_image(0UL);
+			auto& next = levels.emplace_back(std::make_unique<mipmap_image>(file_index,
+				std::max(source.width() >> 1UL, 1UL), std::max(source.height() >> 1UL, 1UL), false, pixel_layout::blocks));
+			resample::resample(source, next->get_image(0UL), input_data.mipmap_filter, input_data.mipmap_blur);
+		}
+
+		const bool alpha = has_alpha(levels.front()->pixel_blocks());
+		auto& totals = alpha && formats.size() > 1UL ? formats.back() : formats.front();
+		vector<dds_image> encoded;
+		vector<vector<std::uint32_t>> decoded;
+		for (const auto& level : levels) {
+			const auto blocks = level->pixel_blocks();
+			encoded.emplace_back(dds::encoded_size(totals.format, blocks.size()),
+				pooled_allocator<std::uint64_t>(allocations::category::dds_output));
+			decoded.emplace_back(blocks.size());
+		}
+
+		for (std::size_t level = 0UL; level < levels_to_sweep && !force_finish; ++level) {
+			const auto level_quality = static_cast<quality>(level);
+			file_result result{};
+			for (std::size_t index = 0UL; index < levels.size(); ++index) {
+				const auto blocks = levels[index]->pixel_blocks();
+				const auto start = std::chrono::steady_clock::now();
+				switch (totals.format) {
+				case type::bc1: dds::bc1_encode(level_quality, input_data.alpha_black, blocks, encoded[index]); break;
+				case type::bc3: dds::bc3_encode(level_quality, blocks, encoded[index]); break;
+				case type::bc7: dds::bc7_encode(bc7_params[level], blocks, encoded[index]); break;
+				case type::png:
+				case type::invalid: break;
+				}
+				result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				dds::decode(totals.format, encoded[index], decoded[index]);
+				result.error += compare(levels[index]->get_image(0UL), decoded[index]);
+			}
+			totals.levels[level].add(result, alpha);
+			report.write(path, main, levels.size(), totals.format, level, result, alpha);
+		}
+		updates.add(progress_type::encoded_textures);
+	}
+
+	updates.emplace(report_type::sweep_results, summary(formats, input_data.sweep_target));
+	if (report_opened && !report.good()) {
+		updates.emplace(report_type::pipeline_error,
+			fmt::format("Could not write the file report {:s}", input_data.report_file.string()));
+	}
+}
+
+} // namespace todds::pipeline
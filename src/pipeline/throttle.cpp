@@ -0,0 +1,145 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "throttle.hpp"
+
+#include <boost/predef.h>
+#include <oneapi/tbb/info.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+#if BOOST_OS_WINDOWS
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#if BOOST_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr double percent = 100.0;
+
+#if BOOST_OS_LINUX
+constexpr int ioprio_who_process = 1;
+constexpr int ioprio_class_idle = 3;
+constexpr int ioprio_class_shift = 13;
+#endif
+
+// CPU time used by every thread of the process, in seconds.
+double process_cpu_seconds() noexcept {
+#if BOOST_OS_WINDOWS
+	FILETIME creation{};
+	FILETIME exit{};
+	FILETIME kernel{};
+	FILETIME user{};
+	if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user) == 0) { return 0.0; }
+	const auto to_ticks = [](const FILETIME& time) {
+		return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32U) | time.dwLowDateTime;
+	};
+	// FILETIME is measured in intervals of 100 nanoseconds.
+	return static_cast<double>(to_ticks(kernel) + to_ticks(user)) / 1.0e7;
+#else
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0.0; }
+	const auto to_seconds = [](const timeval& time) {
+		return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1.0e6;
+	};
+	return to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+#endif
+}
+
+// CPUs available to the process. A cgroup quota may be larger than the CPUs of the system.
+double available_cpus(std::size_t cpus) noexcept {
+	const auto system_cpus = static_cast<std::size_t>(oneapi::tbb::info::default_concurrency());
+	return static_cast<double>(cpus > 0UL ? std::min(cpus, system_cpus) : system_cpus);
+}
+
+} // Anonymous namespace
+
+namespace todds::pipeline::impl {
+
+thread_priority lower_thread_priority() noexcept {
+	// Failures are ignored, as the thread can keep working with its current priority.
+	thread_priority previous{};
+#if BOOST_OS_WINDOWS
+	// Lowers both the CPU and the I/O priority of the thread.
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif BOOST_OS_LINUX
+	sched_param parameters{};
+	if (pthread_getschedparam(pthread_self(), &previous.policy, &parameters) == 0) {
+		previous.cpu = parameters.sched_priority;
+	} else {
+		previous.policy = SCHED_OTHER;
+	}
+	parameters.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &parameters);
+	// Linux does not provide wrappers for ioprio_get and ioprio_set. A process identifier of zero refers to the calling
+	// thread.
+	previous.io = static_cast<int>(syscall(SYS_ioprio_get, ioprio_who_process, 0));
+	syscall(SYS_ioprio_set, ioprio_who_process, 0, ioprio_class_idle << ioprio_class_shift);
+#elif BOOST_OS_MACOS
+	previous.cpu = getpriority(PRIO_DARWIN_THREAD, 0);
+	setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG);
+#else
+	previous.cpu = getpriority(PRIO_PROCESS, 0);
+	setpriority(PRIO_PROCESS, 0, PRIO_MAX);
+#endif
+	return previous;
+}
+
+void restore_thread_priority([[maybe_unused]] const thread_priority& previous) noexcept {
+#if BOOST_OS_WINDOWS
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+#elif BOOST_OS_LINUX
+	sched_param parameters{};
+	parameters.sched_priority = previous.cpu;
+	pthread_setschedparam(pthread_self(), previous.policy, &parameters);
+	if (previous.io >= 0) { syscall(SYS_ioprio_set, ioprio_who_process, 0, previous.io); }
+#elif BOOST_OS_MACOS
+	setpriority(PRIO_DARWIN_THREAD, 0, previous.cpu);
+#else
+	setpriority(PRIO_PROCESS, 0, previous.cpu);
+#endif
+}
+
+throttle::throttle(std::size_t cpu_limit, std::size_t io_limit, std::size_t cpus)
+	: _cpu_seconds_per_second{static_cast<double>(cpu_limit) / percent * available_cpus(cpus)}
+	, _io_limit{static_cast<double>(io_limit)}
+	, _start{clock::now()}
+	, _start_cpu_seconds{process_cpu_seconds()}
+	, _io_next{_start} {}
+
+void throttle::admit_file() const {
+	if (_cpu_seconds_per_second <= 0.0) { return; }
+	const double cpu_seconds = process_cpu_seconds() - _start_cpu_seconds;
+	const std::chrono::duration<double> elapsed = clock::now() - _start;
+	// Time at which the CPU usage since the start would be equal to the limit.
+	const double wait = cpu_seconds / _cpu_seconds_per_second - elapsed.count();
+	if (wait > 0.0) { std::this_thread::sleep_for(std::chrono::duration<double>(wait)); }
+}
+
+void throttle::transfer(std::size_t bytes) {
+	if (_io_limit <= 0.0) { return; }
+	const auto duration =
+		std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(static_cast<double>(bytes) / _io_limit));
+	clock::time_point start;
+	{
+		// Each transfer reserves a slot of time after the previous ones. Unused time is not accumulated.
+		const std::lock_guard lock{_io_mutex};
+		start = std::max(_io_next, clock::now());
+		_io_next = start + duration;
+	}
+	std::this_thread::sleep_until(start);
+}
+
+} // namespace todds::pipeline::impl
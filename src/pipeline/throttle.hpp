@@ -0,0 +1,58 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace todds::pipeline::impl {
+
+// CPU and I/O priority of a thread, saved before lowering it.
+struct thread_priority {
+	int policy{};
+	int cpu{};
+	int io{};
+};
+
+// Lowers the CPU and I/O priority of the calling thread, so it only runs when other programs do not need the resources.
+// Returns the previous priority of the thread.
+[[nodiscard]] thread_priority lower_thread_priority() noexcept;
+
+// Restores a priority of the calling thread returned by lower_thread_priority. Linux only allows leaving SCHED_IDLE to
+// processes with CAP_SYS_NICE or a high enough RLIMIT_NICE. Otherwise, only the I/O priority is restored.
+void restore_thread_priority(const thread_priority& previous) noexcept;
+
+// Limits the resources used by the pipeline, so other programs running at the same time keep being responsive.
+// Threads are put to sleep when they exceed a limit, so throughput degrades gracefully.
+class throttle final {
+public:
+	// cpu_limit is a percentage of the CPUs available to the process, and io_limit is measured in bytes per second. Zero
+	// disables the limit. cpus is the number of CPUs allowed by the control groups of the process, or zero to use every
+	// CPU of the system.
+	throttle(std::size_t cpu_limit, std::size_t io_limit, std::size_t cpus);
+
+	// Called before the pipeline starts processing a new file. Waits until the CPU usage of the process since the
+	// pipeline started is within the limit.
+	void admit_file() const;
+
+	// Called before reading or writing a number of bytes. Waits until the transfer fits within the I/O limit.
+	void transfer(std::size_t bytes);
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	// CPU time available to the pipeline for each second of wall time.
+	double _cpu_seconds_per_second;
+	double _io_limit;
+	clock::time_point _start;
+	double _start_cpu_seconds;
+	std::mutex _io_mutex;
+	// End of the time reserved by previous transfers.
+	clock::time_point _io_next;
+};
+
+} // namespace todds::pipeline::impl
@@ -10,26 +10,58 @@
 #include "todds/string.hpp"
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <span>
 
 namespace todds::png {
 
+/**
+ * Information stored in the header of a PNG file.
+ */
+struct header {
+	std::size_t width{};
+	std::size_t height{};
+	/** Interlaced files cannot be decoded row by row. */
+	bool interlaced{};
+};
+
+/** Receives the RGBA data of a decoded row. The span is only valid during the call. */
+using row_callback = std::function<void(std::span<const std::uint8_t> row)>;
+
 /**
  * Decodes a PNG file stored in memory.
  * @param file_index File index of the image in the list of files to load.
  * @param png Path to the PNG file, used for reporting errors.
  * @param buffer Memory data holding a PNG file read from the filesystem.
  * @param flip Flip source image vertically during decoding.
+ * @param fix_size Increase width and height to the next multiple of 4. Extra pixels are left transparent black.
  * @param width Width of the image.
  * @param height Height of the image.
  * @param mipmaps True if mipmaps should be calculated.
- * @return Decoded PNG image loaded in memory in an RGBA memory layout. Width and height are increased if needed to
- * make their number of pixels divisible by 4. If mipmaps is true, memory for mipmaps is allocated but only the first
- * image is loaded in memory.
+ * @param layout Memory layout of the decoded image. Padding is filled during decoding.
+ * @return Decoded PNG image loaded in memory in an RGBA memory layout. If mipmaps is true, memory for mipmaps is
+ * allocated but only the first image is loaded in memory.
  */
 std::unique_ptr<mipmap_image> decode(std::size_t file_index, const string& png, std::span<const std::uint8_t> buffer,
-	bool flip, std::size_t& width, std::size_t& height, bool mipmaps);
+	bool flip, bool fix_size, std::size_t& width, std::size_t& height, bool mipmaps, pixel_layout layout);
+
+/**
+ * Reads the header of a PNG file stored in memory without decoding any pixels.
+ * @param png Path to the PNG file, used for reporting errors.
+ * @param buffer Memory data holding a PNG file read from the filesystem.
+ * @return Header information.
+ */
+header read_header(const string& png, std::span<const std::uint8_t> buffer);
+
+/**
+ * Decodes a non-interlaced PNG file stored in memory one row at a time, from top to bottom.
+ * Only a single row of the image is kept in memory.
+ * @param png Path to the PNG file, used for reporting errors.
+ * @param buffer Memory data holding a PNG file read from the filesystem.
+ * @param callback Called once for each decoded row.
+ */
+void decode_rows(const string& png, std::span<const std::uint8_t> buffer, const row_callback& callback);
 
 vector<std::uint8_t> encode(const string& png, std::unique_ptr<mipmap_image> input);
 
@@ -6,10 +6,12 @@
 #include "todds/png.hpp"
 
 #include "todds/string.hpp"
+#include "todds/util.hpp"
 
 #include "spng.h"
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 #include <stdexcept>
@@ -58,12 +60,30 @@ spng_ihdr get_header(spng_context& context, const todds::string& png) {
 	return header;
 }
 
+void start_progressive_decode(spng_context& context, const todds::string& png) {
+	constexpr int flags = SPNG_DECODE_TRNS | SPNG_DECODE_PROGRESSIVE;
+	if (const int ret = spng_decode_image(context.get(), nullptr, 0, SPNG_FMT_RGBA8, flags); ret != 0) {
+		throw std::runtime_error{fmt::format("Could not initialize decoding of {:s}: {:s}", png, spng_strerror(ret))};
+	}
+}
+
+void check_progressive_decode(int ret, const todds::string& png) {
+	// Since SPNG_CTX_IGNORE_ADLER32 is not supported for miniz, the SPNG_EIDAT_STREAM raised in this case is ignored.
+	if (ret != SPNG_EOI && ret != SPNG_EIDAT_STREAM) {
+		throw std::runtime_error{fmt::format("Progressive decode error in {:s}: {:s}", png, spng_strerror(ret))};
+	}
+}
+
+// With miniz, the last row is returned along with SPNG_EIDAT_STREAM, as explained in check_progressive_decode.
+bool row_decoded(int ret) { return ret == 0 || ret == SPNG_EOI || ret == SPNG_EIDAT_STREAM; }
+
 } // anonymous namespace
 
 namespace todds::png {
 
 std::unique_ptr<mipmap_image> decode(std::size_t file_index, const todds::string& png,
-	std::span<const std::uint8_t> buffer, bool flip, std::size_t& width, std::size_t& height, bool mipmaps) {
+	std::span<const std::uint8_t> buffer, bool flip, bool fix_size, std::size_t& width, std::size_t& height, bool mipmaps,
+	pixel_layout layout) {
 	width = 0ULL;
 	height = 0ULL;
 	// Ideally we would want to use SPNG_CTX_IGNORE_ADLER32 here, but unfortunately libspng ignores this value when using
@@ -73,9 +93,9 @@ std::unique_ptr<mipmap_image> decode(std::size_t file_index, const todds::string
 	set_buffer(context, png, buffer);
 	const spng_ihdr header = get_header(context, png);
 
-	width = header.width;
-	height = header.height;
-	auto result = std::make_unique<mipmap_image>(file_index, width, height, mipmaps);
+	width = fix_size ? util::next_divisible_by_4(header.width) : header.width;
+	height = fix_size ? util::next_divisible_by_4(header.height) : header.height;
+	auto result = std::make_unique<mipmap_image>(file_index, width, height, mipmaps, layout);
 	assert(result->mipmap_count() >= 1ULL);
 	image& first = result->get_image(0ULL);
 
@@ -86,37 +106,82 @@ std::unique_ptr<mipmap_image> decode(std::size_t file_index, const todds::string
 		throw std::runtime_error{fmt::format("Could not calculate decoded size of {:s}: {:s}", png, spng_strerror(ret))};
 	}
 
-	// The todds data may be larger than the file size because the width and the height must be divisible by 4.
+	// The todds data may be larger than the file size because of padding.
 	assert(file_size <= first.data().size());
 
-	if (const int ret = spng_decode_image(context.get(), nullptr, 0, format, SPNG_DECODE_TRNS | SPNG_DECODE_PROGRESSIVE);
-			ret != 0) {
-		throw std::runtime_error{fmt::format("Could not initialize decoding of {:s}: {:s}", png, spng_strerror(ret))};
-	}
+	start_progressive_decode(context, png);
 
 	int ret{};
 	spng_row_info row_info{};
-	const auto file_width = file_size / height;
+	const auto file_width = file_size / header.height;
+	const auto row_size = width * image::bytes_per_pixel;
+	const bool interlaced = header.interlace_method != SPNG_INTERLACE_NONE;
+	// Image memory is not initialized, so extra columns and rows added by fix_size are explicitly made transparent black.
+	// Rows are decoded directly into the image when possible.
+	pooled_vector<std::uint8_t> row_buffer(layout == pixel_layout::rows ? 0UL : row_size, std::uint8_t{},
+		pooled_allocator<std::uint8_t>(allocations::category::pixel_blocks));
 
 	do {
 		ret = spng_get_row_info(context.get(), &row_info);
 		if (ret != 0) { break; }
-		const std::size_t row = !flip ? row_info.row_num : height - row_info.row_num - 1UL;
-		ret = spng_decode_row(context.get(), &first.row_start(row), file_width);
-
+		const std::size_t row = !flip ? row_info.row_num : header.height - row_info.row_num - 1UL;
+		if (row_buffer.empty()) {
+			std::uint8_t* row_start = &first.row_start(row);
+			ret = spng_decode_row(context.get(), row_start, file_width);
+			std::fill(row_start + file_width, row_start + row_size, std::uint8_t{});
+		} else {
+			// Each pass of an interlaced image only decodes some of the pixels of a row.
+			if (interlaced) {
+				first.read_row(row, row_buffer);
+				std::fill(row_buffer.begin() + static_cast<std::ptrdiff_t>(file_width), row_buffer.end(), std::uint8_t{});
+			}
+			ret = spng_decode_row(context.get(), row_buffer.data(), file_width);
+			if (row_decoded(ret)) { first.write_row(row, row_buffer); }
+		}
 	} while (ret == 0);
 
-	// Since SPNG_CTX_IGNORE_ADLER32 is not supported for miniz, the SPNG_EIDAT_STREAM raised in this case is ignored.
-	if (ret != SPNG_EOI && ret != SPNG_EIDAT_STREAM) {
-		throw std::runtime_error{fmt::format("Progressive decode error in {:s}: {:s}", png, spng_strerror(ret))};
+	check_progressive_decode(ret, png);
+
+	if (height > header.height) {
+		const vector<std::uint8_t> empty_row(row_size);
+		for (std::size_t row = header.height; row < height; ++row) { first.write_row(row, empty_row); }
 	}
 	return result;
 }
 
+header read_header(const string& png, std::span<const std::uint8_t> buffer) {
+	spng_context context{png, 0};
+	set_buffer(context, png, buffer);
+	const spng_ihdr ihdr = get_header(context, png);
+	return {ihdr.width, ihdr.height, ihdr.interlace_method != SPNG_INTERLACE_NONE};
+}
+
+void decode_rows(const string& png, std::span<const std::uint8_t> buffer, const row_callback& callback) {
+	spng_context context{png, 0};
+	set_buffer(context, png, buffer);
+	const spng_ihdr ihdr = get_header(context, png);
+	if (ihdr.interlace_method != SPNG_INTERLACE_NONE) {
+		throw std::runtime_error{fmt::format("Interlaced PNG files cannot be decoded row by row: {:s}", png)};
+	}
+
+	vector<std::uint8_t> row(static_cast<std::size_t>(ihdr.width) * image::bytes_per_pixel);
+	start_progressive_decode(context, png);
+
+	int ret{};
+	do {
+		// libspng returns SPNG_EOI after decoding the last row.
+		ret = spng_decode_row(context.get(), row.data(), row.size());
+		if (row_decoded(ret)) { callback(row); }
+	} while (ret == 0);
+
+	check_progressive_decode(ret, png);
+}
+
 vector<std::uint8_t> encode(const string& png, std::unique_ptr<mipmap_image> input) {
 	if (input == nullptr) [[unlikely]] { return {}; }
 
 	const image& input_image = input->get_image(0U);
+	assert(input_image.layout() == pixel_layout::rows);
 
 	spng_context context{png, SPNG_CTX_ENCODER};
 	spng_set_option(context.get(), SPNG_ENCODE_TO_BUFFER, 1);
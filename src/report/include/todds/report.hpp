@@ -9,30 +9,52 @@
 
 #include <oneapi/tbb/concurrent_queue.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string_view>
+#include <utility>
+
 namespace todds {
 
 enum class report_type {
 	/// todds has started retrieving all files to be encoded.
 	retrieving_files_started,
-	/// Retrieving files progress report.
-	retrieving_files_progress,
 	/// todds has finished retrieving all files. Contains the total time of this process.
 	file_retrieval_time,
 	/// File to process. Only enabled if the user specified verbose.
 	file_verbose,
 	/// The requested textures are being processed. This event is sent for both cleaning and encoding.
 	process_started,
-	/// Encoding progress report. Contains the number of textures encoded.
-	encoding_progress,
 	/// A non-critical error to be reported back to the user. Contains a text description of the error.
 	pipeline_error,
+	/// Memory usage of the pipeline after finishing. Contains a text description. Only displayed if the user specified
+	/// verbose.
+	memory_statistics,
+	/// Threads, files and throughput of each NUMA node after finishing. Contains a text description. Only sent on systems
+	/// with more than one NUMA node, and only displayed if the user specified verbose.
+	numa_statistics,
+	/// Resource limits of the process, and pipeline settings derived from them. Contains a text description. Only
+	/// displayed if the user specified verbose.
+	resource_limits,
+	/// Timing and bytes processed by each stage of the pipeline. Contains a table as text. Only sent if the user
+	/// specified stats.
+	stage_statistics,
+	/// Hardware performance counters of each profiler zone. Contains a table as text. Only sent if the user specified
+	/// perf-counters and the counters are available.
+	performance_counters,
+	/// Encoding time and error of each quality level, and the recommended level. Contains a table as text. Only sent if
+	/// the user specified sweep.
+	sweep_results,
 };
 
 class report final {
 public:
 	report() = default;
 	explicit report(report_type type);
-	report(report_type type, todds::string data);
+	report(report_type type, std::string_view data);
 	report(report_type type, std::size_t value);
 	report(const report&) = delete;
 	report(report&&) noexcept = default;
@@ -50,6 +72,76 @@ private:
 	std::size_t _value{};
 };
 
-using report_queue = oneapi::tbb::concurrent_queue<report>;
+/// Counters updated by worker threads. They are read by the user interface instead of being sent as reports.
+enum class progress_type {
+	/// Number of directory entries visited while retrieving files.
+	retrieved_entries,
+	/// Number of textures encoded.
+	encoded_textures,
+	/// Number of textures which could not be encoded because of an error.
+	failed_textures,
+};
+
+/// Sends reports from the pipeline to the user interface. Messages are queued, and wake up the thread waiting for them.
+/// Progress is aggregated in counters which never allocate memory or wake up the user interface.
+class report_queue final {
+public:
+	report_queue() = default;
+	report_queue(const report_queue&) = delete;
+	report_queue(report_queue&&) = delete;
+	report_queue& operator=(const report_queue&) = delete;
+	report_queue& operator=(report_queue&&) = delete;
+	~report_queue() = default;
+
+	/// Queue a new report and wake up the thread waiting for reports.
+	template <typename... Args> void emplace(Args&&... args) {
+		_queue.emplace(std::forward<Args>(args)...);
+		notify();
+	}
+
+	/// Take the oldest report from the queue. Returns false if the queue is empty.
+	bool try_pop(report& update);
+
+	[[nodiscard]] bool empty() const;
+
+	/// Increase a progress counter. The counter is stored in a slot owned by the calling thread.
+	void add(progress_type type, std::size_t amount = 1UL) noexcept;
+
+	/// Current value of a progress counter. Additions from other threads may not be visible immediately.
+	[[nodiscard]] std::size_t progress(progress_type type) const noexcept;
+
+	/// Wait until a report is queued or the reports have finished.
+	/// @return False if the reports have finished. Reports queued before finishing may still need to be processed.
+	bool wait();
+
+	/// Wait until a report is queued, the reports have finished, or the timeout expires.
+	/// @return False if the reports have finished. Reports queued before finishing may still need to be processed.
+	bool wait_for(std::chrono::milliseconds timeout);
+
+	/// Signal that no more reports will be sent, and wake up the thread waiting for reports.
+	void finish();
+
+private:
+	static constexpr std::size_t progress_types = 3UL;
+	static constexpr std::size_t slot_count = 64UL;
+	static constexpr std::size_t cache_line_size = 64UL;
+
+	/// Threads use their own cache line, so counting progress does not cause false sharing. Threads share slots only
+	/// when there are more threads than slots.
+	struct alignas(cache_line_size) slot {
+		std::array<std::atomic<std::size_t>, progress_types> counters{};
+	};
+
+	[[nodiscard]] static std::size_t thread_slot() noexcept;
+	[[nodiscard]] bool ready() const;
+	void notify();
+
+	std::array<slot, slot_count> _slots{};
+	oneapi::tbb::concurrent_queue<report> _queue;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	/// Protected by _mutex.
+	bool _finished{};
+};
 
 } // namespace todds
@@ -11,9 +11,9 @@ report::report(report_type type)
 	, _data{}
 	, _value{} {}
 
-report::report(report_type type, todds::string data)
+report::report(report_type type, std::string_view data)
 	: _type{type}
-	, _data{std::move(data)}
+	, _data{data}
 	, _value{} {}
 
 report::report(report_type type, std::size_t value)
@@ -27,4 +27,54 @@ const todds::string& report::data() const { return _data; }
 
 std::size_t report::value() const { return _value; }
 
+bool report_queue::try_pop(report& update) { return _queue.try_pop(update); }
+
+bool report_queue::empty() const { return _queue.empty(); }
+
+void report_queue::add(progress_type type, std::size_t amount) noexcept {
+	_slots[thread_slot()].counters[static_cast<std::size_t>(type)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+std::size_t report_queue::progress(progress_type type) const noexcept {
+	std::size_t total{};
+	for (const auto& current : _slots) {
+		total += current.counters[static_cast<std::size_t>(type)].load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+bool report_queue::wait() {
+	std::unique_lock lock{_mutex};
+	_condition.wait(lock, [this] { return ready(); });
+	return !_finished;
+}
+
+bool report_queue::wait_for(std::chrono::milliseconds timeout) {
+	std::unique_lock lock{_mutex};
+	_condition.wait_for(lock, timeout, [this] { return ready(); });
+	return !_finished;
+}
+
+void report_queue::finish() {
+	{
+		const std::lock_guard lock{_mutex};
+		_finished = true;
+	}
+	_condition.notify_all();
+}
+
+std::size_t report_queue::thread_slot() noexcept {
+	static std::atomic<std::size_t> next_slot{};
+	thread_local const std::size_t slot = next_slot.fetch_add(1UL, std::memory_order_relaxed) % slot_count;
+	return slot;
+}
+
+bool report_queue::ready() const { return _finished || !_queue.empty(); }
+
+void report_queue::notify() {
+	// Taking the lock ensures that a waiting thread is either blocked or will see the new report in ready().
+	{ const std::lock_guard lock{_mutex}; }
+	_condition.notify_all();
+}
+
 } // namespace todds
@@ -89,7 +89,7 @@ public:
 		, _substring{PATH_STRING_WIDEN(substring)}
 		, _regex{regex}
 		, _depth{depth}
-		, _files{} {}
+		, _files(todds::allocator<paths_vector::value_type>(todds::allocations::category::paths)) {}
 
 	paths_vector get_result() {
 		process_user_input();
@@ -139,7 +139,7 @@ private:
 				}
 			}
 
-			_updates.emplace(todds::report_type::retrieving_files_progress);
+			_updates.add(todds::progress_type::retrieved_entries);
 
 			try {
 				const fs::path& current_path = itr->path();
@@ -194,7 +194,7 @@ private:
 
 file_retrieval_state from_args(const todds::args::data& args, todds::report_queue& updates) {
 	const bool has_output = args.output.has_value();
-	const bool create_folders = has_output && !args.dry_run && !args.clean;
+	const bool create_folders = has_output && !args.dry_run && !args.clean && !args.sweep;
 
 	if (!args.input.empty() && has_extension(args.input[0], txt_extension)) {
 		if (args.input.size() > 1U) {
@@ -207,7 +207,7 @@ file_retrieval_state from_args(const todds::args::data& args, todds::report_queu
 		todds::vector<boost::filesystem::path> input{};
 		boost::nowide::fstream stream{args.input[0]};
 		todds::string buffer;
-		while (std::getline(stream, buffer)) { input.push_back(fs::canonical(fs::path{buffer})); }
+		while (std::getline(stream, buffer)) { input.push_back(fs::canonical(fs::path{buffer.c_str()})); }
 		return {updates, input, std::optional<boost::filesystem::path>{}, args.format, create_folders, args.overwrite,
 			args.overwrite_new, args.substring, args.regex, args.depth};
 	}
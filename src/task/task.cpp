@@ -4,6 +4,7 @@
  */
 #include "todds/task.hpp"
 
+#include "todds/allocations.hpp"
 #include "todds/file_retrieval.hpp"
 #include "todds/input.hpp"
 #include "todds/pipeline.hpp"
@@ -21,13 +22,39 @@ void verbose_output(const paths_vector& files, bool clean, todds::report_queue&
 	}
 }
 
+// Signals the end of the reports when the task finishes, even if it has been terminated by an exception.
+class finish_reports final {
+public:
+	explicit finish_reports(todds::report_queue& updates)
+		: _updates{updates} {}
+	finish_reports(const finish_reports&) = delete;
+	finish_reports(finish_reports&&) = delete;
+	finish_reports& operator=(const finish_reports&) = delete;
+	finish_reports& operator=(finish_reports&&) = delete;
+	~finish_reports() { _updates.finish(); }
+
+private:
+	todds::report_queue& _updates;
+};
+
 void clean_dds_files(const paths_vector& files) {
 	for (const auto& [_, dds_file] : files) { fs::remove(dds_file); }
 }
 
+// Keeps the given percentage of the files, spread evenly over the whole list.
+paths_vector sample_paths(const paths_vector& files, std::size_t percentage) {
+	paths_vector result(files.get_allocator());
+	for (std::size_t index = 0UL; index < files.size(); ++index) {
+		if ((index * percentage) % 100UL < percentage) { result.push_back(files[index]); }
+	}
+	return result;
+}
+
 void pipeline_execution(
 	const todds::args::data& arguments, std::atomic<bool>& force_finish, todds::report_queue& updates) {
 	todds::pipeline::input input_data;
+	// Allocations are recorded before retrieving files, so the memory used by their paths is included.
+	if (arguments.stats) { todds::allocations::enable(); }
 	updates.emplace(todds::report_type::retrieving_files_started);
 
 	const auto start_time = oneapi::tbb::tick_count::now();
@@ -42,6 +69,9 @@ void pipeline_execution(
 	if (input_data.paths.size() > 1U) { input_data.paths = paths_vector{input_data.paths[0]}; }
 #endif // defined(TODDS_PIPELINE_DUMP)
 	// Process arguments that affect the input.
+	if (arguments.sweep && arguments.sweep_sample < 100U) {
+		input_data.paths = sample_paths(input_data.paths, arguments.sweep_sample);
+	}
 	if (arguments.verbose) { verbose_output(input_data.paths, arguments.clean, updates); }
 	if (arguments.dry_run) { return; }
 	updates.emplace(todds::report_type::process_started, input_data.paths.size());
@@ -67,6 +97,27 @@ void pipeline_execution(
 	input_data.progress = arguments.progress;
 	input_data.alpha_black = arguments.alpha_black;
 	input_data.report = arguments.report;
+	input_data.stream_threshold = arguments.stream_threshold;
+	input_data.huge_pages = arguments.huge_pages;
+	input_data.background = arguments.background;
+	input_data.cpu_limit = arguments.cpu_limit;
+	input_data.io_limit = arguments.io_limit;
+	input_data.stats = arguments.stats;
+	input_data.stats_timeline = arguments.stats_timeline.c_str();
+	input_data.trace = arguments.trace.c_str();
+	input_data.perf_counters = arguments.perf_counters;
+	input_data.report_file = arguments.report_file.c_str();
+	input_data.error_metrics = arguments.error_metrics;
+	input_data.metrics_file = arguments.metrics_file.c_str();
+	input_data.metrics_interval = arguments.metrics_interval;
+	input_data.capture_file = arguments.capture_file.c_str();
+	input_data.sweep_target = arguments.sweep_target;
+	input_data.limits = arguments.limits;
+
+	if (arguments.sweep) {
+		todds::pipeline::sweep(input_data, force_finish, updates);
+		return;
+	}
 
 	// Launch the parallel pipeline.
 	todds::pipeline::encode_as_dds(input_data, force_finish, updates);
@@ -77,8 +128,10 @@ void pipeline_execution(
 namespace todds {
 
 std::future<void> run(const args::data& arguments, std::atomic<bool>& force_finish, report_queue& updates) {
-	return std::async(std::launch::async,
-		[&arguments, &force_finish, &updates]() { pipeline_execution(arguments, force_finish, updates); });
+	return std::async(std::launch::async, [&arguments, &force_finish, &updates]() {
+		const finish_reports finish{updates};
+		pipeline_execution(arguments, force_finish, updates);
+	});
 }
 
 } // namespace todds
@@ -0,0 +1,143 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "todds/allocations.hpp"
+
+#include "todds/thread_registry.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+using todds::allocations::category;
+using todds::allocations::category_count;
+
+// Only written by its own thread. Relaxed atomics allow reading the counters while the thread is still running.
+struct thread_counters {
+	std::array<std::atomic<std::size_t>, category_count> allocations{};
+	std::array<std::atomic<std::size_t>, category_count> allocated_bytes{};
+};
+
+todds::thread_registry<thread_counters>& get_registry() {
+	static todds::thread_registry<thread_counters> instance;
+	return instance;
+}
+
+// Live bytes may be negative while accounting, as buffers allocated before enabling it can be released afterwards.
+struct live_counter {
+	std::atomic<std::int64_t> live{};
+	std::atomic<std::int64_t> peak{};
+
+	void add(std::int64_t bytes) noexcept {
+		const std::int64_t current = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+		std::int64_t previous = peak.load(std::memory_order_relaxed);
+		while (current > previous && !peak.compare_exchange_weak(previous, current, std::memory_order_relaxed)) {}
+	}
+
+	void reset() noexcept {
+		live.store(0, std::memory_order_relaxed);
+		peak.store(0, std::memory_order_relaxed);
+	}
+};
+
+std::array<live_counter, category_count> live_categories{};
+live_counter live_total{};
+
+std::atomic<bool> accounting{};
+
+void increment(std::atomic<std::size_t>& counter, std::size_t amount) noexcept {
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+std::size_t to_size(std::int64_t value) noexcept { return static_cast<std::size_t>(std::max<std::int64_t>(value, 0)); }
+
+double to_mebibytes(std::size_t bytes) noexcept { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+} // Anonymous namespace
+
+namespace todds::allocations {
+
+const char* name(category value) noexcept {
+	switch (value) {
+	case category::png_buffers: return "png";
+	case category::mipmap_images: return "mipmap";
+	case category::blur_scratch: return "blur";
+	case category::pixel_blocks: return "blocks";
+	case category::dds_output: return "dds";
+	case category::paths: return "paths";
+	case category::other: break;
+	}
+	return "other";
+}
+
+void enable() noexcept {
+	get_registry().reset([] {
+		for (auto& counter : live_categories) { counter.reset(); }
+		live_total.reset();
+	});
+	accounting.store(true, std::memory_order_release);
+}
+
+void disable() noexcept { accounting.store(false, std::memory_order_release); }
+
+bool enabled() noexcept { return accounting.load(std::memory_order_relaxed); }
+
+void allocated(category type, std::size_t bytes) noexcept {
+	if (!enabled()) { return; }
+	const auto index = static_cast<std::size_t>(type);
+	auto& thread = get_registry().local();
+	increment(thread.allocations[index], 1UL);
+	increment(thread.allocated_bytes[index], bytes);
+	live_categories[index].add(static_cast<std::int64_t>(bytes));
+	live_total.add(static_cast<std::int64_t>(bytes));
+}
+
+void deallocated(category type, std::size_t bytes) noexcept {
+	if (!enabled()) { return; }
+	live_categories[static_cast<std::size_t>(type)].add(-static_cast<std::int64_t>(bytes));
+	live_total.add(-static_cast<std::int64_t>(bytes));
+}
+
+statistics get_statistics() {
+	statistics result{};
+	get_registry().for_each([&result](const thread_counters& thread) {
+		for (std::size_t index = 0UL; index < category_count; ++index) {
+			result.categories[index].allocations += thread.allocations[index].load(std::memory_order_relaxed);
+			result.categories[index].allocated_bytes += thread.allocated_bytes[index].load(std::memory_order_relaxed);
+		}
+	});
+
+	for (std::size_t index = 0UL; index < category_count; ++index) {
+		auto& current = result.categories[index];
+		current.live_bytes = to_size(live_categories[index].live.load(std::memory_order_relaxed));
+		current.peak_bytes = to_size(live_categories[index].peak.load(std::memory_order_relaxed));
+		result.total.allocations += current.allocations;
+		result.total.allocated_bytes += current.allocated_bytes;
+	}
+	result.total.live_bytes = to_size(live_total.live.load(std::memory_order_relaxed));
+	result.total.peak_bytes = to_size(live_total.peak.load(std::memory_order_relaxed));
+	return result;
+}
+
+string summary() {
+	const statistics usage_statistics = get_statistics();
+	string result{fmt::format(
+		"{:<10s}{:>12s}{:>16s}{:>12s}{:>12s}", "Memory", "Allocations", "Allocated MiB", "Live MiB", "Peak MiB")};
+	const auto add_row = [&result](const char* row_name, const usage& current) {
+		result += fmt::format("\n{:<10s}{:>12d}{:>16.1f}{:>12.1f}{:>12.1f}", row_name, current.allocations,
+			to_mebibytes(current.allocated_bytes), to_mebibytes(current.live_bytes), to_mebibytes(current.peak_bytes));
+	};
+	for (std::size_t index = 0UL; index < category_count; ++index) {
+		const usage& current = usage_statistics.categories[index];
+		if (current.allocations == 0UL && current.peak_bytes == 0UL) { continue; }
+		add_row(name(static_cast<category>(index)), current);
+	}
+	add_row("total", usage_statistics.total);
+	return result;
+}
+
+} // namespace todds::allocations
@@ -0,0 +1,378 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "todds/buffer_pool.hpp"
+
+#include "todds/memory.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if defined(__has_feature)
+#if __has_feature(memory_sanitizer)
+#include <sanitizer/msan_interface.h>
+#define TODDS_MEMORY_SANITIZER
+#endif
+#endif
+
+namespace {
+
+using todds::buffer_pool::default_cache_limit;
+using todds::buffer_pool::minimum_pooled_size;
+
+// Size classes split the range between two consecutive powers of two in four steps, so at most 25% of a buffer is
+// wasted. Larger requests are forwarded to todds::base_allocator.
+constexpr std::size_t steps_per_power = 4UL;
+constexpr std::size_t minimum_shift = std::bit_width(minimum_pooled_size) - 1UL;
+constexpr std::size_t maximum_shift = 40UL;
+constexpr std::size_t class_count = (maximum_shift - minimum_shift) * steps_per_power;
+constexpr std::size_t maximum_pooled_size = 1UL << maximum_shift;
+
+[[nodiscard]] constexpr bool is_pooled(std::size_t bytes) noexcept {
+	return bytes > minimum_pooled_size && bytes <= maximum_pooled_size;
+}
+
+struct size_class {
+	std::size_t index;
+	std::size_t bytes;
+};
+
+[[nodiscard]] constexpr size_class get_size_class(std::size_t bytes) noexcept {
+	const std::size_t base = std::bit_floor(bytes - 1UL);
+	const std::size_t step = base / steps_per_power;
+	const std::size_t steps = (bytes + step - 1UL) / step;
+	const std::size_t shift = std::bit_width(base) - 1UL;
+	return {(shift - minimum_shift) * steps_per_power + steps - steps_per_power - 1UL, steps * step};
+}
+
+static_assert(get_size_class(minimum_pooled_size + 1UL).index == 0UL);
+static_assert(get_size_class(minimum_pooled_size * 2UL).bytes == minimum_pooled_size * 2UL);
+static_assert(get_size_class(maximum_pooled_size).index == class_count - 1UL);
+
+// Huge pages are only requested for buffers which can fill at least one of them.
+constexpr std::size_t huge_page_size = 2UL * 1024UL * 1024UL;
+
+struct mapping {
+	void* memory;
+	bool explicit_huge_pages;
+};
+
+#if !defined(_WIN32)
+// Maps a region aligned to huge_page_size, so transparent huge pages can back all of it.
+void* map_aligned(std::size_t bytes) noexcept {
+	const std::size_t padded_bytes = bytes + huge_page_size;
+	void* memory = mmap(nullptr, padded_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) [[unlikely]] { return nullptr; }
+	auto* const start = static_cast<std::byte*>(memory);
+	const auto address = reinterpret_cast<std::uintptr_t>(start); // NOLINT
+	auto* const aligned = start + ((huge_page_size - address % huge_page_size) % huge_page_size);
+	if (aligned != start) { munmap(start, static_cast<std::size_t>(aligned - start)); }
+	const std::size_t tail = padded_bytes - static_cast<std::size_t>(aligned - start) - bytes;
+	if (tail > 0UL) { munmap(aligned + bytes, tail); }
+	return aligned;
+}
+#endif
+
+// Pooled buffers are obtained directly from the operating system. Their size is always a multiple of the page size.
+// When huge pages are requested, explicit huge pages are tried first. They are only used for sizes which are a
+// multiple of the huge page size, so the buffer can be released later without knowing how it was mapped.
+// Transparent huge pages are used otherwise. Any failure falls back to regular pages silently.
+mapping map_memory(std::size_t bytes, [[maybe_unused]] bool huge_pages) noexcept {
+	const bool use_huge_pages = huge_pages && bytes >= huge_page_size;
+#if defined(_WIN32)
+	if (use_huge_pages) {
+		const std::size_t large_page_size = GetLargePageMinimum();
+		if (large_page_size != 0UL && bytes % large_page_size == 0UL) {
+			// Requires the SeLockMemoryPrivilege privilege.
+			void* memory = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (memory != nullptr) { return {memory, true}; }
+		}
+	}
+	return {VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE), false};
+#else
+#if defined(MAP_HUGETLB)
+	if (use_huge_pages && bytes % huge_page_size == 0UL) {
+		// Requires huge pages reserved through /proc/sys/vm/nr_hugepages.
+		void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) { return {memory, true}; }
+	}
+#endif
+	if (use_huge_pages) {
+		if (void* memory = map_aligned(bytes); memory != nullptr) {
+#if defined(MADV_HUGEPAGE)
+			madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+			return {memory, false};
+		}
+	}
+	void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return {memory == MAP_FAILED ? nullptr : memory, false};
+#endif
+}
+
+void unmap_memory(void* memory, [[maybe_unused]] std::size_t bytes) noexcept {
+#if defined(_WIN32)
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	munmap(memory, bytes);
+#endif
+}
+
+// Buffers are only recycled within the NUMA node which allocated them, to keep their memory local to the threads
+// using it. Nodes beyond this limit share their buffers with other nodes.
+constexpr std::size_t maximum_nodes = 64UL;
+
+class shared_pool final {
+public:
+	[[nodiscard]] void* pop(std::size_t node, std::size_t index) noexcept {
+		class_lists* lists = _nodes[node % maximum_nodes].load();
+		if (lists == nullptr) { return nullptr; }
+		auto& current = (*lists)[index];
+		const std::lock_guard lock{current.mutex};
+		if (current.buffers.empty()) { return nullptr; }
+		void* memory = current.buffers.back();
+		current.buffers.pop_back();
+		return memory;
+	}
+
+	void push(std::size_t node, std::size_t index, std::size_t bytes, void* memory) noexcept {
+		try {
+			auto& current = get_classes(node)[index];
+			const std::lock_guard lock{current.mutex};
+			current.buffers.push_back(memory);
+		} catch (...) {
+			release(bytes, memory);
+		}
+	}
+
+	// Releases the memory of a cached buffer.
+	void release(std::size_t bytes, void* memory) noexcept {
+		cached_bytes -= bytes;
+		unmap_memory(memory, bytes);
+	}
+
+	void trim() noexcept {
+		for (std::size_t node = 0UL; node < maximum_nodes; ++node) {
+			if (_nodes[node].load() == nullptr) { continue; }
+			for (std::size_t index = 0UL; index < class_count; ++index) {
+				while (void* memory = pop(node, index)) { release(class_bytes(index), memory); }
+			}
+		}
+	}
+
+	[[nodiscard]] static std::size_t class_bytes(std::size_t index) noexcept {
+		const std::size_t base = 1UL << (minimum_shift + index / steps_per_power);
+		return base + (index % steps_per_power + 1UL) * (base / steps_per_power);
+	}
+
+	std::atomic<std::size_t> hits{};
+	std::atomic<std::size_t> misses{};
+	std::atomic<std::size_t> cached_bytes{};
+	std::atomic<std::size_t> huge_page_buffers{};
+	std::atomic<std::size_t> cache_limit{default_cache_limit};
+	std::atomic<bool> huge_pages{};
+
+private:
+	struct buffer_list {
+		std::mutex mutex;
+		std::vector<void*> buffers;
+	};
+
+	using class_lists = std::array<buffer_list, class_count>;
+
+	// The lists of each node are created the first time that a buffer is pushed into them, and never destroyed.
+	[[nodiscard]] class_lists& get_classes(std::size_t node) {
+		auto& slot = _nodes[node % maximum_nodes];
+		class_lists* lists = slot.load();
+		if (lists == nullptr) {
+			auto* created = new class_lists{}; // NOLINT
+			if (slot.compare_exchange_strong(lists, created)) {
+				lists = created;
+			} else {
+				delete created; // NOLINT
+			}
+		}
+		return *lists;
+	}
+
+	std::array<std::atomic<class_lists*>, maximum_nodes> _nodes{};
+};
+
+// Buffers may be released by static destructors after the end of main, so the shared pool is never destroyed.
+shared_pool& get_shared_pool() noexcept {
+	static auto* pool = new shared_pool{}; // NOLINT
+	return *pool;
+}
+
+// Most buffers are released by the thread that allocated them, or by another thread which will allocate a buffer of
+// the same size for the next file. Keeping one buffer per class avoids locking in these cases.
+class thread_cache final {
+public:
+	thread_cache() noexcept = default;
+	thread_cache(const thread_cache&) = delete;
+	thread_cache(thread_cache&&) = delete;
+	thread_cache& operator=(const thread_cache&) = delete;
+	thread_cache& operator=(thread_cache&&) = delete;
+
+	~thread_cache() { trim(); }
+
+	[[nodiscard]] void* pop(std::size_t index) noexcept { return std::exchange(_buffers[index], nullptr); }
+
+	// Returns the buffer previously cached in this class, if any.
+	[[nodiscard]] void* push(std::size_t index, void* memory) noexcept { return std::exchange(_buffers[index], memory); }
+
+	// Moves every buffer to the shared pool.
+	void trim() noexcept {
+		auto& shared = get_shared_pool();
+		for (std::size_t index = 0UL; index < class_count; ++index) {
+			if (void* memory = pop(index)) { shared.push(_node, index, shared_pool::class_bytes(index), memory); }
+		}
+	}
+
+	[[nodiscard]] std::size_t node() const noexcept { return _node; }
+
+	// Cached buffers belong to the previous node, so they are returned to its shared pool first.
+	void set_node(std::size_t node) noexcept {
+		if (node == _node) { return; }
+		trim();
+		_node = node;
+	}
+
+private:
+	std::array<void*, class_count> _buffers{};
+	std::size_t _node{};
+};
+
+thread_local thread_cache cache;
+
+// Recycled buffers contain data of previous files, and new buffers are zeroed by the operating system. Neither case
+// should be relied upon, so debug builds overwrite the buffer with a recognizable value.
+void* poison([[maybe_unused]] void* memory, [[maybe_unused]] std::size_t bytes) noexcept {
+#if !defined(NDEBUG)
+	std::memset(memory, todds::buffer_pool::poison_byte, bytes);
+#endif
+#if defined(TODDS_MEMORY_SANITIZER)
+	__msan_allocated_memory(memory, bytes);
+#endif
+	return memory;
+}
+
+} // Anonymous namespace
+
+namespace todds::buffer_pool {
+
+double statistics::hit_rate() const noexcept {
+	const std::size_t total = hits + misses;
+	return total == 0UL ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+}
+
+void* allocate(std::size_t bytes) {
+	if (!is_pooled(bytes)) { return poison(todds::base_allocator<std::byte>{}.allocate(bytes), bytes); }
+
+	const auto [index, class_bytes] = get_size_class(bytes);
+	auto& shared = get_shared_pool();
+	void* memory = cache.pop(index);
+	if (memory == nullptr) { memory = shared.pop(cache.node(), index); }
+	if (memory != nullptr) {
+		shared.cached_bytes -= class_bytes;
+		++shared.hits;
+		return poison(memory, bytes);
+	}
+
+	++shared.misses;
+	auto result = map_memory(class_bytes, shared.huge_pages);
+	if (result.memory == nullptr) [[unlikely]] {
+		// Try again after returning every cached buffer to the operating system.
+		trim();
+		result = map_memory(class_bytes, shared.huge_pages);
+		if (result.memory == nullptr) { throw std::bad_alloc{}; }
+	}
+	if (result.explicit_huge_pages) { ++shared.huge_page_buffers; }
+	return poison(result.memory, bytes);
+}
+
+void deallocate(void* memory, std::size_t bytes) noexcept {
+	if (memory == nullptr) { return; }
+	if (!is_pooled(bytes)) {
+		todds::base_allocator<std::byte>{}.deallocate(static_cast<std::byte*>(memory), bytes);
+		return;
+	}
+
+	const auto [index, class_bytes] = get_size_class(bytes);
+	auto& shared = get_shared_pool();
+	if (shared.cached_bytes + class_bytes > shared.cache_limit) {
+		unmap_memory(memory, class_bytes);
+		return;
+	}
+
+	shared.cached_bytes += class_bytes;
+	if (void* previous = cache.push(index, memory)) { shared.push(cache.node(), index, class_bytes, previous); }
+}
+
+void set_cache_limit(std::size_t bytes) noexcept { get_shared_pool().cache_limit = bytes; }
+
+void set_huge_pages(bool enabled) noexcept { get_shared_pool().huge_pages = enabled; }
+
+void set_numa_node(std::size_t node) noexcept { cache.set_node(node); }
+
+void trim() noexcept {
+	cache.trim();
+	get_shared_pool().trim();
+}
+
+statistics get_statistics() noexcept {
+	const auto& shared = get_shared_pool();
+	statistics result{shared.hits, shared.misses, shared.cached_bytes, shared.huge_page_buffers, 0UL, 0UL, 0UL, 0UL};
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) != 0) {
+		result.major_page_faults = counters.PageFaultCount;
+		result.peak_resident_bytes = counters.PeakWorkingSetSize;
+		result.resident_bytes = counters.WorkingSetSize;
+	}
+#else
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		result.minor_page_faults = static_cast<std::size_t>(usage.ru_minflt);
+		result.major_page_faults = static_cast<std::size_t>(usage.ru_majflt);
+		// Linux reports kibibytes, while macOS reports bytes.
+#if defined(__APPLE__)
+		result.peak_resident_bytes = static_cast<std::size_t>(usage.ru_maxrss);
+#else
+		result.peak_resident_bytes = static_cast<std::size_t>(usage.ru_maxrss) * 1024UL;
+#endif
+	}
+#if defined(__linux__)
+	// The second field contains the resident pages of the process.
+	if (std::FILE* statm = std::fopen("/proc/self/statm", "r"); statm != nullptr) {
+		unsigned long size{};
+		unsigned long resident{};
+		if (std::fscanf(statm, "%lu %lu", &size, &resident) == 2) {
+			result.resident_bytes = static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+		}
+		std::fclose(statm);
+	}
+#endif
+#endif
+	return result;
+}
+
+} // namespace todds::buffer_pool
@@ -0,0 +1,206 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "todds/cgroup.hpp"
+
+#include "todds/string.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <string>
+
+namespace {
+
+// Values at least this large are used by cgroup v1 to represent the lack of a memory limit.
+constexpr std::size_t unlimited_memory = 1ULL << 62U;
+
+[[nodiscard]] std::string_view trim(std::string_view text) noexcept {
+	constexpr std::string_view whitespace = " \t\r\n";
+	const std::size_t start = text.find_first_not_of(whitespace);
+	if (start == std::string_view::npos) { return {}; }
+	return text.substr(start, text.find_last_not_of(whitespace) - start + 1UL);
+}
+
+// Parses the whole text as an unsigned integer. Returns false if it is not a valid value.
+[[nodiscard]] bool to_size(std::string_view text, std::size_t& value) noexcept {
+	text = trim(text);
+	const char* end = text.data() + text.size();
+	const auto [pointer, error] = std::from_chars(text.data(), end, value);
+	return error == std::errc{} && pointer == end && !text.empty();
+}
+
+// Smallest of two limits, where zero means that there is no limit.
+[[nodiscard]] std::size_t min_limit(std::size_t lhs, std::size_t rhs) noexcept {
+	if (lhs == 0UL) { return rhs; }
+	if (rhs == 0UL) { return lhs; }
+	return std::min(lhs, rhs);
+}
+
+#if defined(__linux__)
+constexpr std::string_view cgroup_mount = "/sys/fs/cgroup";
+
+// Returns the first line of the file, or an empty string if it cannot be read.
+[[nodiscard]] todds::string read_line(const todds::string& path) {
+	std::ifstream file{std::string{path}};
+	todds::string line;
+	if (file.is_open()) { std::getline(file, line); }
+	return line;
+}
+
+[[nodiscard]] todds::string join(std::string_view directory, std::string_view path) {
+	todds::string result{directory};
+	if (!path.empty() && path != "/") { result += path; }
+	return result;
+}
+
+// cgroup paths of the process for each controller used by todds.
+struct cgroup_paths {
+	bool unified{};
+	todds::string unified_path;
+	todds::string cpu_path;
+	todds::string cpuset_path;
+	todds::string memory_path;
+};
+
+[[nodiscard]] bool has_controller(std::string_view controllers, std::string_view controller) noexcept {
+	while (!controllers.empty()) {
+		const std::size_t separator = controllers.find(',');
+		if (controllers.substr(0UL, separator) == controller) { return true; }
+		if (separator == std::string_view::npos) { break; }
+		controllers.remove_prefix(separator + 1UL);
+	}
+	return false;
+}
+
+// Each line of /proc/self/cgroup has the format hierarchy-ID:controller-list:cgroup-path.
+[[nodiscard]] cgroup_paths get_paths() {
+	cgroup_paths paths{};
+	std::ifstream file{"/proc/self/cgroup"};
+	todds::string line;
+	while (std::getline(file, line)) {
+		const std::string_view view{line};
+		const std::size_t first = view.find(':');
+		const std::size_t second = view.find(':', first + 1UL);
+		if (first == std::string_view::npos || second == std::string_view::npos) { continue; }
+		const std::string_view controllers = view.substr(first + 1UL, second - first - 1UL);
+		const todds::string path{view.substr(second + 1UL)};
+		if (view.substr(0UL, first) == "0" && controllers.empty()) {
+			paths.unified = true;
+			paths.unified_path = path;
+		}
+		if (has_controller(controllers, "cpu")) { paths.cpu_path = path; }
+		if (has_controller(controllers, "cpuset")) { paths.cpuset_path = path; }
+		if (has_controller(controllers, "memory")) { paths.memory_path = path; }
+	}
+	return paths;
+}
+
+// Inside of a cgroup namespace, the cgroup of the process is mounted as the root of the hierarchy. Outside of it, the
+// hierarchy must be followed from the root.
+[[nodiscard]] todds::string read_controller_file(std::string_view mount, std::string_view path, std::string_view name) {
+	todds::string contents = read_line(join(mount, path) + '/' + todds::string{name});
+	if (contents.empty()) { contents = read_line(todds::string{mount} + '/' + todds::string{name}); }
+	return contents;
+}
+
+[[nodiscard]] std::size_t read_cpu_max(const todds::string& directory) {
+	const todds::string cpu_max = read_line(directory + "/cpu.max");
+	const std::string_view view{cpu_max};
+	const std::size_t separator = view.find(' ');
+	if (separator == std::string_view::npos) { return 0UL; }
+	return todds::cgroup::parse_cpu_quota(view.substr(0UL, separator), view.substr(separator + 1UL));
+}
+
+// cgroup v2 limits of parent cgroups also apply to their children.
+[[nodiscard]] todds::cgroup::limits get_unified_limits(const todds::string& path) {
+	todds::cgroup::limits result{};
+	todds::string current = path.empty() ? "/" : path;
+	while (true) {
+		const todds::string directory = join(cgroup_mount, current);
+		result.cpu_quota = min_limit(result.cpu_quota, read_cpu_max(directory));
+		result.memory = min_limit(result.memory, todds::cgroup::parse_memory_limit(read_line(directory + "/memory.max")));
+		if (current == "/") { break; }
+		const std::size_t separator = current.rfind('/');
+		current = separator == 0UL || separator == todds::string::npos ? "/" : current.substr(0UL, separator);
+	}
+
+	const todds::string cpus = read_controller_file(cgroup_mount, path, "cpuset.cpus.effective");
+	result.cpuset = todds::cgroup::parse_cpu_list(cpus);
+	return result;
+}
+
+[[nodiscard]] todds::cgroup::limits get_legacy_limits(const cgroup_paths& paths) {
+	todds::cgroup::limits result{};
+	for (const std::string_view mount : {"/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpu"}) {
+		const todds::string quota = read_controller_file(mount, paths.cpu_path, "cpu.cfs_quota_us");
+		const todds::string period = read_controller_file(mount, paths.cpu_path, "cpu.cfs_period_us");
+		if (!quota.empty()) {
+			result.cpu_quota = todds::cgroup::parse_cpu_quota(quota, period);
+			break;
+		}
+	}
+
+	result.cpuset =
+		todds::cgroup::parse_cpu_list(read_controller_file("/sys/fs/cgroup/cpuset", paths.cpuset_path, "cpuset.cpus"));
+	result.memory = todds::cgroup::parse_memory_limit(
+		read_controller_file("/sys/fs/cgroup/memory", paths.memory_path, "memory.limit_in_bytes"));
+	return result;
+}
+#endif // defined(__linux__)
+
+} // anonymous namespace
+
+namespace todds::cgroup {
+
+std::size_t limits::cpus() const noexcept { return min_limit(cpu_quota, cpuset); }
+
+limits get_limits() {
+#if defined(__linux__)
+	const cgroup_paths paths = get_paths();
+	if (paths.unified && paths.cpu_path.empty() && paths.memory_path.empty()) {
+		return get_unified_limits(paths.unified_path);
+	}
+	return get_legacy_limits(paths);
+#else
+	return {};
+#endif // defined(__linux__)
+}
+
+std::size_t parse_cpu_quota(std::string_view quota, std::string_view period) noexcept {
+	std::size_t quota_value{};
+	std::size_t period_value{};
+	// "max" and negative values fail to parse as unsigned integers.
+	if (!to_size(quota, quota_value) || !to_size(period, period_value) || quota_value == 0UL || period_value == 0UL) {
+		return 0UL;
+	}
+	return (quota_value + period_value - 1UL) / period_value;
+}
+
+std::size_t parse_cpu_list(std::string_view list) noexcept {
+	list = trim(list);
+	std::size_t count{};
+	while (!list.empty()) {
+		const std::size_t separator = list.find(',');
+		const std::string_view range = list.substr(0UL, separator);
+		const std::size_t dash = range.find('-');
+		std::size_t first{};
+		std::size_t last{};
+		if (!to_size(range.substr(0UL, dash), first)) { return 0UL; }
+		last = first;
+		if (dash != std::string_view::npos && (!to_size(range.substr(dash + 1UL), last) || last < first)) { return 0UL; }
+		count += last - first + 1UL;
+		if (separator == std::string_view::npos) { break; }
+		list.remove_prefix(separator + 1UL);
+	}
+	return count;
+}
+
+std::size_t parse_memory_limit(std::string_view limit) noexcept {
+	std::size_t value{};
+	if (!to_size(limit, value) || value >= unlimited_memory) { return 0UL; }
+	return value;
+}
+
+} // namespace todds::cgroup
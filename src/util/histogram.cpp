@@ -0,0 +1,65 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "todds/histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace todds {
+
+void histogram::add(std::uint64_t value) noexcept {
+	++_buckets[bucket(value)];
+	++_count;
+	_total += value;
+	_max = std::max(_max, value);
+}
+
+void histogram::merge(const histogram& other) noexcept {
+	for (std::size_t index = 0UL; index < bucket_count; ++index) { _buckets[index] += other._buckets[index]; }
+	_count += other._count;
+	_total += other._total;
+	_max = std::max(_max, other._max);
+}
+
+std::uint64_t histogram::count() const noexcept { return _count; }
+
+std::uint64_t histogram::total() const noexcept { return _total; }
+
+std::uint64_t histogram::max() const noexcept { return _max; }
+
+double histogram::mean() const noexcept {
+	return _count == 0UL ? 0.0 : static_cast<double>(_total) / static_cast<double>(_count);
+}
+
+std::uint64_t histogram::percentile(double fraction) const noexcept {
+	if (_count == 0UL) { return 0UL; }
+	const auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(_count)));
+	std::uint64_t seen{};
+	for (std::size_t index = 0UL; index < bucket_count; ++index) {
+		seen += _buckets[index];
+		if (seen >= std::max(rank, std::uint64_t{1UL})) { return std::min(bucket_upper_bound(index), _max); }
+	}
+	return _max;
+}
+
+// Values smaller than sub_buckets have a bucket each. Larger values use the sub_bucket_bits bits after their most
+// significant bit to choose a sub-bucket of their power of two.
+std::size_t histogram::bucket(std::uint64_t value) noexcept {
+	if (value < sub_buckets) { return static_cast<std::size_t>(value); }
+	const auto magnitude = static_cast<std::size_t>(std::bit_width(value)) - 1UL;
+	const std::size_t shift = magnitude - sub_bucket_bits;
+	const auto sub_bucket = static_cast<std::size_t>(value >> shift) - sub_buckets;
+	return (shift + 1UL) * sub_buckets + sub_bucket;
+}
+
+std::uint64_t histogram::bucket_upper_bound(std::size_t index) noexcept {
+	if (index < sub_buckets) { return index; }
+	const std::size_t shift = index / sub_buckets - 1UL;
+	const std::uint64_t start = static_cast<std::uint64_t>(sub_buckets + index % sub_buckets) << shift;
+	return start + ((std::uint64_t{1UL} << shift) - 1UL);
+}
+
+} // namespace todds
@@ -0,0 +1,74 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/memory.hpp"
+#include "todds/string.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Accounting of the memory allocated by todds containers, broken down by the kind of data that they contain.
+ * Allocation counts and sizes are kept in counters of each thread, and folded together when they are requested. Live
+ * bytes and their high-water mark are shared between every thread, as they depend on the order of every allocation.
+ * Nothing is recorded unless accounting has been enabled. Categories are declared in todds/memory.hpp.
+ */
+namespace todds::allocations {
+
+/** Usage of a category since accounting was enabled. */
+struct usage {
+	/** Number of allocations. */
+	std::size_t allocations{};
+	/** Sum of the sizes of every allocation. */
+	std::size_t allocated_bytes{};
+	/** Bytes which have not been deallocated yet. */
+	std::size_t live_bytes{};
+	/** Maximum value reached by live_bytes. */
+	std::size_t peak_bytes{};
+};
+
+/** Usage of each category, and of all of them together. */
+struct statistics {
+	/** Usage of each category, indexed by its value. */
+	std::array<usage, category_count> categories{};
+	/** Usage of every category. Its peak is the maximum of the sum of live bytes, not the sum of maximums. */
+	usage total{};
+};
+
+/**
+ * Name of a category.
+ * @param value Category.
+ * @return Name of the category.
+ */
+[[nodiscard]] const char* name(category value) noexcept;
+
+/** Start recording allocations. Usage recorded previously is discarded. */
+void enable() noexcept;
+
+/** Stop recording allocations. Usage is kept until the next call to enable. */
+void disable() noexcept;
+
+/**
+ * Check if allocations are being recorded.
+ * @return True if allocations are being recorded.
+ */
+[[nodiscard]] bool enabled() noexcept;
+
+/**
+ * Obtain the usage recorded since accounting was enabled.
+ * @return Usage of each category.
+ */
+[[nodiscard]] statistics get_statistics();
+
+/**
+ * Table with the allocations, allocated bytes, live bytes and high-water mark of each category with any allocation.
+ * @return Table as text.
+ */
+[[nodiscard]] string summary();
+
+} // namespace todds::allocations
@@ -0,0 +1,187 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/allocations.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Pool of large memory buffers shared by the whole process.
+ * Image, encoded and file buffers are allocated and released for every file being processed, and their sizes tend to
+ * repeat. Instead of returning them to the operating system, released buffers are kept in size classes and recycled.
+ * Each thread keeps the last buffer it released of each size class, and the rest are shared between every thread of
+ * the same NUMA node.
+ */
+namespace todds::buffer_pool {
+
+/** Requests of this size or smaller are forwarded to todds::base_allocator instead. */
+constexpr std::size_t minimum_pooled_size = 64UL * 1024UL;
+
+/** Maximum number of bytes kept in the pool unless set_cache_limit is used. */
+constexpr std::size_t default_cache_limit = 1024UL * 1024UL * 1024UL;
+
+/** In debug builds, allocated buffers are filled with this value to make reads of uninitialized data visible. */
+constexpr std::uint8_t poison_byte = 0xA5U;
+
+/** Usage statistics of the pool since the process started. */
+struct statistics {
+	/** Allocations served by a recycled buffer. */
+	std::size_t hits{};
+	/** Allocations which required memory from the operating system. */
+	std::size_t misses{};
+	/** Bytes currently kept in the pool, ready to be recycled. */
+	std::size_t cached_bytes{};
+	/** Buffers backed by explicitly reserved huge pages. Does not include transparent huge pages. */
+	std::size_t huge_page_buffers{};
+	/** Page faults of the process which did not require any I/O. */
+	std::size_t minor_page_faults{};
+	/** Page faults of the process which required I/O. Includes every page fault on Windows. */
+	std::size_t major_page_faults{};
+	/** Maximum resident memory of the process, in bytes. */
+	std::size_t peak_resident_bytes{};
+	/** Current resident memory of the process, in bytes. Not available on macOS. */
+	std::size_t resident_bytes{};
+
+	/**
+	 * Ratio of pooled allocations served by recycled buffers.
+	 * @return Value between 0 and 1.
+	 */
+	[[nodiscard]] double hit_rate() const noexcept;
+};
+
+/**
+ * Allocate a buffer. Thread-safe.
+ * @param bytes Size of the buffer.
+ * @return Pointer to the buffer. Its contents are unspecified, and filled with poison_byte in debug builds.
+ * @throws std::bad_alloc if the memory could not be allocated.
+ */
+[[nodiscard]] void* allocate(std::size_t bytes);
+
+/**
+ * Return a buffer to the pool. Thread-safe.
+ * @param memory Buffer obtained from allocate.
+ * @param bytes Size used when allocating the buffer.
+ */
+void deallocate(void* memory, std::size_t bytes) noexcept;
+
+/**
+ * Maximum number of bytes kept in the pool. Buffers released after reaching this limit are returned to the operating
+ * system. The default limit is default_cache_limit.
+ * @param bytes New limit.
+ */
+void set_cache_limit(std::size_t bytes) noexcept;
+
+/**
+ * Back buffers of at least 2 MiB allocated from this point onwards with huge pages, reducing TLB misses when they are
+ * traversed. Explicitly reserved huge pages are preferred. On Linux, transparent huge pages are requested otherwise.
+ * Falls back silently to regular pages if neither is available. Cached buffers keep their current pages.
+ * @param enabled True to request huge pages.
+ */
+void set_huge_pages(bool enabled) noexcept;
+
+/**
+ * Set the NUMA node of the calling thread. Buffers released by this thread are only recycled by threads of the same
+ * node, so memory first written by a node keeps being used by that node. Threads belong to node zero by default.
+ * @param node Index of the node.
+ */
+void set_numa_node(std::size_t node) noexcept;
+
+/**
+ * Return every cached buffer of the calling thread and of the shared pool to the operating system.
+ */
+void trim() noexcept;
+
+/**
+ * Obtain the current usage statistics.
+ * @return Statistics of the pool and of the process.
+ */
+[[nodiscard]] statistics get_statistics() noexcept;
+
+/**
+ * Conformant allocator using the buffer pool.
+ * Meant for containers with large buffers which are allocated and released frequently. Values constructed without
+ * arguments are default-initialized instead of value-initialized, so creating a container of a given size does not
+ * write into its memory. Every value must be written before being read.
+ * Allocations are recorded in the category of the allocator when allocation accounting is enabled. The allocator is
+ * propagated with its memory, so it is always released with the category used to allocate it.
+ */
+template<typename T> class allocator {
+public:
+	/** Value type being allocated by this allocator. */
+	using value_type = T;
+
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	/** Allow rebinding the allocator to other types. */
+	template<class U>
+	constexpr explicit allocator(const allocator<U>& other) noexcept
+		: _category{other.get_category()} {}
+
+	/**
+	 * Allocator recording its allocations in a category.
+	 * @param type Category of the allocations.
+	 */
+	constexpr explicit allocator(allocations::category type) noexcept
+		: _category{type} {}
+
+	constexpr allocator() noexcept = default;
+	constexpr allocator(const allocator&) noexcept = default;
+	constexpr allocator(allocator&&) noexcept = default;
+	constexpr allocator& operator=(const allocator&) noexcept = default;
+	constexpr allocator& operator=(allocator&&) noexcept = default;
+	~allocator() = default;
+
+	/** Allocates memory for n instances of T. */
+	[[nodiscard]] T* allocate(std::size_t n) {
+		static_assert(alignof(T) <= alignof(std::max_align_t));
+		T* memory = static_cast<T*>(buffer_pool::allocate(n * sizeof(T)));
+		allocations::allocated(_category, n * sizeof(T));
+		return memory;
+	}
+
+	/** Deallocates the memory of n instances of T. */
+	void deallocate(T* memory, std::size_t n) noexcept {
+		allocations::deallocated(_category, n * sizeof(T));
+		buffer_pool::deallocate(memory, n * sizeof(T));
+	}
+
+	/** Default-initializes a value. Trivial types are left uninitialized. */
+	template<typename U> void construct(U* pointer) noexcept(std::is_nothrow_default_constructible_v<U>) {
+		::new (static_cast<void*>(pointer)) U;
+	}
+
+	/** Constructs a value using the provided arguments. */
+	template<typename U, typename... Args> void construct(U* pointer, Args&&... args) {
+		::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+	}
+
+	/** Category in which allocations are recorded. */
+	[[nodiscard]] constexpr allocations::category get_category() const noexcept { return _category; }
+
+private:
+	allocations::category _category{allocations::category::other};
+};
+
+/** Equality comparison operator. */
+template<typename T1, typename T2>
+[[nodiscard]] bool operator==(const allocator<T1>& /* lh */, const allocator<T2>& /* rh */) noexcept {
+	return true;
+}
+
+/** Inequality comparison operator. */
+template<typename T1, typename T2>
+[[nodiscard]] bool operator!=(const allocator<T1>& /* lh */, const allocator<T2>& /* rh */) noexcept {
+	return false;
+}
+
+} // namespace todds::buffer_pool
@@ -0,0 +1,61 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * Resource limits imposed on the process by Linux control groups, such as those of containers.
+ * Both cgroup v1 and cgroup v2 are supported. Other operating systems never report any limit.
+ */
+namespace todds::cgroup {
+
+/** Limits of the process. A value of zero means that there is no limit. */
+struct limits {
+	/** CPU time quota, in CPUs rounded up. */
+	std::size_t cpu_quota{};
+	/** Number of CPUs of the cpuset of the process. */
+	std::size_t cpuset{};
+	/** Memory limit in bytes. */
+	std::size_t memory{};
+
+	/**
+	 * Number of CPUs that the process can use without being throttled.
+	 * @return Smallest of cpu_quota and cpuset, ignoring zeros. Zero if neither is limited.
+	 */
+	[[nodiscard]] std::size_t cpus() const noexcept;
+};
+
+/**
+ * Detect the limits of the current process. Limits set on parent cgroups are taken into account.
+ * @return Detected limits.
+ */
+[[nodiscard]] limits get_limits();
+
+/**
+ * Parse a cgroup v2 cpu.max file, or the cpu.cfs_quota_us and cpu.cfs_period_us files of cgroup v1.
+ * @param quota Quota in microseconds. "max" or a negative value mean no quota.
+ * @param period Period in microseconds.
+ * @return Quota in CPUs rounded up, or zero if there is no quota.
+ */
+[[nodiscard]] std::size_t parse_cpu_quota(std::string_view quota, std::string_view period) noexcept;
+
+/**
+ * Parse a list of CPUs such as "0-3,8,10-11".
+ * @param list Contents of a cpuset.cpus or cpuset.cpus.effective file.
+ * @return Number of CPUs in the list. Zero if the list is empty or invalid.
+ */
+[[nodiscard]] std::size_t parse_cpu_list(std::string_view list) noexcept;
+
+/**
+ * Parse a cgroup v2 memory.max file, or the memory.limit_in_bytes file of cgroup v1.
+ * @param limit Limit in bytes. "max" or values close to the maximum of a 64 bit integer mean no limit.
+ * @return Limit in bytes, or zero if there is no limit.
+ */
+[[nodiscard]] std::size_t parse_memory_limit(std::string_view limit) noexcept;
+
+} // namespace todds::cgroup
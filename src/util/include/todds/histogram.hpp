@@ -0,0 +1,68 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace todds {
+
+/**
+ * Distribution of non-negative integer samples, such as durations in nanoseconds.
+ * Values are stored in logarithmic buckets, each one split into linear sub-buckets. Percentiles have a relative error
+ * below 12.5%, while adding a sample or merging two histograms never allocates memory. Not thread-safe.
+ */
+class histogram final {
+public:
+	/**
+	 * Add a sample.
+	 * @param value Value of the sample.
+	 */
+	void add(std::uint64_t value) noexcept;
+
+	/**
+	 * Add every sample of another histogram to this one.
+	 * @param other Histogram to merge.
+	 */
+	void merge(const histogram& other) noexcept;
+
+	/** @return Number of samples. */
+	[[nodiscard]] std::uint64_t count() const noexcept;
+
+	/** @return Sum of every sample. */
+	[[nodiscard]] std::uint64_t total() const noexcept;
+
+	/** @return Largest sample, or zero if there are no samples. */
+	[[nodiscard]] std::uint64_t max() const noexcept;
+
+	/** @return Average value of the samples, or zero if there are no samples. */
+	[[nodiscard]] double mean() const noexcept;
+
+	/**
+	 * Approximate value below which a fraction of the samples fall.
+	 * @param fraction Value between 0 and 1. For example, 0.95 returns the 95th percentile.
+	 * @return Upper bound of the bucket containing the percentile, never larger than max(). Zero if there are no
+	 * samples.
+	 */
+	[[nodiscard]] std::uint64_t percentile(double fraction) const noexcept;
+
+private:
+	/** Each power of two is split into this many sub-buckets. */
+	static constexpr std::size_t sub_bucket_bits = 3UL;
+	static constexpr std::size_t sub_buckets = 1UL << sub_bucket_bits;
+	static constexpr std::size_t bucket_count = (64UL - sub_bucket_bits + 1UL) * sub_buckets;
+
+	[[nodiscard]] static std::size_t bucket(std::uint64_t value) noexcept;
+	[[nodiscard]] static std::uint64_t bucket_upper_bound(std::size_t index) noexcept;
+
+	std::array<std::uint64_t, bucket_count> _buckets{};
+	std::uint64_t _count{};
+	std::uint64_t _total{};
+	std::uint64_t _max{};
+};
+
+} // namespace todds
@@ -9,7 +9,10 @@
 #include <tracy/Tracy.hpp>
 #endif
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 
 #if defined(TODDS_TBB_ALLOCATOR)
 #include <oneapi/tbb/scalable_allocator.h>
@@ -17,44 +20,82 @@
 #include <mimalloc.h>
 #endif
 
+namespace todds::allocations {
+
+/** Kind of data stored in an allocation. */
+enum class category : std::uint8_t {
+	/** Contents of PNG files, read from disk or encoded. */
+	png_buffers,
+	/** Pixels of decoded images and their mipmap levels. */
+	mipmap_images,
+	/** Rows kept by the resampler while blurring and resizing images. */
+	blur_scratch,
+	/** Bands of pixel blocks waiting to be encoded while streaming, and rows being rearranged into blocks. */
+	pixel_blocks,
+	/** Encoded DDS data. */
+	dds_output,
+	/** Source and destination paths of each file. */
+	paths,
+	/** Any other allocation. */
+	other,
+};
+
+constexpr std::size_t category_count = 7UL;
+
+/**
+ * Record an allocation. Thread-safe. Does nothing unless accounting is enabled.
+ * @param type Category of the allocation.
+ * @param bytes Size of the allocation.
+ */
+void allocated(category type, std::size_t bytes) noexcept;
+
+/**
+ * Record a deallocation. Thread-safe. Does nothing unless accounting is enabled.
+ * @param type Category used when allocating.
+ * @param bytes Size used when allocating.
+ */
+void deallocated(category type, std::size_t bytes) noexcept;
+
+} // namespace todds::allocations
+
 namespace todds {
 
-/** Allocator to use in todds types. */
+/** Allocator providing the memory of todds::allocator, without recording its allocations. */
 #if defined(TODDS_TBB_ALLOCATOR)
-template<typename Type> using allocator = tbb::scalable_allocator<Type>;
+template<typename Type> using base_allocator = tbb::scalable_allocator<Type>;
 #elif defined(TODDS_MIMALLOC_ALLOCATOR)
-template<typename Type> using allocator = mi_stl_allocator<Type>;
+template<typename Type> using base_allocator = mi_stl_allocator<Type>;
 #elif defined(TRACY_ENABLE)
 
 /** @brief Conformant allocator with Tracy Profiler support.
  *
  * This allocator does not handle any exceptions and terminates on allocation failure.
  */
-template<typename T> class allocator {
+template<typename T> class base_allocator {
 public:
 	/** @brief Value type being allocated by this allocator. */
 	using value_type = T;
 
 	/** @brief Allow rebinding the allocator to other types. */
-	template<class U> constexpr explicit allocator(const allocator<U>& /*other*/) noexcept {}
+	template<class U> constexpr explicit base_allocator(const base_allocator<U>& /*other*/) noexcept {}
 
 	/** @brief Default constructor. */
-	[[nodiscard]] constexpr allocator() noexcept = default;
+	[[nodiscard]] constexpr base_allocator() noexcept = default;
 
 	/** @brief Copy constructor. */
-	[[nodiscard]] constexpr allocator(const allocator&) noexcept = default;
+	[[nodiscard]] constexpr base_allocator(const base_allocator&) noexcept = default;
 
 	/** @brief Move constructor. */
-	[[nodiscard]] constexpr allocator(allocator&&) noexcept = default;
+	[[nodiscard]] constexpr base_allocator(base_allocator&&) noexcept = default;
 
 	/** @brief Copy assignment operator. */
-	constexpr allocator& operator=(const allocator&) noexcept = default;
+	constexpr base_allocator& operator=(const base_allocator&) noexcept = default;
 
 	/** @brief Move assignment operator. */
-	constexpr allocator& operator=(allocator&&) noexcept = default;
+	constexpr base_allocator& operator=(base_allocator&&) noexcept = default;
 
 	/** @brief Default destructor. */
-	~allocator() = default;
+	~base_allocator() = default;
 
 	/** @brief Allocates memory for n instances of T.
 	 *
@@ -76,18 +117,83 @@ public:
 
 /** @brief Equality comparison operator. */
 template<typename T1, typename T2>
-[[nodiscard]] bool operator==(const allocator<T1>& /* lh */, const allocator<T2>& /* rh */) noexcept {
+[[nodiscard]] bool operator==(const base_allocator<T1>& /* lh */, const base_allocator<T2>& /* rh */) noexcept {
 	return true;
 }
 
 /** @brief Inequality comparison operator. */
 template<typename T1, typename T2>
-[[nodiscard]] bool operator!=(const allocator<T1>& /* lh */, const allocator<T2>& /* rh */) noexcept {
+[[nodiscard]] bool operator!=(const base_allocator<T1>& /* lh */, const base_allocator<T2>& /* rh */) noexcept {
 	return false;
 }
 
 #else
-template<typename Type> using allocator = std::allocator<Type>;
+template<typename Type> using base_allocator = std::allocator<Type>;
 #endif
 
+/**
+ * Conformant allocator to use in todds types.
+ * Allocations are recorded in the category of the allocator when allocation accounting is enabled. The allocator is
+ * propagated with its memory, so it is always released with the category used to allocate it.
+ */
+template<typename T> class allocator {
+public:
+	/** Value type being allocated by this allocator. */
+	using value_type = T;
+
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	/** Allow rebinding the allocator to other types. */
+	template<class U>
+	constexpr explicit allocator(const allocator<U>& other) noexcept
+		: _category{other.get_category()} {}
+
+	/**
+	 * Allocator recording its allocations in a category.
+	 * @param type Category of the allocations.
+	 */
+	constexpr explicit allocator(allocations::category type) noexcept
+		: _category{type} {}
+
+	constexpr allocator() noexcept = default;
+	constexpr allocator(const allocator&) noexcept = default;
+	constexpr allocator(allocator&&) noexcept = default;
+	constexpr allocator& operator=(const allocator&) noexcept = default;
+	constexpr allocator& operator=(allocator&&) noexcept = default;
+	~allocator() = default;
+
+	/** Allocates memory for n instances of T. */
+	[[nodiscard]] T* allocate(std::size_t n) {
+		T* memory = base_allocator<T>{}.allocate(n);
+		allocations::allocated(_category, n * sizeof(T));
+		return memory;
+	}
+
+	/** Deallocates the memory of n instances of T. */
+	void deallocate(T* memory, std::size_t n) noexcept {
+		allocations::deallocated(_category, n * sizeof(T));
+		base_allocator<T>{}.deallocate(memory, n);
+	}
+
+	/** Category in which allocations are recorded. */
+	[[nodiscard]] constexpr allocations::category get_category() const noexcept { return _category; }
+
+private:
+	allocations::category _category{allocations::category::other};
+};
+
+/** Equality comparison operator. */
+template<typename T1, typename T2>
+[[nodiscard]] bool operator==(const allocator<T1>& /* lh */, const allocator<T2>& /* rh */) noexcept {
+	return true;
+}
+
+/** Inequality comparison operator. */
+template<typename T1, typename T2>
+[[nodiscard]] bool operator!=(const allocator<T1>& /* lh */, const allocator<T2>& /* rh */) noexcept {
+	return false;
+}
+
 } // namespace todds
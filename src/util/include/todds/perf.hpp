@@ -0,0 +1,93 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "todds/string.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Hardware performance counters of each profiler zone, read with perf_event_open on Linux.
+ * Each thread opens its own group of counters the first time that it enters a zone. Counters are read when a zone
+ * starts and when it ends, and the difference is added to the totals of the zone name in that thread. Nested zones are
+ * also included in the counters of their parents. Zones are created with the TracyZoneScopedN macro.
+ */
+namespace todds::perf {
+
+/** Hardware events counted in each zone. */
+enum class event {
+	/** CPU cycles. */
+	cycles,
+	/** Retired instructions. */
+	instructions,
+	/** Last level cache misses. */
+	cache_misses,
+	/** Mispredicted branches. */
+	branch_misses,
+	/** Cycles running at the frequency license of heavy 256 bit instructions. Only available on Intel CPUs. */
+	avx2_license,
+	/** Cycles running at the frequency license of 512 bit instructions. Only available on Intel CPUs. */
+	avx512_license,
+};
+
+constexpr std::size_t event_count = 6UL;
+
+/** Totals of a zone name. */
+struct counters {
+	/** Number of times that the zone has been entered. */
+	std::uint64_t calls{};
+	/** Value of each event. */
+	std::array<std::uint64_t, event_count> values{};
+	/** False for events which could not be opened. */
+	std::array<bool, event_count> available{};
+};
+
+/**
+ * Start counting events in every zone. Totals counted previously are discarded.
+ * @return Empty if counters are available, or a description of the problem otherwise.
+ */
+[[nodiscard]] string enable();
+
+/** Stop counting events. Totals are kept until the next call to enable. */
+void disable() noexcept;
+
+/**
+ * Check if events are being counted.
+ * @return True if events are being counted.
+ */
+[[nodiscard]] bool enabled() noexcept;
+
+/**
+ * Table with the calls, cycles, instructions, instructions per cycle, cache and branch misses per thousand
+ * instructions and the share of cycles running at reduced AVX frequencies of each zone name. Must not be called while
+ * events are being counted.
+ * @return Table as text.
+ */
+[[nodiscard]] string summary();
+
+/** Counts hardware events during the lifetime of the object, if counters are enabled when it is created. */
+class zone final {
+public:
+	/**
+	 * Start counting.
+	 * @param name Name of the zone. Must be a string literal or have static storage duration.
+	 */
+	explicit zone(const char* name);
+	zone(const zone&) = delete;
+	zone(zone&&) = delete;
+	zone& operator=(const zone&) = delete;
+	zone& operator=(zone&&) = delete;
+	~zone();
+
+private:
+	const char* _name;
+	bool _counting{};
+	std::array<std::uint64_t, event_count> _start{};
+};
+
+} // namespace todds::perf
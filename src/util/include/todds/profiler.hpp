@@ -5,17 +5,27 @@
 
 #pragma once
 
+#include "todds/perf.hpp"
+#include "todds/trace.hpp"
+
 #if defined(TRACY_ENABLE)
 #include <tracy/Tracy.hpp>
 #endif
 
+// Zones are recorded by todds::trace and todds::perf while they are enabled, and also sent to Tracy in Tracy builds.
 #if defined(TRACY_ENABLE)
-#define TracyZoneScopedN(str) ZoneScopedN(str)
+#define TracyZoneScopedN(str)                                                                                          \
+	ZoneScopedN(str);                                                                                                    \
+	todds::trace::zone todds_trace_zone{str};                                                                            \
+	const todds::perf::zone todds_perf_zone { str }
 #define TracyZoneFileIndex(file_index)                                                                                 \
+	todds_trace_zone.set_file_index(file_index);                                                                         \
 	const auto file_index_str = std::to_string(file_index);                                                              \
 	ZoneText(file_index_str.c_str(), file_index_str.size())
 
 #else
-#define TracyZoneScopedN(str)
-#define TracyZoneFileIndex(file_index)
+#define TracyZoneScopedN(str)                                                                                          \
+	todds::trace::zone todds_trace_zone{str};                                                                            \
+	const todds::perf::zone todds_perf_zone { str }
+#define TracyZoneFileIndex(file_index) todds_trace_zone.set_file_index(file_index)
 #endif
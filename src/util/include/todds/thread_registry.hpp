@@ -0,0 +1,106 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace todds {
+
+/**
+ * Data kept by each thread, such as counters or event buffers, which must be read after their threads finish.
+ * The data of each thread is owned by the registry instead of the thread. Threads find their data through a
+ * thread-local pointer, so the registry is only locked the first time that each thread uses it after each reset.
+ * The registry uses the standard allocator, so registering a thread never records a todds allocation.
+ * Threads remember a single registry of each type, so only one registry of each type may be in use at a time.
+ * @tparam T Type of the data of each thread.
+ */
+template<typename T> class thread_registry final {
+public:
+	thread_registry() = default;
+	thread_registry(const thread_registry&) = delete;
+	thread_registry(thread_registry&&) = delete;
+	thread_registry& operator=(const thread_registry&) = delete;
+	thread_registry& operator=(thread_registry&&) = delete;
+	~thread_registry() = default;
+
+	/**
+	 * Data of the calling thread. Only the calling thread may write into it.
+	 * @param create Called while holding the lock of the registry when the thread has no data yet. It receives the
+	 * index of the thread in the registry, and returns a std::unique_ptr<T>.
+	 * @return Data of the calling thread.
+	 */
+	template<typename Create> T& local(Create&& create) {
+		thread_state& state = get_state();
+		const std::size_t current = _generation.load(std::memory_order_acquire);
+		if (state.generation == current) [[likely]] { return *state.data; }
+		const std::lock_guard lock{_mutex};
+		auto& data = _threads.emplace_back(create(_threads.size()));
+		state = {data.get(), current};
+		return *data;
+	}
+
+	/**
+	 * Data of the calling thread, value-initialized when the thread has no data yet.
+	 * @return Data of the calling thread.
+	 */
+	T& local() {
+		return local([](std::size_t /*index*/) { return std::make_unique<T>(); });
+	}
+
+	/**
+	 * Discard the data of every thread. Threads create new data the next time that they call local.
+	 * @param update Called while holding the lock of the registry, to change any state read by create.
+	 */
+	template<typename Update> void reset(Update&& update) {
+		const std::lock_guard lock{_mutex};
+		_threads.clear();
+		update();
+		_generation.store(next_generation(), std::memory_order_release);
+	}
+
+	/** Discard the data of every thread. */
+	void reset() {
+		reset([] {});
+	}
+
+	/**
+	 * Visit the data of every thread while holding the lock of the registry, in the order in which threads registered.
+	 * @param visit Called with a const reference to the data of each thread.
+	 */
+	template<typename Visit> void for_each(Visit&& visit) const {
+		const std::lock_guard lock{_mutex};
+		for (const auto& data : _threads) { visit(static_cast<const T&>(*data)); }
+	}
+
+private:
+	// Generations are unique between every registry of the same type, even if a registry is created at the address of
+	// a destroyed one. Zero is never used, so threads without data never match a registry.
+	struct thread_state {
+		T* data{};
+		std::size_t generation{};
+	};
+
+	static thread_state& get_state() noexcept {
+		thread_local thread_state state{};
+		return state;
+	}
+
+	static std::size_t next_generation() noexcept {
+		static std::atomic<std::size_t> last{};
+		return last.fetch_add(1UL, std::memory_order_relaxed) + 1UL;
+	}
+
+	mutable std::mutex _mutex;
+	std::vector<std::unique_ptr<T>> _threads;
+	// Replaced by reset, so threads replace the data created before it.
+	std::atomic<std::size_t> _generation{next_generation()};
+};
+
+} // namespace todds
@@ -0,0 +1,73 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Timeline of profiler zones which can be recorded without a profiler, and loaded offline in chrome://tracing or
+ * Perfetto. Each thread records its zones into its own ring buffer. When a buffer is full, its oldest zones are
+ * overwritten. Zones are created with the TracyZoneScopedN macro, and only recorded while tracing is enabled.
+ */
+namespace todds::trace {
+
+/** Zones kept by each thread unless a different capacity is passed to enable. */
+constexpr std::size_t default_capacity = 64UL * 1024UL;
+
+/** File index of zones which do not process a specific file. */
+constexpr std::size_t no_file = static_cast<std::size_t>(-1);
+
+/**
+ * Start recording zones. Zones recorded previously are discarded. Not thread-safe with respect to zones being recorded.
+ * @param capacity Number of zones kept by each thread.
+ */
+void enable(std::size_t capacity = default_capacity);
+
+/** Stop recording zones. Zones which have been recorded are kept until the next call to enable. */
+void disable() noexcept;
+
+/**
+ * Check if zones are being recorded.
+ * @return True if zones are being recorded.
+ */
+[[nodiscard]] bool enabled() noexcept;
+
+/**
+ * Write every recorded zone in Chrome trace event format. Must not be called while zones are being recorded.
+ * @param output Stream receiving the JSON document.
+ */
+void write(std::ostream& output);
+
+/** Records a zone spanning the lifetime of the object, if tracing is enabled when it is created. */
+class zone final {
+public:
+	/**
+	 * Start a zone.
+	 * @param name Name of the zone. Must be a string literal or have static storage duration.
+	 */
+	explicit zone(const char* name) noexcept;
+	zone(const zone&) = delete;
+	zone(zone&&) = delete;
+	zone& operator=(const zone&) = delete;
+	zone& operator=(zone&&) = delete;
+	~zone();
+
+	/**
+	 * Associate the zone with a file.
+	 * @param file_index Index of the file being processed.
+	 */
+	void set_file_index(std::size_t file_index) noexcept;
+
+private:
+	const char* _name;
+	std::size_t _file_index{no_file};
+	std::chrono::steady_clock::time_point _start{};
+};
+
+} // namespace todds::trace
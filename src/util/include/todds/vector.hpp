@@ -7,6 +7,7 @@
 
 #include <vector>
 
+#include "todds/buffer_pool.hpp"
 #include "todds/memory.hpp"
 
 namespace todds {
@@ -14,4 +15,17 @@ namespace todds {
 /** Vector to use in todds types. */
 template<typename Type, typename Allocator = todds::allocator<Type>> using vector = std::vector<Type, Allocator>;
 
+/** Vector for large buffers which are allocated and released for every file, such as image data. */
+template<typename Type> using pooled_vector = std::vector<Type, buffer_pool::allocator<Type>>;
+
+/**
+ * Allocator for a pooled_vector recording its allocations in a category.
+ * @param type Category of the allocations.
+ * @return Allocator.
+ */
+template<typename Type>
+[[nodiscard]] constexpr buffer_pool::allocator<Type> pooled_allocator(allocations::category type) noexcept {
+	return buffer_pool::allocator<Type>{type};
+}
+
 } // namespace todds
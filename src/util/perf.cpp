@@ -0,0 +1,241 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "todds/perf.hpp"
+
+#include "todds/thread_registry.hpp"
+#include "todds/vector.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace {
+
+using todds::perf::counters;
+using todds::perf::event_count;
+
+// Totals of each zone name in a single thread. Zone names are string literals, so they are compared by address.
+struct thread_counters {
+	thread_counters() = default;
+	thread_counters(const thread_counters&) = delete;
+	thread_counters(thread_counters&&) = delete;
+	thread_counters& operator=(const thread_counters&) = delete;
+	thread_counters& operator=(thread_counters&&) = delete;
+	~thread_counters();
+
+	// Descriptor of each event. The first valid descriptor is the leader of the group.
+	std::array<int, event_count> descriptors{-1, -1, -1, -1, -1, -1};
+	int leader{-1};
+	todds::vector<std::pair<const char*, counters>> zones;
+
+	counters& get(const char* name) {
+		for (auto& [zone_name, totals] : zones) {
+			if (zone_name == name) { return totals; }
+		}
+		auto& totals = zones.emplace_back(name, counters{}).second;
+		for (std::size_t index = 0UL; index < event_count; ++index) { totals.available[index] = descriptors[index] >= 0; }
+		return totals;
+	}
+};
+
+todds::thread_registry<thread_counters>& get_registry() {
+	static todds::thread_registry<thread_counters> instance;
+	return instance;
+}
+
+std::atomic<bool> counting{};
+
+#if defined(__linux__)
+
+struct event_config {
+	std::uint32_t type;
+	std::uint64_t config;
+};
+
+// CORE_POWER.LVL1_TURBO_LICENSE and CORE_POWER.LVL2_TURBO_LICENSE of Intel CPUs since Skylake.
+constexpr std::uint64_t intel_avx2_license = 0x1828U;
+constexpr std::uint64_t intel_avx512_license = 0x2028U;
+
+bool is_intel() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_cpu_is("intel") != 0;
+#else
+	return false;
+#endif
+}
+
+constexpr std::array<event_config, event_count> event_configs{{
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{PERF_TYPE_RAW, intel_avx2_license},
+	{PERF_TYPE_RAW, intel_avx512_license},
+}};
+
+int open_event(const event_config& config, int group) noexcept {
+	perf_event_attr attributes{};
+	attributes.size = sizeof(attributes);
+	attributes.type = config.type;
+	attributes.config = config.config;
+	attributes.read_format = PERF_FORMAT_GROUP;
+	attributes.exclude_kernel = 1U;
+	attributes.exclude_hv = 1U;
+	// Counts the calling thread on any CPU.
+	return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, group, 0UL));
+}
+
+// Opens every available event of the calling thread in a single group, so they are scheduled together.
+void open_group(thread_counters& thread) noexcept {
+	const bool intel = is_intel();
+	for (std::size_t index = 0UL; index < event_count; ++index) {
+		if (event_configs[index].type == PERF_TYPE_RAW && !intel) { continue; }
+		const int descriptor = open_event(event_configs[index], thread.leader);
+		if (descriptor < 0) { continue; }
+		thread.descriptors[index] = descriptor;
+		if (thread.leader < 0) { thread.leader = descriptor; }
+	}
+}
+
+// Values are read in the order in which the events were added to the group.
+void read_group(const thread_counters& thread, std::array<std::uint64_t, event_count>& values) noexcept {
+	std::array<std::uint64_t, event_count + 1UL> buffer{};
+	if (thread.leader < 0 || read(thread.leader, buffer.data(), sizeof(buffer)) <= 0) { return; }
+	std::size_t position = 1UL;
+	for (std::size_t index = 0UL; index < event_count; ++index) {
+		if (thread.descriptors[index] >= 0) { values[index] = buffer[position++]; }
+	}
+}
+
+void close_group(thread_counters& thread) noexcept {
+	for (int& descriptor : thread.descriptors) {
+		if (descriptor >= 0) { close(descriptor); }
+		descriptor = -1;
+	}
+	thread.leader = -1;
+}
+
+#else
+
+void open_group(thread_counters& /*thread*/) noexcept {}
+
+void read_group(const thread_counters& /*thread*/, std::array<std::uint64_t, event_count>& /*values*/) noexcept {}
+
+void close_group(thread_counters& /*thread*/) noexcept {}
+
+#endif // defined(__linux__)
+
+thread_counters::~thread_counters() { close_group(*this); }
+
+// Events are opened by the thread which counts them.
+thread_counters& get_thread_counters() {
+	return get_registry().local([](std::size_t /*index*/) {
+		auto thread = std::make_unique<thread_counters>();
+		open_group(*thread);
+		return thread;
+	});
+}
+
+double per_thousand(std::uint64_t value, std::uint64_t instructions) noexcept {
+	return instructions == 0UL ? 0.0 : static_cast<double>(value) * 1000.0 / static_cast<double>(instructions);
+}
+
+double ratio(std::uint64_t value, std::uint64_t total) noexcept {
+	return total == 0UL ? 0.0 : static_cast<double>(value) / static_cast<double>(total);
+}
+
+} // Anonymous namespace
+
+namespace todds::perf {
+
+string enable() {
+#if defined(__linux__)
+	get_registry().reset();
+	// Check that the calling thread can count cycles, as every other thread has the same permissions.
+	const int descriptor = open_event(event_configs[0], -1);
+	if (descriptor < 0) {
+		return string{fmt::format(
+			"Performance counters are not available: {:s}. Check /proc/sys/kernel/perf_event_paranoid.",
+			std::strerror(errno))};
+	}
+	close(descriptor);
+	counting.store(true, std::memory_order_release);
+	return {};
+#else
+	return "Performance counters are only available on Linux.";
+#endif // defined(__linux__)
+}
+
+void disable() noexcept { counting.store(false, std::memory_order_release); }
+
+bool enabled() noexcept { return counting.load(std::memory_order_relaxed); }
+
+string summary() {
+	// Zones with the same name are combined from every thread.
+	vector<std::pair<std::string_view, counters>> totals;
+	get_registry().for_each([&totals](const thread_counters& thread) {
+		for (const auto& [name, values] : thread.zones) {
+			auto found =
+				std::find_if(totals.begin(), totals.end(), [name](const auto& total) { return total.first == name; });
+			if (found == totals.end()) { found = totals.insert(totals.end(), {name, counters{}}); }
+			auto& total = found->second;
+			total.calls += values.calls;
+			for (std::size_t index = 0UL; index < event_count; ++index) {
+				total.values[index] += values.values[index];
+				total.available[index] = total.available[index] || values.available[index];
+			}
+		}
+	});
+
+	const auto value = [](const counters& total, event type) { return total.values[static_cast<std::size_t>(type)]; };
+	const auto optional_percent = [&value](const counters& total, event type) -> string {
+		if (!total.available[static_cast<std::size_t>(type)]) { return "-"; }
+		return string{fmt::format("{:.1f}%", ratio(value(total, type), value(total, event::cycles)) * 100.0)};
+	};
+
+	string result{fmt::format("{:<12s}{:>10s}{:>14s}{:>14s}{:>7s}{:>13s}{:>15s}{:>10s}{:>10s}", "Zone", "Calls",
+		"Cycles (M)", "Instr. (M)", "IPC", "LLC MPKI", "Branch MPKI", "AVX2 lic", "AVX512 lic")};
+	for (const auto& [name, total] : totals) {
+		const std::uint64_t instructions = value(total, event::instructions);
+		result += fmt::format("\n{:<12s}{:>10d}{:>14.1f}{:>14.1f}{:>7.2f}{:>13.2f}{:>15.2f}{:>10s}{:>10s}", name,
+			total.calls, static_cast<double>(value(total, event::cycles)) / 1.0e6, static_cast<double>(instructions) / 1.0e6,
+			ratio(instructions, value(total, event::cycles)), per_thousand(value(total, event::cache_misses), instructions),
+			per_thousand(value(total, event::branch_misses), instructions), optional_percent(total, event::avx2_license),
+			optional_percent(total, event::avx512_license));
+	}
+	return result;
+}
+
+zone::zone(const char* name)
+	: _name{name} {
+	if (!enabled()) { return; }
+	_counting = true;
+	read_group(get_thread_counters(), _start);
+}
+
+zone::~zone() {
+	if (!_counting) { return; }
+	auto& thread = get_thread_counters();
+	std::array<std::uint64_t, event_count> end{};
+	read_group(thread, end);
+	auto& totals = thread.get(_name);
+	++totals.calls;
+	for (std::size_t index = 0UL; index < event_count; ++index) { totals.values[index] += end[index] - _start[index]; }
+}
+
+} // namespace todds::perf
@@ -0,0 +1,139 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+#include "todds/trace.hpp"
+
+#include "todds/thread_registry.hpp"
+#include "todds/vector.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+struct event {
+	const char* name;
+	std::size_t file_index;
+	std::int64_t start;
+	std::int64_t duration;
+};
+
+// Events of a single thread. Only the owning thread writes into the buffer.
+struct ring_buffer {
+	explicit ring_buffer(std::size_t thread_id, std::size_t capacity)
+		: id{thread_id}
+		, events(capacity) {}
+
+	void push(const event& current) noexcept {
+		events[written % events.size()] = current;
+		++written;
+	}
+
+	std::size_t id;
+	todds::vector<event> events;
+	// Number of events written since the buffer was created.
+	std::size_t written{};
+};
+
+// Capacity and start are only changed by enable, while holding the lock of the buffers.
+struct trace_state {
+	todds::thread_registry<ring_buffer> buffers;
+	std::size_t capacity{todds::trace::default_capacity};
+	clock::time_point start{clock::now()};
+};
+
+trace_state& get_state() {
+	static trace_state instance;
+	return instance;
+}
+
+std::atomic<bool> tracing{};
+
+ring_buffer& thread_buffer() {
+	auto& instance = get_state();
+	return instance.buffers.local(
+		[&instance](std::size_t thread_id) { return std::make_unique<ring_buffer>(thread_id, instance.capacity); });
+}
+
+std::int64_t to_nanoseconds(clock::duration duration) noexcept {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+void write_escaped(std::ostream& output, const char* text) {
+	for (; *text != '\0'; ++text) {
+		if (*text == '"' || *text == '\\') { output << '\\'; }
+		output << *text;
+	}
+}
+
+// Chrome trace events use microseconds.
+void write_microseconds(std::ostream& output, std::int64_t nanoseconds) {
+	output << nanoseconds / 1000 << '.';
+	const std::int64_t fraction = nanoseconds % 1000;
+	if (fraction < 100) { output << '0'; }
+	if (fraction < 10) { output << '0'; }
+	output << fraction;
+}
+
+} // Anonymous namespace
+
+namespace todds::trace {
+
+void enable(std::size_t capacity) {
+	auto& instance = get_state();
+	instance.buffers.reset([&instance, capacity] {
+		instance.capacity = std::max(capacity, std::size_t{1UL});
+		instance.start = clock::now();
+	});
+	tracing.store(true, std::memory_order_release);
+}
+
+void disable() noexcept { tracing.store(false, std::memory_order_release); }
+
+bool enabled() noexcept { return tracing.load(std::memory_order_relaxed); }
+
+void write(std::ostream& output) {
+	output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	get_state().buffers.for_each([&output, &first](const ring_buffer& buffer) {
+		if (!first) { output << ','; }
+		first = false;
+		output << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id
+					 << ",\"args\":{\"name\":\"Thread " << buffer.id << "\"}}";
+
+		const std::size_t capacity = buffer.events.size();
+		const std::size_t count = std::min(buffer.written, capacity);
+		for (std::size_t index = buffer.written - count; index < buffer.written; ++index) {
+			const event& current = buffer.events[index % capacity];
+			output << ",\n{\"name\":\"";
+			write_escaped(output, current.name);
+			output << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.id << ",\"ts\":";
+			write_microseconds(output, current.start);
+			output << ",\"dur\":";
+			write_microseconds(output, current.duration);
+			if (current.file_index != no_file) { output << ",\"args\":{\"file\":" << current.file_index << '}'; }
+			output << '}';
+		}
+	});
+	output << "\n]}\n";
+}
+
+zone::zone(const char* name) noexcept
+	: _name{name} {
+	if (enabled()) { _start = clock::now(); }
+}
+
+zone::~zone() {
+	if (_start == clock::time_point{} || !enabled()) { return; }
+	const auto end = clock::now();
+	const auto origin = get_state().start;
+	thread_buffer().push({_name, _file_index, to_nanoseconds(_start - origin), to_nanoseconds(end - _start)});
+}
+
+void zone::set_file_index(std::size_t file_index) noexcept { _file_index = file_index; }
+
+} // namespace todds::trace
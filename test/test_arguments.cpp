@@ -4,12 +4,14 @@
  */
 
 #include "todds/arguments.hpp"
+#include "todds/cgroup.hpp"
 #include "todds/format.hpp"
 #include "todds/project.hpp"
 
 #include <boost/filesystem/operations.hpp>
 #include <oneapi/tbb/info.h>
 
+#include <algorithm>
 #include <limits>
 
 #include <catch2/catch_test_macros.hpp>
@@ -453,6 +455,27 @@ TEST_CASE("todds::arguments max_size", "[arguments]") {
 	}
 }
 
+TEST_CASE("todds::arguments stream_threshold", "[arguments]") {
+	SECTION("Band streaming is disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.stream_threshold == 0U);
+	}
+
+	SECTION("stream_threshold is not a number") {
+		const auto arguments = get({binary, "--stream-threshold", "not_a_number", "."});
+		REQUIRE(has_error(arguments));
+	}
+
+	SECTION("Valid stream_threshold value") {
+		const auto arguments = get({binary, "--stream-threshold", std::to_string(256U), "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.stream_threshold == 256U);
+		const auto shorter = get({binary, "-st", std::to_string(256U), "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.stream_threshold == 256U);
+	}
+}
+
 TEST_CASE("todds::arguments scale_filter", "[arguments]") {
 	using todds::filter::type;
 
@@ -477,9 +500,10 @@ TEST_CASE("todds::arguments scale_filter", "[arguments]") {
 
 TEST_CASE("todds::arguments threads", "[arguments]") {
 	const auto max_threads = static_cast<std::size_t>(oneapi::tbb::info::default_concurrency());
-	SECTION("The default value of threads is determined by the oneTBB library.") {
+	SECTION("The default value of threads is determined by the oneTBB library and the CPU limit.") {
 		const auto arguments = get({binary, "."});
-		REQUIRE(arguments.threads == max_threads);
+		const std::size_t cpus = todds::cgroup::get_limits().cpus();
+		REQUIRE(arguments.threads == (cpus == 0UL ? max_threads : std::min(cpus, max_threads)));
 	}
 
 	SECTION("Threads is not a number") {
@@ -763,3 +787,258 @@ TEST_CASE("todds::arguments report", "[arguments]") {
 		REQUIRE(shorter.report);
 	}
 }
+
+TEST_CASE("todds::arguments huge_pages", "[arguments]") {
+	SECTION("The default value of huge_pages is false") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.huge_pages);
+	}
+
+	SECTION("Providing the huge_pages parameter sets its value to true") {
+		const auto arguments = get({binary, "--huge-pages", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.huge_pages);
+		const auto shorter = get({binary, "-hp", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.huge_pages);
+	}
+}
+
+TEST_CASE("todds::arguments background", "[arguments]") {
+	SECTION("The default value of background is false") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.background);
+	}
+
+	SECTION("Providing the background parameter sets its value to true") {
+		const auto arguments = get({binary, "--background", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.background);
+		const auto shorter = get({binary, "-bg", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.background);
+	}
+}
+
+TEST_CASE("todds::arguments cpu_limit", "[arguments]") {
+	SECTION("The CPU limit is disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.cpu_limit == 0U);
+	}
+
+	SECTION("cpu_limit is not a number") {
+		const auto arguments = get({binary, "--cpu-limit", "not_a_number", "."});
+		REQUIRE(has_error(arguments));
+	}
+
+	SECTION("Valid cpu_limit value") {
+		const auto arguments = get({binary, "--cpu-limit", "25", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.cpu_limit == 25U);
+		const auto shorter = get({binary, "-cu", "25", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.cpu_limit == 25U);
+	}
+
+	SECTION("cpu_limit values are clamped to [1, 100]") {
+		REQUIRE(get({binary, "--cpu-limit", "0", "."}).cpu_limit == 1U);
+		REQUIRE(get({binary, "--cpu-limit", "250", "."}).cpu_limit == 100U);
+	}
+}
+
+TEST_CASE("todds::arguments io_limit", "[arguments]") {
+	SECTION("The I/O limit is disabled by default.") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.io_limit == 0U);
+	}
+
+	SECTION("io_limit is not a number") {
+		const auto arguments = get({binary, "--io-limit", "not_a_number", "."});
+		REQUIRE(has_error(arguments));
+	}
+
+	SECTION("Valid io_limit value") {
+		const auto arguments = get({binary, "--io-limit", "40", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.io_limit == 40U);
+		const auto shorter = get({binary, "-il", "40", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.io_limit == 40U);
+	}
+}
+
+TEST_CASE("todds::arguments stats", "[arguments]") {
+	SECTION("The default value of stats is false") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.stats);
+	}
+
+	SECTION("Providing the stats parameter sets its value to true") {
+		const auto arguments = get({binary, "--stats", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.stats);
+		const auto shorter = get({binary, "-s", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.stats);
+	}
+}
+
+TEST_CASE("todds::arguments stats_timeline", "[arguments]") {
+	SECTION("The timeline is not written by default") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.stats_timeline.empty());
+	}
+
+	SECTION("Providing a timeline file also enables stats") {
+		const auto arguments = get({binary, "--stats-timeline", "timeline.csv", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.stats);
+		REQUIRE(arguments.stats_timeline == "timeline.csv");
+		const auto shorter = get({binary, "-stl", "timeline.csv", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.stats_timeline == "timeline.csv");
+	}
+}
+
+TEST_CASE("todds::arguments trace", "[arguments]") {
+	SECTION("Tracing is disabled by default") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.trace.empty());
+	}
+
+	SECTION("Valid trace file") {
+		const auto arguments = get({binary, "--trace", "trace.json", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.trace == "trace.json");
+		const auto shorter = get({binary, "-tr", "trace.json", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.trace == "trace.json");
+	}
+}
+
+TEST_CASE("todds::arguments perf_counters", "[arguments]") {
+	SECTION("The default value of perf_counters is false") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.perf_counters);
+	}
+
+	SECTION("Providing the perf_counters parameter sets its value to true") {
+		const auto arguments = get({binary, "--perf-counters", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.perf_counters);
+		const auto shorter = get({binary, "-pc", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.perf_counters);
+	}
+}
+
+TEST_CASE("todds::arguments report_file", "[arguments]") {
+	SECTION("The file report is disabled by default") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.report_file.empty());
+	}
+
+	SECTION("Valid report file") {
+		const auto arguments = get({binary, "--report-file", "files.csv", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.report_file == "files.csv");
+		const auto shorter = get({binary, "-rf", "files.jsonl", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.report_file == "files.jsonl");
+	}
+}
+
+TEST_CASE("todds::arguments metrics_file", "[arguments]") {
+	SECTION("The metrics file is disabled by default") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.metrics_file.empty());
+		REQUIRE(arguments.metrics_interval == 10U);
+	}
+
+	SECTION("Valid metrics file and interval") {
+		const auto arguments = get({binary, "--metrics-file", "todds.prom", "--metrics-interval", "5", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.metrics_file == "todds.prom");
+		REQUIRE(arguments.metrics_interval == 5U);
+		const auto shorter = get({binary, "-mtf", "todds.prom", "-mti", "0", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.metrics_file == "todds.prom");
+		REQUIRE(shorter.metrics_interval == 1U);
+	}
+
+	SECTION("Invalid interval") {
+		const auto arguments = get({binary, "--metrics-interval", "often", "."});
+		REQUIRE(!is_valid(arguments));
+	}
+}
+
+TEST_CASE("todds::arguments capture_file", "[arguments]") {
+	SECTION("Capturing is disabled by default") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(arguments.capture_file.empty());
+	}
+
+	SECTION("Valid capture file") {
+		const auto arguments = get({binary, "--capture", "dataset.tdc", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.capture_file == "dataset.tdc");
+		const auto shorter = get({binary, "-cap", "dataset.tdc", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.capture_file == "dataset.tdc");
+	}
+}
+
+TEST_CASE("todds::arguments sweep", "[arguments]") {
+	SECTION("Sweeping is disabled by default") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.sweep);
+		REQUIRE(arguments.sweep_target == 40.0);
+		REQUIRE(arguments.sweep_sample == 100U);
+	}
+
+	SECTION("Valid sweep") {
+		const auto arguments = get({binary, "--sweep", "--sweep-target", "45.5", "--sweep-sample", "10", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.sweep);
+		REQUIRE(arguments.sweep_target == 45.5);
+		REQUIRE(arguments.sweep_sample == 10U);
+		REQUIRE(arguments.overwrite);
+		const auto shorter = get({binary, "-sw", "-swt", "30", "-sws", "0", "-on", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.sweep);
+		REQUIRE(shorter.sweep_target == 30.0);
+		REQUIRE(shorter.sweep_sample == 1U);
+		REQUIRE(!shorter.overwrite_new);
+	}
+
+	SECTION("Sweeping PNG files is not supported") {
+		const auto arguments = get({binary, "--sweep", "--format", "png", ".", "output"});
+		REQUIRE(!is_valid(arguments));
+	}
+}
+
+TEST_CASE("todds::arguments metrics", "[arguments]") {
+	SECTION("Error metrics are disabled by default") {
+		const auto arguments = get({binary, "."});
+		REQUIRE(!arguments.error_metrics);
+	}
+
+	SECTION("Valid error metrics") {
+		const auto arguments = get({binary, "--metrics", "--report-file", "report.csv", "."});
+		REQUIRE(is_valid(arguments));
+		REQUIRE(arguments.error_metrics);
+		const auto shorter = get({binary, "-mt", "-rf", "report.jsonl", "."});
+		REQUIRE(is_valid(shorter));
+		REQUIRE(shorter.error_metrics);
+	}
+
+	SECTION("Error metrics require a file report") {
+		const auto arguments = get({binary, "--metrics", "."});
+		REQUIRE(!is_valid(arguments));
+	}
+
+	SECTION("Error metrics are not supported by PNG files") {
+		const auto arguments = get({binary, "--metrics", "--report-file", "report.csv", "--format", "png", ".", "output"});
+		REQUIRE(!is_valid(arguments));
+	}
+}
@@ -0,0 +1,154 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/dds.hpp"
+#include "todds/image_error.hpp"
+#include "todds/mipmap_image.hpp"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+using todds::format::type;
+
+constexpr std::size_t block_pixels = todds::pixel_block_side * todds::pixel_block_side;
+
+constexpr std::uint32_t rgba(std::uint32_t red, std::uint32_t green, std::uint32_t blue, std::uint32_t alpha) {
+	return red | (green << 8U) | (blue << 16U) | (alpha << 24U);
+}
+
+// Smooth gradient whose padding pixels are different from the image, to check that they are ignored.
+void fill_gradient(todds::image& img) {
+	for (std::size_t pixel_y = 0UL; pixel_y < img.padded_height(); ++pixel_y) {
+		for (std::size_t pixel_x = 0UL; pixel_x < img.padded_width(); ++pixel_x) {
+			const bool padding = pixel_x >= img.width() || pixel_y >= img.height();
+			auto pixel = img.get_pixel(pixel_x, pixel_y);
+			pixel[0UL] = static_cast<std::uint8_t>(padding ? 0UL : pixel_x * 8UL);
+			pixel[1UL] = static_cast<std::uint8_t>(padding ? 0UL : pixel_y * 8UL);
+			pixel[2UL] = static_cast<std::uint8_t>(padding ? 0UL : 128UL);
+			pixel[3UL] = static_cast<std::uint8_t>(padding ? 0UL : 255UL - pixel_x * 4UL);
+		}
+	}
+}
+
+} // Anonymous namespace
+
+TEST_CASE("todds::dds::decode BC1 and BC3", "[dds]") {
+	// Red and blue endpoints. The first endpoint is larger, so the block uses four colors.
+	constexpr std::uint64_t colors = 0xF800ULL | (0x001FULL << 16U);
+	// Pixel N uses selector N % 4.
+	constexpr std::uint64_t selectors = 0xE4E4E4E4ULL << 32U;
+	std::array<std::uint32_t, block_pixels> pixels{};
+
+	todds::dds::decode(type::bc1, std::array<std::uint64_t, 1UL>{colors | selectors}, pixels);
+	REQUIRE(pixels[0] == rgba(255U, 0U, 0U, 255U));
+	REQUIRE(pixels[1] == rgba(0U, 0U, 255U, 255U));
+	REQUIRE(pixels[2] == rgba(170U, 0U, 85U, 255U));
+	REQUIRE(pixels[3] == rgba(85U, 0U, 170U, 255U));
+
+	// Swapping the endpoints selects three colors and transparent black in BC1, but not in BC3.
+	constexpr std::uint64_t swapped = 0x001FULL | (0xF800ULL << 16U);
+	todds::dds::decode(type::bc1, std::array<std::uint64_t, 1UL>{swapped | selectors}, pixels);
+	REQUIRE(pixels[2] == rgba(127U, 0U, 127U, 255U));
+	REQUIRE(pixels[3] == 0U);
+
+	// Alpha endpoints 255 and 0 with eight values. Pixel N uses alpha selector N % 8.
+	constexpr std::uint64_t alpha = 0xFFULL | (0xFAC688ULL << 16U) | (0xFAC688ULL << 40U);
+	todds::dds::decode(type::bc3, std::array<std::uint64_t, 2UL>{alpha, swapped | selectors}, pixels);
+	REQUIRE(pixels[0] == rgba(0U, 0U, 255U, 255U));
+	REQUIRE(pixels[1] == rgba(255U, 0U, 0U, 0U));
+	REQUIRE(pixels[2] == rgba(85U, 0U, 170U, 218U));
+	REQUIRE(pixels[15] == rgba(170U, 0U, 85U, 36U));
+}
+
+TEST_CASE("todds::dds::decode BC7", "[dds]") {
+	// Mode 6 block with a single subset, 7 bit endpoints with a p-bit, and 4 bit indices.
+	// Red endpoints are 0 and 127, which become 1 and 255 with their p-bits. Every other endpoint becomes 255.
+	std::uint64_t low = 1ULL << 6U;
+	std::uint32_t position = 7U;
+	const auto write = [&low, &position](std::uint64_t value, std::uint32_t bits) {
+		low |= value << position;
+		position += bits;
+	};
+	write(0U, 7U);
+	for (std::size_t value = 0UL; value < 7UL; ++value) { write(127U, 7U); }
+	write(1U, 1U);
+	REQUIRE(position == 64U);
+	// The second p-bit is the first bit of the high value. Every index is 0 except the one of the last pixel.
+	const std::uint64_t high = 1ULL | (15ULL << 60U);
+	std::array<std::uint32_t, block_pixels> pixels{};
+	todds::dds::decode(type::bc7, std::array<std::uint64_t, 2UL>{low, high}, pixels);
+	REQUIRE(pixels[0] == rgba(1U, 255U, 255U, 255U));
+	REQUIRE(pixels[15] == rgba(255U, 255U, 255U, 255U));
+
+	// Reserved modes decode as transparent black.
+	todds::dds::decode(type::bc7, std::array<std::uint64_t, 2UL>{0ULL, ~0ULL}, pixels);
+	REQUIRE(pixels[0] == 0U);
+}
+
+TEST_CASE("todds::compare", "[dds]") {
+	todds::mipmap_image source(0UL, 30UL, 18UL, false, todds::pixel_layout::blocks);
+	auto& img = source.get_image(0UL);
+	fill_gradient(img);
+	const auto blocks = source.pixel_blocks();
+
+	const auto identical = todds::compare(img, blocks);
+	REQUIRE(identical.pixels == 30U * 18U);
+	REQUIRE(identical.blocks == 8U * 5U);
+	REQUIRE(std::isinf(todds::psnr(identical.mse(true))));
+	REQUIRE(std::abs(identical.mean_ssim(true) - 1.0) < 1.0e-9);
+
+	todds::dds::initialize_encoding(type::bc7, type::bc3);
+	for (const auto format : {type::bc1, type::bc3, type::bc7}) {
+		constexpr auto quality = todds::format::quality::fast;
+		todds::dds_image encoded;
+		switch (format) {
+		case type::bc1: encoded = todds::dds::bc1_encode(quality, false, blocks); break;
+		case type::bc3: encoded = todds::dds::bc3_encode(quality, blocks); break;
+		default: encoded = todds::dds::bc7_encode(todds::dds::bc7_encode_params(quality), blocks); break;
+		}
+		std::vector<std::uint32_t> decoded(blocks.size());
+		todds::dds::decode(format, encoded, decoded);
+		const auto error = todds::compare(img, decoded);
+		REQUIRE(todds::psnr(error.mse(false)) > 30.0);
+		REQUIRE(error.mean_ssim(false) > 0.75);
+		// BC1 does not store alpha.
+		REQUIRE((todds::psnr(error.mse(3UL)) > 30.0) == (format != type::bc1));
+	}
+}
+
+TEST_CASE("todds::dds::add_decode_error", "[dds]") {
+	todds::mipmap_image source(0UL, 30UL, 18UL, false, todds::pixel_layout::blocks);
+	auto& img = source.get_image(0UL);
+	fill_gradient(img);
+	const auto blocks = source.pixel_blocks();
+	todds::dds::initialize_encoding(type::bc7, type::bc3);
+	const auto encoded = todds::dds::bc3_encode(todds::format::quality::fast, blocks);
+	std::vector<std::uint32_t> decoded(blocks.size());
+	todds::dds::decode(type::bc3, encoded, decoded);
+	const auto expected = todds::compare(img, decoded);
+
+	// Measuring the blocks in two halves adds up to the error of the whole image.
+	constexpr std::size_t encoded_block_size = 2UL;
+	const std::size_t half = encoded.size() / encoded_block_size / 2UL;
+	const std::span<const std::uint64_t> first{encoded.data(), half * encoded_block_size};
+	const std::span<const std::uint64_t> second{encoded.data() + first.size(), encoded.size() - first.size()};
+	todds::image_error error{};
+	todds::dds::add_decode_error(type::bc3, first, img, 0UL, img.height(), error);
+	todds::dds::add_decode_error(type::bc3, second, img, half, img.height(), error);
+	REQUIRE(error.squared_error == expected.squared_error);
+	REQUIRE(error.pixels == expected.pixels);
+	REQUIRE(error.blocks == expected.blocks);
+
+	// Rows after the height are not compared.
+	todds::image_error partial{};
+	todds::dds::add_decode_error(type::bc3, encoded, img, 0UL, 6UL, partial);
+	REQUIRE(partial.pixels == 30U * 6U);
+	REQUIRE(partial.blocks == 8U * 2U);
+}
@@ -0,0 +1,39 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/alpha_coverage.hpp"
+#include "todds/mipmap_image.hpp"
+
+#include <cstdint>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+// Opaque pixels of different colors.
+void fill_opaque(todds::image& img) {
+	for (std::size_t pixel_y = 0UL; pixel_y < img.height(); ++pixel_y) {
+		for (std::size_t pixel_x = 0UL; pixel_x < img.width(); ++pixel_x) {
+			auto pixel = img.get_pixel(pixel_x, pixel_y);
+			pixel[0UL] = static_cast<std::uint8_t>(pixel_x * 7UL);
+			pixel[1UL] = static_cast<std::uint8_t>(pixel_y * 5UL);
+			pixel[2UL] = static_cast<std::uint8_t>(pixel_x + pixel_y);
+			pixel[3UL] = 255U;
+		}
+	}
+}
+
+} // Anonymous namespace
+
+TEST_CASE("todds::has_alpha", "[image]") {
+	// Without padding, so every pixel is written by fill_opaque.
+	todds::mipmap_image source(0UL, 12UL, 8UL, false, todds::pixel_layout::blocks);
+	auto& img = source.get_image(0UL);
+	fill_opaque(img);
+	REQUIRE(!todds::has_alpha(source.pixel_blocks()));
+
+	img.get_pixel(11UL, 7UL)[3UL] = 254U;
+	REQUIRE(todds::has_alpha(source.pixel_blocks()));
+}
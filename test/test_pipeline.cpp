@@ -0,0 +1,428 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/capture.hpp"
+#include "todds/format.hpp"
+#include "todds/mipmap_image.hpp"
+#include "todds/png.hpp"
+#include "todds/report.hpp"
+#include "todds/resample.hpp"
+#include "todds/vector.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <oneapi/tbb/parallel_pipeline.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "file_report.hpp"
+#include "filter_decode_png.hpp"
+#include "metrics_file.hpp"
+#include "stage_statistics.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+using todds::filter::type;
+
+// PNG file with an odd width and height, so fix_size adds extra columns and rows.
+todds::vector<std::uint8_t> gradient_png(std::size_t width, std::size_t height) {
+	auto source = std::make_unique<todds::mipmap_image>(0UL, width, height, false);
+	auto& img = source->get_image(0UL);
+	for (std::size_t pixel_y = 0UL; pixel_y < height; ++pixel_y) {
+		for (std::size_t pixel_x = 0UL; pixel_x < width; ++pixel_x) {
+			auto pixel = img.get_pixel(pixel_x, pixel_y);
+			pixel[0UL] = static_cast<std::uint8_t>(pixel_x * 20UL);
+			pixel[1UL] = static_cast<std::uint8_t>(pixel_y * 30UL);
+			pixel[2UL] = static_cast<std::uint8_t>(255UL - pixel_y * 20UL);
+			pixel[3UL] = 255U;
+		}
+	}
+	return todds::png::encode("gradient.png", std::move(source));
+}
+
+// Runs a PNG file through the decoding filter of the pipeline.
+std::unique_ptr<todds::mipmap_image> decode_filter(
+	const todds::vector<std::uint8_t>& png, bool vflip, std::uint16_t scale, type filter) {
+	using namespace todds::pipeline::impl;
+	todds::vector<file_data> files_data(1UL);
+	todds::pipeline::paths_vector paths{};
+	paths.emplace_back("gradient.png", "gradient.dds");
+	todds::report_queue updates;
+	stage_statistics statistics{false, false, 1UL};
+
+	bool loaded{};
+	std::unique_ptr<todds::mipmap_image> result{};
+	oneapi::tbb::parallel_pipeline(1UL,
+		oneapi::tbb::make_filter<void, png_file>(oneapi::tbb::filter_mode::serial_in_order,
+			[&png, &loaded](oneapi::tbb::flow_control& control) {
+				png_file file{todds::pooled_vector<std::uint8_t>(png.begin(), png.end(),
+												todds::pooled_allocator<std::uint8_t>(todds::allocations::category::png_buffers)),
+					0UL};
+				if (loaded) { control.stop(); }
+				loaded = true;
+				return file;
+			}) &
+			decode_png_filter(
+				files_data, paths, vflip, true, scale, 0U, filter, todds::pixel_layout::rows, updates, statistics) &
+			oneapi::tbb::make_filter<std::unique_ptr<todds::mipmap_image>, void>(oneapi::tbb::filter_mode::serial_in_order,
+				[&result](std::unique_ptr<todds::mipmap_image> img) { result = std::move(img); }));
+	return result;
+}
+
+// Measurements of a file with a quote and a backslash in its name.
+void fill_file_data(todds::pipeline::impl::file_data& data) {
+	data.width = 3UL;
+	data.height = 5UL;
+	data.mipmaps = 2UL;
+	data.format = todds::format::type::bc1;
+	data.numa_node = 1UL;
+	data.thread = 2UL;
+	data.input_bytes = 100UL;
+	data.output_bytes = 200UL;
+	data.solid_blocks = 7UL;
+	data.start = std::chrono::steady_clock::now();
+}
+
+todds::vector<std::string> read_lines(const boost::filesystem::path& path) {
+	todds::vector<std::string> result;
+	boost::nowide::ifstream input{path};
+	std::string line;
+	while (std::getline(input, line)) { result.push_back(line); }
+	return result;
+}
+
+// Returns true if every text appears in the line in the same order.
+bool in_order(std::string_view line, std::initializer_list<std::string_view> texts) {
+	std::size_t position{};
+	for (const std::string_view text : texts) {
+		position = line.find(text, position);
+		if (position == std::string_view::npos) { return false; }
+		position += text.size();
+	}
+	return true;
+}
+
+// Image using pixel_layout::blocks, filled with a pattern which depends on its file index, including its padding.
+std::unique_ptr<todds::mipmap_image> capture_image(std::size_t file_index, std::size_t width, std::size_t height) {
+	auto result = std::make_unique<todds::mipmap_image>(file_index, width, height, false, todds::pixel_layout::blocks);
+	const auto data = result->get_image(0UL).data();
+	for (std::size_t index = 0UL; index < data.size(); ++index) {
+		data[index] = static_cast<std::uint8_t>(index * 3UL + file_index);
+	}
+	return result;
+}
+
+// Replaces a 64-bit value of a file.
+void overwrite_value(const boost::filesystem::path& path, std::size_t position, std::uint64_t value) {
+	boost::nowide::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+	file.seekp(static_cast<std::streamoff>(position));
+	file.write(reinterpret_cast<const char*>(&value), static_cast<std::streamsize>(sizeof(value)));
+}
+
+// Name of the metric of a sample line, which ends before its labels or its value.
+std::string_view metric_name(std::string_view line) { return line.substr(0UL, line.find_first_of("{ ")); }
+
+} // Anonymous namespace
+
+TEST_CASE("todds::pipeline decode_png scaled with vflip and fix_size", "[pipeline]") {
+	const auto png = gradient_png(10UL, 7UL);
+
+	for (const type filter : {type::nearest, type::linear, type::cubic, type::area, type::lanczos}) {
+		std::size_t width{};
+		std::size_t height{};
+		const auto full = todds::png::decode(0UL, "gradient.png", png, true, true, width, height, false,
+			todds::pixel_layout::rows);
+		REQUIRE(width == 12UL);
+		REQUIRE(height == 8UL);
+		todds::mipmap_image expected(0UL, 9UL, 6UL, false);
+		todds::resample::resample(full->get_image(0UL), expected.get_image(0UL), filter, 0.0);
+
+		const auto scaled = decode_filter(png, true, 75U, filter);
+		REQUIRE(scaled != nullptr);
+		const auto& img = scaled->get_image(0UL);
+		REQUIRE(img.width() == 9UL);
+		REQUIRE(img.height() == 6UL);
+		// Resampled rows are accumulated in a different order, so values may be rounded differently.
+		const auto actual_data = img.data();
+		const auto expected_data = expected.get_image(0UL).data();
+		for (std::size_t index = 0UL; index < actual_data.size(); ++index) {
+			REQUIRE(std::abs(actual_data[index] - expected_data[index]) <= 1);
+		}
+	}
+}
+
+TEST_CASE("todds::pipeline file_report quote", "[pipeline]") {
+	using todds::pipeline::impl::quote;
+
+	SECTION("CSV doubles quotes and keeps backslashes") { REQUIRE(quote(R"(a"b\c)", true) == R"("a""b\c")"); }
+
+	SECTION("JSON escapes quotes and backslashes") { REQUIRE(quote(R"(a"b\c)", false) == R"("a\"b\\c")"); }
+
+	SECTION("JSON escapes control characters") {
+		REQUIRE(quote("a\nb\tc\x01" "d\x1f", false) == R"("a\nb\tc\u0001d\u001f")");
+	}
+
+	SECTION("CSV keeps control characters inside the quotes") { REQUIRE(quote("a\nb\tc", true) == "\"a\nb\tc\""); }
+
+	SECTION("Other characters are not escaped") { REQUIRE(quote("ñ/é", false) == "\"ñ/é\""); }
+}
+
+TEST_CASE("todds::pipeline file_report solid_blocks", "[pipeline]") {
+	constexpr std::size_t block_pixels = 16UL;
+	todds::vector<std::uint32_t> blocks(block_pixels * 3UL + 5UL, 0xFF00FF00U);
+	// The second block has a different pixel, and the incomplete block at the end is ignored.
+	blocks[block_pixels + 15UL] = 0xFF00FF01U;
+	REQUIRE(todds::pipeline::impl::solid_blocks(blocks) == 2UL);
+	REQUIRE(todds::pipeline::impl::solid_blocks(std::span<const std::uint32_t>{}) == 0UL);
+}
+
+TEST_CASE("todds::pipeline file_report", "[pipeline]") {
+	const auto directory = boost::filesystem::temp_directory_path() / "todds_test_file_report";
+	boost::filesystem::create_directories(directory);
+	const auto file = boost::filesystem::path{"textures"} / R"(a"b\c.png)";
+	todds::pipeline::impl::file_data data;
+	fill_file_data(data);
+	const std::string format{todds::format::name(todds::format::type::bc1)};
+
+	SECTION("CSV files start with a header, followed by a record for each file") {
+		const auto path = directory / "report.csv";
+		{
+			todds::pipeline::impl::file_report report{path};
+			REQUIRE(report.enabled());
+			REQUIRE(!report.errors());
+			report.write(file, data);
+			report.write(file, data);
+			REQUIRE(report.good());
+		}
+		const auto lines = read_lines(path);
+		REQUIRE(lines.size() == 3UL);
+		REQUIRE(lines[0UL] == "file,width,height,mipmaps,format,numa_node,thread,input_bytes,output_bytes,load_ms,"
+													 "decode_ms,scale_ms,mipmap_ms,encode_ms,save_ms,stream_ms,solid_blocks,total_ms");
+		const std::string prefix =
+			R"("textures/a""b\c.png",3,5,2,)" + format + ",1,2,100,200,0.000,0.000,0.000,0.000,0.000,0.000,0.000,7,";
+		REQUIRE(lines[1UL].starts_with(prefix));
+		REQUIRE(lines[2UL].starts_with(prefix));
+	}
+
+	SECTION("CSV files with errors add the error fields at the end of the header") {
+		const auto path = directory / "errors.csv";
+		{ const todds::pipeline::impl::file_report report{path, true}; }
+		const auto lines = read_lines(path);
+		REQUIRE(lines.size() == 1UL);
+		REQUIRE(lines[0UL].ends_with(
+			",solid_blocks,total_ms,rmse,psnr,red_rmse,green_rmse,blue_rmse,alpha_rmse,mip_rmse,mip_psnr"));
+	}
+
+	SECTION("Other files use JSON Lines") {
+		const auto path = directory / "report.jsonl";
+		{
+			todds::pipeline::impl::file_report report{path};
+			report.write(file, data);
+			report.write(file, data);
+			REQUIRE(report.good());
+		}
+		const auto lines = read_lines(path);
+		REQUIRE(lines.size() == 2UL);
+		for (const auto& line : lines) {
+			REQUIRE(line.starts_with(R"({"file":"textures/a\"b\\c.png","width":3,"height":5,"mipmaps":2,)"
+															 R"("format":")" +
+															 format + R"(","numa_node":1,"thread":2,"input_bytes":100,"output_bytes":200,)"));
+			REQUIRE(in_order(line, {R"("load_ms":0.000,)", R"("decode_ms":0.000,)", R"("scale_ms":0.000,)",
+				R"("mipmap_ms":0.000,)", R"("encode_ms":0.000,)", R"("save_ms":0.000,)", R"("stream_ms":0.000,)",
+				R"("solid_blocks":7,)", R"("total_ms":)"}));
+			REQUIRE(line.ends_with("}"));
+		}
+	}
+
+	SECTION("An empty path disables the report") {
+		todds::pipeline::impl::file_report report{boost::filesystem::path{}};
+		REQUIRE(!report.enabled());
+		report.write(file, data);
+		REQUIRE(report.good());
+	}
+
+	boost::filesystem::remove_all(directory);
+}
+
+TEST_CASE("todds::pipeline metrics_text", "[pipeline]") {
+	using todds::pipeline::impl::stage;
+	todds::pipeline::impl::stage_statistics statistics{false, true, 1UL};
+	statistics.add_busy(stage::load, std::chrono::milliseconds{1500});
+	statistics.add_read(10UL);
+	statistics.add_written(todds::format::type::bc1, 20UL, 4UL);
+	todds::report_queue updates;
+	updates.add(todds::progress_type::encoded_textures, 3UL);
+	updates.add(todds::progress_type::failed_textures);
+
+	const todds::string text = todds::pipeline::impl::metrics_text(statistics, updates);
+	todds::vector<std::string> lines;
+	for (std::size_t start = 0UL, end = 0UL; start < text.size(); start = end + 1UL) {
+		end = text.find('\n', start);
+		lines.emplace_back(text.substr(start, end - start));
+	}
+
+	SECTION("Every metric has a help and a type line, and samples use the name of their metric") {
+		todds::vector<std::string> names;
+		std::string current;
+		for (std::size_t index = 0UL; index + 1UL < lines.size(); ++index) {
+			const std::string_view line = lines[index];
+			if (line.starts_with("# HELP ")) {
+				current = metric_name(line.substr(7UL));
+				REQUIRE(lines[index + 1UL].starts_with("# TYPE " + current + " "));
+				if (lines[index + 1UL].ends_with(" counter")) { REQUIRE(current.ends_with("_total")); }
+				names.push_back(current);
+				++index;
+				continue;
+			}
+			REQUIRE(!line.starts_with("#"));
+			REQUIRE(metric_name(line) == current);
+		}
+		const todds::vector<std::string> expected{"todds_files_total", "todds_io_bytes_total",
+			"todds_stage_busy_seconds_total", "todds_filter_files", "todds_tokens_in_flight", "todds_tokens_waiting",
+			"todds_blocks_encoded_total", "todds_resident_memory_bytes"};
+		REQUIRE(names == expected);
+	}
+
+	SECTION("Counters use the _total suffix in their type line") {
+		for (const auto& line : lines) {
+			if (line.ends_with(" counter")) {
+				REQUIRE(line.starts_with("# TYPE "));
+				REQUIRE(line.ends_with("_total counter"));
+			}
+		}
+		REQUIRE(std::find(lines.begin(), lines.end(), "# TYPE todds_files_total counter") != lines.end());
+	}
+
+	SECTION("Samples contain the current totals") {
+		const todds::vector<std::string> expected{R"(todds_files_total{result="encoded"} 3)",
+			R"(todds_files_total{result="failed"} 1)", R"(todds_io_bytes_total{direction="read"} 10)",
+			R"(todds_io_bytes_total{direction="written"} 20)", R"(todds_stage_busy_seconds_total{stage="load"} 1.500000)",
+			R"(todds_blocks_encoded_total{format="bc1"} 4)", R"(todds_blocks_encoded_total{format="bc7"} 0)",
+			"todds_tokens_in_flight 0"};
+		for (const auto& line : expected) { REQUIRE(std::find(lines.begin(), lines.end(), line) != lines.end()); }
+	}
+
+	SECTION("The text ends with a single # EOF line") {
+		REQUIRE(text.ends_with("\n# EOF\n"));
+		REQUIRE(std::count(lines.begin(), lines.end(), "# EOF") == 1);
+	}
+}
+
+TEST_CASE("todds::pipeline metrics_file", "[pipeline]") {
+	const auto directory = boost::filesystem::temp_directory_path() / "todds_test_metrics_file";
+	boost::filesystem::create_directories(directory);
+	const auto path = directory / "todds.prom";
+	auto temporary = path;
+	temporary += ".tmp";
+	todds::pipeline::impl::stage_statistics statistics{false, true, 1UL};
+	todds::report_queue updates;
+	updates.add(todds::progress_type::encoded_textures, 2UL);
+
+	SECTION("Stopping replaces the previous version of the file with the final totals") {
+		{
+			boost::nowide::ofstream previous{path};
+			previous << "todds_files_total{result=\"encoded\"} 1\n";
+		}
+		todds::pipeline::impl::metrics_file metrics{path, std::chrono::seconds{3600}, statistics, updates};
+		REQUIRE(metrics.enabled());
+		metrics.stop();
+		REQUIRE(metrics.good());
+		REQUIRE(!boost::filesystem::exists(temporary));
+		const auto lines = read_lines(path);
+		REQUIRE(std::find(lines.begin(), lines.end(), R"(todds_files_total{result="encoded"} 2)") != lines.end());
+		REQUIRE(std::find(lines.begin(), lines.end(), R"(todds_files_total{result="encoded"} 1)") == lines.end());
+		REQUIRE(lines.back() == "# EOF");
+	}
+
+	SECTION("An empty path disables the file") {
+		todds::pipeline::impl::metrics_file metrics{
+			boost::filesystem::path{}, std::chrono::seconds{1}, statistics, updates};
+		REQUIRE(!metrics.enabled());
+		metrics.stop();
+		REQUIRE(metrics.good());
+	}
+
+	boost::filesystem::remove_all(directory);
+}
+
+TEST_CASE("todds::capture", "[pipeline]") {
+	const auto directory = boost::filesystem::temp_directory_path() / "todds_test_capture";
+	boost::filesystem::create_directories(directory);
+	const auto path = directory / "images.capture";
+	// Widths and heights which are not multiples of 4 are padded in pixel_layout::blocks.
+	const auto first = capture_image(5UL, 6UL, 5UL);
+	const auto second = capture_image(2UL, 4UL, 4UL);
+	{
+		todds::capture::writer writer{path};
+		REQUIRE(writer.enabled());
+		writer.write(*first);
+		writer.write(*second);
+		writer.close();
+		REQUIRE(writer.good());
+	}
+
+	SECTION("Images are read back as they were written") {
+		const todds::capture::reader reader{path};
+		REQUIRE(reader.size() == 2UL);
+		std::size_t index{};
+		for (const auto* written : {first.get(), second.get()}) {
+			const auto& expected = written->get_image(0UL);
+			const auto img = reader.get_image(index);
+			REQUIRE(reader.file_index(index) == written->file_index());
+			REQUIRE(img.width() == expected.width());
+			REQUIRE(img.height() == expected.height());
+			REQUIRE(img.layout() == todds::pixel_layout::blocks);
+			const auto expected_data = expected.data();
+			const auto data = img.data();
+			REQUIRE(data.size() == expected_data.size());
+			REQUIRE(std::equal(data.begin(), data.end(), expected_data.begin()));
+			++index;
+		}
+	}
+
+	SECTION("Files with another magic number are rejected") {
+		overwrite_value(path, 0UL, 0x474E5089ULL);
+		REQUIRE_THROWS_AS(todds::capture::reader{path}, std::runtime_error);
+	}
+
+	SECTION("Files with another version are rejected") {
+		overwrite_value(path, sizeof(std::uint64_t), todds::capture::version + 1ULL);
+		REQUIRE_THROWS_AS(todds::capture::reader{path}, std::runtime_error);
+	}
+
+	SECTION("Files without a complete header are rejected") {
+		boost::filesystem::resize_file(path, todds::capture::alignment / 2UL);
+		REQUIRE_THROWS_AS(todds::capture::reader{path}, std::runtime_error);
+	}
+
+	SECTION("Files with a truncated image are rejected") {
+		boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - todds::capture::alignment);
+		REQUIRE_THROWS_AS(todds::capture::reader{path}, std::runtime_error);
+	}
+
+	SECTION("Files with fewer records than images are rejected") {
+		overwrite_value(path, 2UL * sizeof(std::uint64_t), 3ULL);
+		REQUIRE_THROWS_AS(todds::capture::reader{path}, std::runtime_error);
+	}
+
+	SECTION("Records with a size which does not match their dimensions are rejected") {
+		// The size of the first record follows its file index, width and height.
+		overwrite_value(path, todds::capture::alignment + 3UL * sizeof(std::uint64_t), 16UL);
+		REQUIRE_THROWS_AS(todds::capture::reader{path}, std::runtime_error);
+	}
+
+	boost::filesystem::remove_all(directory);
+}
@@ -0,0 +1,60 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/report.hpp"
+#include "todds/vector.hpp"
+
+#include <thread>
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("todds::report_queue", "[report]") {
+	using todds::progress_type;
+	using todds::report_type;
+	todds::report_queue updates;
+
+	SECTION("Progress counters are aggregated from every thread") {
+		constexpr std::size_t thread_count = 80UL;
+		constexpr std::size_t additions = 1000UL;
+		{
+			todds::vector<std::jthread> threads;
+			for (std::size_t index = 0UL; index < thread_count; ++index) {
+				threads.emplace_back([&updates] {
+					for (std::size_t addition = 0UL; addition < additions; ++addition) {
+						updates.add(progress_type::encoded_textures);
+					}
+				});
+			}
+		}
+		REQUIRE(updates.progress(progress_type::encoded_textures) == thread_count * additions);
+		REQUIRE(updates.progress(progress_type::retrieved_entries) == 0UL);
+		REQUIRE(updates.empty());
+	}
+
+	SECTION("Waiting returns when a report is queued") {
+		std::jthread producer{[&updates] { updates.emplace(report_type::pipeline_error, "error"); }};
+		REQUIRE(updates.wait());
+		todds::report update{};
+		REQUIRE(updates.try_pop(update));
+		REQUIRE(update.type() == report_type::pipeline_error);
+		REQUIRE(update.data() == "error");
+	}
+
+	SECTION("Waiting returns false after finishing, keeping queued reports") {
+		updates.emplace(report_type::process_started, 4UL);
+		std::jthread producer{[&updates] { updates.finish(); }};
+		producer.join();
+		REQUIRE(!updates.wait());
+		REQUIRE(!updates.wait_for(std::chrono::milliseconds{0}));
+		todds::report update{};
+		REQUIRE(updates.try_pop(update));
+		REQUIRE(update.value() == 4UL);
+	}
+
+	SECTION("Waiting with a timeout returns true if nothing happens") {
+		REQUIRE(updates.wait_for(std::chrono::milliseconds{1}));
+		REQUIRE(updates.empty());
+	}
+}
@@ -0,0 +1,195 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public License, v. 2.0. If a copy of the MPL was not
+ * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "todds/mipmap_image.hpp"
+#include "todds/resample.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+
+using todds::filter::type;
+
+constexpr std::array<type, 5U> all_filters{type::nearest, type::linear, type::cubic, type::area, type::lanczos};
+
+void fill_gradient(todds::image& img) {
+	for (std::size_t pixel_y = 0UL; pixel_y < img.height(); ++pixel_y) {
+		for (std::size_t pixel_x = 0UL; pixel_x < img.width(); ++pixel_x) {
+			auto pixel = img.get_pixel(pixel_x, pixel_y);
+			pixel[0UL] = static_cast<std::uint8_t>(pixel_x * 7UL);
+			pixel[1UL] = static_cast<std::uint8_t>(pixel_y * 5UL);
+			pixel[2UL] = static_cast<std::uint8_t>(pixel_x + pixel_y);
+			pixel[3UL] = 255U;
+		}
+	}
+}
+
+// Resamples a single row whose pixels have the same value in every channel, and returns the red channel.
+template <std::size_t dst_width, std::size_t src_width>
+std::array<int, dst_width> resample_row(const std::array<std::uint8_t, src_width>& values, type filter) {
+	todds::mipmap_image source(0UL, src_width, 1UL, false);
+	auto& src = source.get_image(0UL);
+	for (std::size_t pixel = 0UL; pixel < src_width; ++pixel) {
+		std::fill_n(&src.data()[pixel * todds::image::bytes_per_pixel], todds::image::bytes_per_pixel, values[pixel]);
+	}
+	todds::mipmap_image destination(0UL, dst_width, 1UL, false);
+	todds::resample::resample(src, destination.get_image(0UL), filter, 0.0);
+	std::array<int, dst_width> result{};
+	for (std::size_t pixel = 0UL; pixel < dst_width; ++pixel) {
+		result[pixel] = destination.get_image(0UL).get_pixel(pixel, 0UL)[0UL];
+	}
+	return result;
+}
+
+} // Anonymous namespace
+
+TEST_CASE("todds::resample::get_plan", "[resample]") {
+	using todds::resample::get_plan;
+	const todds::resample::plan_key key{64UL, 32UL, 32UL, 16UL, type::lanczos, 0.55};
+	const auto plan = get_plan(key);
+	REQUIRE(plan == get_plan(key));
+	REQUIRE(plan->horizontal().start.size() == key.dst_width);
+	REQUIRE(plan->vertical().start.size() == key.dst_height);
+
+	auto other_key = key;
+	other_key.blur = 0.0;
+	REQUIRE(plan != get_plan(other_key));
+}
+
+TEST_CASE("todds::resample::resample identity", "[resample]") {
+	todds::mipmap_image source(0UL, 13UL, 9UL, false);
+	fill_gradient(source.get_image(0UL));
+
+	for (const type filter : all_filters) {
+		todds::mipmap_image destination(0UL, 13UL, 9UL, false);
+		todds::resample::resample(source.get_image(0UL), destination.get_image(0UL), filter, 0.0);
+		const auto src_data = source.get_image(0UL).data();
+		const auto dst_data = destination.get_image(0UL).data();
+		REQUIRE(std::equal(src_data.begin(), src_data.end(), dst_data.begin()));
+	}
+}
+
+TEST_CASE("todds::resample::resample solid color", "[resample]") {
+	todds::mipmap_image source(0UL, 37UL, 21UL, true);
+	auto& first = source.get_image(0UL);
+	for (std::size_t index = 0UL; index < first.data().size(); ++index) {
+		first.data()[index] = static_cast<std::uint8_t>(10UL + index % todds::image::bytes_per_pixel);
+	}
+
+	for (const type filter : all_filters) {
+		for (std::size_t level = 1UL; level < source.mipmap_count(); ++level) {
+			todds::resample::resample(source.get_image(level - 1UL), source.get_image(level), filter, 0.55);
+		}
+		for (std::size_t level = 1UL; level < source.mipmap_count(); ++level) {
+			const auto data = source.get_image(level).data();
+			for (std::size_t index = 0UL; index < data.size(); ++index) {
+				REQUIRE(data[index] == 10UL + index % todds::image::bytes_per_pixel);
+			}
+		}
+	}
+}
+
+TEST_CASE("todds::resample::resample area", "[resample]") {
+	todds::mipmap_image source(0UL, 2UL, 2UL, true);
+	auto& first = source.get_image(0UL);
+	constexpr std::array<std::uint8_t, 4U> values{0U, 100U, 200U, 4U};
+	for (std::size_t pixel = 0UL; pixel < values.size(); ++pixel) {
+		std::fill_n(&first.data()[pixel * todds::image::bytes_per_pixel], todds::image::bytes_per_pixel, values[pixel]);
+	}
+
+	auto& second = source.get_image(1UL);
+	todds::resample::resample(first, second, type::area, 0.0);
+	REQUIRE(second.get_pixel(0UL, 0UL)[0UL] == 76U);
+}
+
+// Values computed by hand from the cv::resize kernels. Weights are stored as floats, so a difference of one is allowed.
+TEST_CASE("todds::resample::resample filters", "[resample]") {
+	const auto check = [](const auto& result, const auto& expected) {
+		for (std::size_t pixel = 0UL; pixel < result.size(); ++pixel) {
+			REQUIRE(std::abs(result[pixel] - expected[pixel]) <= 1);
+		}
+	};
+	constexpr std::array<std::uint8_t, 4UL> four{0U, 40U, 80U, 200U};
+
+	// Downscaling by two. Destination pixel N is centered between source pixels 2N and 2N + 1.
+	check(resample_row<2UL>(four, type::nearest), std::array{0, 80});
+	check(resample_row<2UL>(four, type::linear), std::array{20, 140});
+	// Cubic weights are -0.09375, 0.59375, 0.59375, -0.09375, and borders are replicated.
+	check(resample_row<2UL>(four, type::cubic), std::array{16, 144});
+	check(resample_row<2UL>(four, type::area), std::array{20, 140});
+	// Normalized lanczos weights over eight taps: 20.90 and 142.87.
+	check(resample_row<2UL>(four, type::lanczos), std::array{21, 143});
+
+	// Upscaling by two.
+	constexpr std::array<std::uint8_t, 2UL> two{0U, 200U};
+	check(resample_row<4UL>(two, type::nearest), std::array{0, 0, 200, 200});
+	check(resample_row<4UL>(two, type::linear), std::array{0, 50, 150, 200});
+	// Unlike cv::INTER_AREA, which interpolates linearly when upscaling, area upscaling repeats each source pixel.
+	check(resample_row<4UL>(two, type::area), std::array{0, 0, 200, 200});
+}
+
+TEST_CASE("todds::resample::row_resampler", "[resample]") {
+	todds::mipmap_image source(0UL, 40UL, 30UL, false);
+	fill_gradient(source.get_image(0UL));
+	const auto& img = source.get_image(0UL);
+
+	todds::mipmap_image expected(0UL, 17UL, 70UL, false);
+	todds::resample::resample(img, expected.get_image(0UL), type::cubic, 1.0);
+
+	std::size_t next_row{};
+	bool rows_match = true;
+	todds::resample::row_resampler resampler{
+		todds::resample::get_plan({img.width(), img.height(), 17UL, 70UL, type::cubic, 1.0}),
+		[&](std::size_t row, std::span<const std::uint8_t> data) {
+			rows_match = rows_match && row == next_row &&
+									 std::equal(data.begin(), data.end(), &expected.get_image(0UL).row_start(row));
+			++next_row;
+		}};
+	for (std::size_t row = 0UL; row < img.height(); ++row) {
+		REQUIRE(!resampler.finished());
+		resampler.push_row({&img.row_start(row), img.width() * todds::image::bytes_per_pixel});
+	}
+	REQUIRE(resampler.finished());
+	REQUIRE(rows_match);
+	REQUIRE(next_row == 70UL);
+}
+
+TEST_CASE("todds::resample::resample pixel layouts", "[resample]") {
+	todds::mipmap_image source(0UL, 13UL, 9UL, false);
+	fill_gradient(source.get_image(0UL));
+	const auto& src = source.get_image(0UL);
+
+	todds::mipmap_image blocks(0UL, 13UL, 9UL, false, todds::pixel_layout::blocks);
+	auto& dst = blocks.get_image(0UL);
+	todds::resample::resample(src, dst, type::nearest, 0.0);
+	REQUIRE(dst.padded_width() == 16UL);
+	REQUIRE(dst.padded_height() == 12UL);
+	REQUIRE(blocks.pixel_blocks().size() == 16UL * 12UL);
+
+	for (std::size_t pixel_y = 0UL; pixel_y < dst.padded_height(); ++pixel_y) {
+		for (std::size_t pixel_x = 0UL; pixel_x < dst.padded_width(); ++pixel_x) {
+			// Padding pixels repeat the last column and the last row.
+			const auto expected = src.get_pixel(std::min(pixel_x, 12UL), std::min(pixel_y, 8UL));
+			const auto pixel = dst.get_pixel(pixel_x, pixel_y);
+			REQUIRE(std::equal(expected.begin(), expected.end(), pixel.begin()));
+		}
+	}
+
+	// The second pixel of the first block is the second pixel of the first row.
+	const auto* first_block = reinterpret_cast<const std::uint8_t*>(blocks.pixel_blocks().data());
+	REQUIRE(std::equal(first_block + 4UL, first_block + 8UL, src.get_pixel(1UL, 0UL).begin()));
+	// The fifth pixel of the first block is the first pixel of the second row.
+	REQUIRE(std::equal(first_block + 16UL, first_block + 20UL, src.get_pixel(0UL, 1UL).begin()));
+
+	todds::mipmap_image rows(0UL, 13UL, 9UL, false);
+	todds::resample::resample(dst, rows.get_image(0UL), type::nearest, 0.0);
+	const auto src_data = src.data();
+	const auto rows_data = rows.get_image(0UL).data();
+	REQUIRE(std::equal(src_data.begin(), src_data.end(), rows_data.begin()));
+}
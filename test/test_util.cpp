@@ -3,8 +3,21 @@
  * distributed with this file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 
+#include "todds/allocations.hpp"
+#include "todds/buffer_pool.hpp"
+#include "todds/cgroup.hpp"
+#include "todds/histogram.hpp"
+#include "todds/perf.hpp"
 #include "todds/string.hpp"
+#include "todds/thread_registry.hpp"
+#include "todds/trace.hpp"
 #include "todds/util.hpp"
+#include "todds/vector.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <thread>
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -24,3 +37,312 @@ TEST_CASE("todds::string", "[string]") {
 	const string upper = "SOME STRING DATA";
 	REQUIRE(to_upper_copy(lower) == upper);
 }
+
+TEST_CASE("todds::buffer_pool", "[util]") {
+	namespace buffer_pool = todds::buffer_pool;
+	constexpr std::size_t size = 3UL * 1024UL * 1024UL;
+	buffer_pool::trim();
+	const auto before = buffer_pool::get_statistics();
+
+	void* first = buffer_pool::allocate(size);
+	static_cast<char*>(first)[size - 1UL] = 'a';
+	buffer_pool::deallocate(first, size);
+	REQUIRE(buffer_pool::get_statistics().cached_bytes >= size);
+
+	// Buffers of the same size class are recycled.
+	void* second = buffer_pool::allocate(size - 1000UL);
+	REQUIRE(second == first);
+	const auto after = buffer_pool::get_statistics();
+	REQUIRE(after.hits == before.hits + 1UL);
+	REQUIRE(after.misses == before.misses + 1UL);
+	buffer_pool::deallocate(second, size - 1000UL);
+
+	// Small buffers are not pooled.
+	void* small = buffer_pool::allocate(buffer_pool::minimum_pooled_size);
+	buffer_pool::deallocate(small, buffer_pool::minimum_pooled_size);
+	REQUIRE(buffer_pool::get_statistics().misses == after.misses);
+
+	buffer_pool::trim();
+	REQUIRE(buffer_pool::get_statistics().cached_bytes == before.cached_bytes);
+}
+
+TEST_CASE("todds::buffer_pool huge pages", "[util]") {
+	namespace buffer_pool = todds::buffer_pool;
+	// Falls back to regular pages if huge pages are not available, so the buffer must always be usable.
+	constexpr std::size_t size = 9UL * 1024UL * 1024UL;
+	buffer_pool::set_huge_pages(true);
+	auto* buffer = static_cast<std::uint8_t*>(buffer_pool::allocate(size));
+	REQUIRE(buffer != nullptr);
+	std::fill(buffer, buffer + size, std::uint8_t{1U});
+	REQUIRE(buffer[size - 1UL] == 1U);
+	buffer_pool::deallocate(buffer, size);
+	buffer_pool::set_huge_pages(false);
+	buffer_pool::trim();
+}
+
+TEST_CASE("todds::buffer_pool NUMA nodes", "[util]") {
+	namespace buffer_pool = todds::buffer_pool;
+	constexpr std::size_t size = 5UL * 1024UL * 1024UL;
+	buffer_pool::trim();
+
+	// Buffers released by a node are only recycled by the same node.
+	buffer_pool::set_numa_node(1UL);
+	void* first = buffer_pool::allocate(size);
+	buffer_pool::deallocate(first, size);
+	buffer_pool::set_numa_node(0UL);
+	const auto before = buffer_pool::get_statistics();
+	void* second = buffer_pool::allocate(size);
+	REQUIRE(buffer_pool::get_statistics().misses == before.misses + 1UL);
+	buffer_pool::deallocate(second, size);
+
+	buffer_pool::set_numa_node(1UL);
+	void* third = buffer_pool::allocate(size);
+	REQUIRE(third == first);
+	buffer_pool::deallocate(third, size);
+
+	buffer_pool::set_numa_node(0UL);
+	buffer_pool::trim();
+}
+
+TEST_CASE("todds::pooled_vector", "[util]") {
+	// Values are default-initialized unless a value is provided.
+	const todds::pooled_vector<std::uint8_t> buffer(todds::buffer_pool::minimum_pooled_size * 2UL);
+#if !defined(NDEBUG)
+	REQUIRE(std::all_of(buffer.cbegin(), buffer.cend(), [](std::uint8_t value) {
+		return value == todds::buffer_pool::poison_byte;
+	}));
+#endif
+	const todds::pooled_vector<std::uint32_t> values(todds::buffer_pool::minimum_pooled_size, 7U);
+	REQUIRE(std::all_of(values.cbegin(), values.cend(), [](std::uint32_t value) { return value == 7U; }));
+}
+
+TEST_CASE("todds::allocations", "[util]") {
+	namespace allocations = todds::allocations;
+	using allocations::category;
+	const auto get = [](category type) {
+		return allocations::get_statistics().categories[static_cast<std::size_t>(type)];
+	};
+	constexpr std::size_t size = 1000UL;
+
+	todds::pooled_vector<std::uint32_t> ignored(size, todds::pooled_allocator<std::uint32_t>(category::dds_output));
+	allocations::enable();
+	REQUIRE(allocations::enabled());
+	{
+		todds::pooled_vector<std::uint32_t> first(size, todds::pooled_allocator<std::uint32_t>(category::dds_output));
+		const todds::pooled_vector<std::uint8_t> second(size, todds::pooled_allocator<std::uint8_t>(category::dds_output));
+		const todds::pooled_vector<std::uint8_t> other(size);
+		REQUIRE(get(category::dds_output).allocations == 2UL);
+		REQUIRE(get(category::dds_output).live_bytes == size * sizeof(std::uint32_t) + size);
+		REQUIRE(get(category::other).live_bytes == size);
+
+		// Moved memory keeps the category in which it was allocated.
+		todds::pooled_vector<std::uint32_t> moved{};
+		moved = std::move(first);
+		moved.clear();
+		moved.shrink_to_fit();
+		REQUIRE(get(category::dds_output).live_bytes == size);
+	}
+	const auto usage = get(category::dds_output);
+	REQUIRE(usage.allocated_bytes == size * sizeof(std::uint32_t) + size);
+	REQUIRE(usage.live_bytes == 0UL);
+	REQUIRE(usage.peak_bytes == size * sizeof(std::uint32_t) + size);
+	REQUIRE(allocations::get_statistics().total.peak_bytes == usage.peak_bytes + size);
+
+	// Containers using todds::allocator are recorded in the category of their allocator, or in other by default.
+	{
+		const todds::vector<std::uint32_t> paths(size, 0U, todds::allocator<std::uint32_t>{category::paths});
+		REQUIRE(get(category::paths).live_bytes == size * sizeof(std::uint32_t));
+		const std::size_t other_bytes = get(category::other).live_bytes;
+		const todds::string text(size, 'a');
+		REQUIRE(get(category::other).live_bytes - other_bytes >= size);
+	}
+	REQUIRE(get(category::paths).live_bytes == 0UL);
+
+	// Memory allocated before enabling accounting does not count as live.
+	ignored = {};
+	REQUIRE(get(category::dds_output).live_bytes == 0UL);
+
+	const todds::string summary = allocations::summary();
+	REQUIRE(summary.starts_with("Memory"));
+	REQUIRE(summary.find("dds") != todds::string::npos);
+	REQUIRE(summary.find("paths") != todds::string::npos);
+	REQUIRE(summary.find("png") == todds::string::npos);
+
+	allocations::disable();
+	const todds::pooled_vector<std::uint8_t> disabled(size, todds::pooled_allocator<std::uint8_t>(category::png_buffers));
+	REQUIRE(get(category::png_buffers).allocations == 0UL);
+}
+
+TEST_CASE("todds::cgroup", "[util]") {
+	namespace cgroup = todds::cgroup;
+	SECTION("CPU quotas are rounded up to whole CPUs") {
+		REQUIRE(cgroup::parse_cpu_quota("max", "100000") == 0UL);
+		REQUIRE(cgroup::parse_cpu_quota("-1", "100000") == 0UL);
+		REQUIRE(cgroup::parse_cpu_quota("200000", "100000") == 2UL);
+		REQUIRE(cgroup::parse_cpu_quota("150000", "100000\n") == 2UL);
+		REQUIRE(cgroup::parse_cpu_quota("50000", "100000") == 1UL);
+		REQUIRE(cgroup::parse_cpu_quota("100000", "") == 0UL);
+	}
+
+	SECTION("CPU lists count every CPU of each range") {
+		REQUIRE(cgroup::parse_cpu_list("0-3,8,10-11\n") == 7UL);
+		REQUIRE(cgroup::parse_cpu_list("5") == 1UL);
+		REQUIRE(cgroup::parse_cpu_list("") == 0UL);
+		REQUIRE(cgroup::parse_cpu_list("3-1") == 0UL);
+	}
+
+	SECTION("Memory limits ignore values representing no limit") {
+		REQUIRE(cgroup::parse_memory_limit("max") == 0UL);
+		REQUIRE(cgroup::parse_memory_limit("9223372036854771712") == 0UL);
+		REQUIRE(cgroup::parse_memory_limit("1073741824\n") == 1073741824UL);
+	}
+
+	SECTION("The number of CPUs is the smallest limit") {
+		REQUIRE(cgroup::limits{}.cpus() == 0UL);
+		REQUIRE(cgroup::limits{4UL, 0UL, 0UL}.cpus() == 4UL);
+		REQUIRE(cgroup::limits{4UL, 2UL, 0UL}.cpus() == 2UL);
+		REQUIRE(cgroup::limits{0UL, 8UL, 0UL}.cpus() == 8UL);
+	}
+}
+
+TEST_CASE("todds::histogram", "[util]") {
+	todds::histogram values;
+
+	SECTION("An empty histogram reports zeros") {
+		REQUIRE(values.count() == 0UL);
+		REQUIRE(values.max() == 0UL);
+		REQUIRE(values.mean() == 0.0);
+		REQUIRE(values.percentile(0.5) == 0UL);
+	}
+
+	SECTION("Small values are stored exactly") {
+		for (std::uint64_t value = 0UL; value < 8UL; ++value) { values.add(value); }
+		REQUIRE(values.count() == 8UL);
+		REQUIRE(values.total() == 28UL);
+		REQUIRE(values.percentile(0.5) == 3UL);
+		REQUIRE(values.percentile(1.0) == 7UL);
+	}
+
+	SECTION("Percentiles have a bounded relative error") {
+		for (std::uint64_t value = 1UL; value <= 100000UL; ++value) { values.add(value * 1000UL); }
+		REQUIRE(values.max() == 100000000UL);
+		REQUIRE(values.mean() == 50000500.0);
+		for (const double fraction : {0.5, 0.95, 0.99}) {
+			const double expected = fraction * 100000000.0;
+			const auto result = static_cast<double>(values.percentile(fraction));
+			REQUIRE(result >= expected);
+			REQUIRE(result <= expected * 1.125);
+		}
+		REQUIRE(values.percentile(1.0) == values.max());
+	}
+
+	SECTION("Merging adds every sample") {
+		todds::histogram other;
+		values.add(10UL);
+		other.add(1000UL);
+		other.add(std::numeric_limits<std::uint64_t>::max());
+		values.merge(other);
+		REQUIRE(values.count() == 3UL);
+		REQUIRE(values.max() == std::numeric_limits<std::uint64_t>::max());
+		REQUIRE(values.percentile(0.0) == 10UL);
+		REQUIRE(values.percentile(1.0) == std::numeric_limits<std::uint64_t>::max());
+	}
+}
+
+TEST_CASE("todds::thread_registry", "[util]") {
+	todds::thread_registry<std::size_t> registry;
+	const auto sum = [&registry] {
+		std::size_t result{};
+		registry.for_each([&result](std::size_t value) { result += value; });
+		return result;
+	};
+
+	SECTION("Each thread keeps its own data, which outlives the thread") {
+		registry.local() += 1UL;
+		registry.local() += 2UL;
+		std::thread{[&registry] {
+			registry.local([](std::size_t index) { return std::make_unique<std::size_t>(index * 10UL); }) += 5UL;
+		}}.join();
+		std::size_t threads{};
+		registry.for_each([&threads](std::size_t /*value*/) { ++threads; });
+		REQUIRE(threads == 2UL);
+		REQUIRE(sum() == 18UL);
+	}
+
+	SECTION("Reset discards the data of every thread") {
+		registry.local() = 7UL;
+		std::size_t updated{};
+		registry.reset([&updated] { ++updated; });
+		REQUIRE(updated == 1UL);
+		REQUIRE(sum() == 0UL);
+		REQUIRE(registry.local() == 0UL);
+		registry.local() = 3UL;
+		REQUIRE(sum() == 3UL);
+	}
+}
+
+TEST_CASE("todds::trace", "[util]") {
+	SECTION("Zones are not recorded while tracing is disabled") {
+		todds::trace::enable();
+		todds::trace::disable();
+		{ const todds::trace::zone ignored{"ignored"}; }
+		std::ostringstream output;
+		todds::trace::write(output);
+		REQUIRE(output.str().find("ignored") == std::string::npos);
+	}
+
+	SECTION("Zones are written as Chrome trace events") {
+		todds::trace::enable();
+		REQUIRE(todds::trace::enabled());
+		{
+			todds::trace::zone file_zone{"file"};
+			file_zone.set_file_index(42UL);
+			const todds::trace::zone nested{"nested"};
+		}
+		todds::trace::disable();
+		std::ostringstream output;
+		todds::trace::write(output);
+		const std::string json = output.str();
+		REQUIRE(json.starts_with("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+		REQUIRE(json.find("\"name\":\"file\",\"ph\":\"X\"") != std::string::npos);
+		REQUIRE(json.find("\"args\":{\"file\":42}") != std::string::npos);
+		REQUIRE(json.find("\"name\":\"nested\"") != std::string::npos);
+	}
+
+	SECTION("Each thread keeps only its most recent zones") {
+		todds::trace::enable(2UL);
+		{ const todds::trace::zone first{"first"}; }
+		{ const todds::trace::zone second{"second"}; }
+		{ const todds::trace::zone third{"third"}; }
+		todds::trace::disable();
+		std::ostringstream output;
+		todds::trace::write(output);
+		const std::string json = output.str();
+		REQUIRE(json.find("\"first\"") == std::string::npos);
+		REQUIRE(json.find("\"second\"") != std::string::npos);
+		REQUIRE(json.find("\"third\"") != std::string::npos);
+	}
+}
+
+TEST_CASE("todds::perf", "[util]") {
+	// Counters may not be available in virtual machines, containers or with a restrictive perf_event_paranoid.
+	const todds::string error = todds::perf::enable();
+	if (!error.empty()) {
+		REQUIRE(!todds::perf::enabled());
+		return;
+	}
+
+	std::uint64_t sum{};
+	{
+		const todds::perf::zone counted{"counted"};
+		for (std::uint64_t value = 0UL; value < 100000UL; ++value) { sum += value * value; }
+	}
+	todds::perf::disable();
+	{ const todds::perf::zone ignored{"ignored"}; }
+
+	const todds::string summary = todds::perf::summary();
+	REQUIRE(sum > 0UL);
+	REQUIRE(summary.starts_with("Zone"));
+	REQUIRE(summary.find("counted") != todds::string::npos);
+	REQUIRE(summary.find("ignored") == todds::string::npos);
+}